@@ -0,0 +1,80 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "core/Action.h"
+#include "core/Runtime.h"
+#include <folly/Demangle.h>
+#include "utils/Metrics.h"
+
+namespace chaos {
+namespace core {
+
+std::string Action::typeName() const {
+    auto name = folly::demangle(typeid(*this)).toStdString();
+    auto pos = name.rfind("::");
+    return pos == std::string::npos ? name : name.substr(pos + 2);
+}
+
+void Action::recordMetrics(ResultCode rc) {
+    if (latency_ == nullptr) {
+        auto type = typeName();
+        latency_ = utils::Metrics::histogram("chaos_action_latency_us", {{"type", type}});
+        failures_ = utils::Metrics::counter("chaos_action_failures", {{"type", type}});
+    }
+    latency_->record(std::chrono::duration_cast<std::chrono::microseconds>(timeSpent_).count());
+    if (rc != ResultCode::OK) {
+        failures_->add();
+    }
+}
+
+namespace {
+
+// The step runs on a blocking thread, an exception must not lose the done callback.
+template <typename Step>
+ResultCode runStep(Step&& step) {
+    try {
+        return step();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Exception " << e.what();
+        return ResultCode::ERR_FAILED;
+    }
+}
+
+}   // namespace
+
+void DisturbAction::doRunAsync(Runtime* runtime, DoneCallback done) {
+    nextRound(runtime, 0, std::move(done));
+}
+
+void DisturbAction::nextRound(Runtime* runtime, int32_t round, DoneCallback done) {
+    if (round >= loopTimes_) {
+        done(ResultCode::OK);
+        return;
+    }
+    auto toDisturb = std::chrono::seconds(timeToDisurb_);
+    runtime->runAfter(toDisturb, [this, runtime, round, done = std::move(done)] () mutable {
+        auto rc = runStep([this] { return disturb(); });
+        if (rc != ResultCode::OK) {
+            LOG(ERROR) << "Disturb failed!";
+            done(rc);
+            return;
+        }
+        auto toRecover = std::chrono::seconds(timeToRecover_);
+        runtime->runAfter(toRecover, [this, runtime, round, done = std::move(done)] () mutable {
+            auto ret = runStep([this] { return recover(); });
+            if (ret != ResultCode::OK) {
+                LOG(ERROR) << "Recover failed!";
+                done(ret);
+                return;
+            }
+            clearDetail();
+            nextRound(runtime, round + 1, std::move(done));
+        }, true);
+    }, true);
+}
+
+}   // namespace core
+}   // namespace chaos
@@ -8,17 +8,20 @@
 #define CORE_ACTION_H_
 
 #include "common/base/Base.h"
+#include <atomic>
 #include <chrono>
-#include <folly/Unit.h>
-#include <folly/Try.h>
 #include <folly/Executor.h>
-#include <folly/futures/Future.h>
-#include <folly/executors/GlobalExecutor.h>
-#include <folly/futures/SharedPromise.h>
+#include <folly/Function.h>
 #include <folly/String.h>
+#include <memory>
 #include "expression/Expressions.h"
 
 namespace chaos {
+namespace utils {
+class Histogram;
+class Counter;
+}   // namespace utils
+
 namespace core {
 
 using Clock = std::chrono::high_resolution_clock;
@@ -35,6 +38,10 @@ enum class ResultCode {
     ERR_NOT_FINISHED,
 };
 
+class Runtime;
+
+using DoneCallback = folly::Function<void(ResultCode)>;
+
 // all actions share the same context
 struct ActionContext {
     ExprContext exprCtx;
@@ -42,11 +49,12 @@ struct ActionContext {
 
 /**
  * This is the basic action class.
- * It is not thread-safe
+ * It is not thread-safe, except the status accessors read by the status server.
  * */
 class Action {
     friend class ChaosPlan;
     friend class LoopAction;
+    friend class DagScheduler;
 
 public:
     enum class Status {
@@ -57,8 +65,7 @@ public:
     };
 
     explicit Action(ActionContext* ctx = nullptr)
-        : ctx_(ctx)
-        , promise_(std::make_unique<folly::SharedPromise<folly::Unit>>()) {}
+        : ctx_(ctx) {}
 
     virtual ~Action() = default;
 
@@ -76,13 +83,13 @@ public:
     }
 
     virtual void reset() {
-        if (status_ == Status::INIT
-                || status_ == Status::RUNNING) {
+        auto status = this->status();
+        if (status == Status::INIT
+                || status == Status::RUNNING) {
             LOG(INFO) << "Can't reset action with status " << statusStr();
             return;
         }
-        status_ = Status::INIT;
-        promise_.reset(new folly::SharedPromise<folly::Unit>());
+        status_.store(Status::INIT, std::memory_order_release);
     }
 
     void setId(int32_t id) {
@@ -93,12 +100,13 @@ public:
         return id_;
     }
 
+    // The accessors below could be called by other threads while the action is running.
     Status status() const {
-        return status_;
+        return status_.load(std::memory_order_acquire);
     }
 
     std::string statusStr() const {
-        switch (status_) {
+        switch (status()) {
             case Status::INIT:
                 return "init";
             case Status::RUNNING:
@@ -114,39 +122,124 @@ public:
     }
 
     void run() {
-        CHECK(Status::INIT == status_);
-        CHECK(promise_ != nullptr);
-        status_ = Status::RUNNING;
-        TimePoint start = Clock::now();
-        LOG(INFO) << "Begin the action " << id_ << ": " << toString();
-        auto rc = this->doRun();
-        auto end = Clock::now();
-        timeSpent_ = end - start;
-        CHECK(Status::RUNNING == status_);
-        if (rc == ResultCode::OK) {
-            status_ = Status::SUCCEEDED;
-            LOG(INFO) << "Then action " << id_ << ": " << toString() << " finished!";
-            promise_->setTry(folly::Try<folly::Unit>(folly::Unit()));
-        } else {
-            status_ = Status::FAILED;
-            LOG(ERROR) << "The action " << id_ << ": " << toString() << " failed!";
-            promise_->setException(
-                    std::runtime_error(
-                        folly::stringPrintf("run failed, rc %d",
-                                            static_cast<int32_t>(rc))));
-        }
+        start();
+        finish(this->doRun());
+    }
+
+    /**
+     * Run the action and call done once it finished, maybe on another thread.
+     * The action could hand its waits to the timers of the runtime, see doRunAsync.
+     * */
+    void runAsync(Runtime* runtime, folly::Function<void()> done) {
+        start();
+        this->doRunAsync(runtime, [this, done = std::move(done)] (ResultCode rc) mutable {
+            finish(rc);
+            done();
+        });
     }
 
-    void markFailed(folly::exception_wrapper&& ew) {
-        status_ = Status::FAILED;
-        promise_->setException(std::move(ew));
+    // The wall time in ms since epoch when the last run started and ended, 0 if not yet.
+    int64_t startTimeMs() const {
+        return startMs_.load(std::memory_order_relaxed);
+    }
+
+    int64_t endTimeMs() const {
+        return endMs_.load(std::memory_order_relaxed);
+    }
+
+    // How many times the action has been run, the actions inside loops run many times.
+    int32_t runs() const {
+        return runs_.load(std::memory_order_relaxed);
+    }
+
+    // What the action is doing now, e.g. the host picked by a disturbance.
+    virtual std::string detail() const {
+        auto detail = std::atomic_load_explicit(&detail_, std::memory_order_acquire);
+        return detail == nullptr ? "" : *detail;
+    }
+
+    // The actions run by this action, e.g. the sub plan of a loop.
+    virtual std::vector<Action*> subActions() const {
+        return {};
+    }
+
+    void markFailed(const std::string& reason) {
+        endMs_.store(nowMs(), std::memory_order_relaxed);
+        status_.store(Status::FAILED, std::memory_order_release);
+        LOG(ERROR) << "The action " << id_ << ": " << toString() << " failed, " << reason;
     }
 
     virtual std::string toString() = 0;
 
+    // The name of the concrete class without the namespaces, e.g. "WaitAction".
+    std::string typeName() const;
+
+    /**
+     * Whether the action may block its thread for a long time (ssh, sleeping, queries),
+     * blocking actions are parked on the blocking threads of the runtime.
+     * */
+    virtual bool isBlocking() const {
+        return true;
+    }
+
 protected:
     virtual ResultCode doRun() = 0;
 
+    /**
+     * The asynchronous version of doRun, done must be called exactly once.
+     * By default it runs doRun on the current thread.
+     * */
+    virtual void doRunAsync(Runtime* runtime, DoneCallback done) {
+        UNUSED(runtime);
+        done(doRun());
+    }
+
+    void setDetail(std::string detail) {
+        std::atomic_store_explicit(&detail_,
+                                   std::make_shared<const std::string>(std::move(detail)),
+                                   std::memory_order_release);
+    }
+
+    void clearDetail() {
+        std::atomic_store_explicit(&detail_,
+                                   std::shared_ptr<const std::string>(),
+                                   std::memory_order_release);
+    }
+
+private:
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    void start() {
+        CHECK(Status::INIT == status());
+        runs_.fetch_add(1, std::memory_order_relaxed);
+        startMs_.store(nowMs(), std::memory_order_relaxed);
+        endMs_.store(0, std::memory_order_relaxed);
+        status_.store(Status::RUNNING, std::memory_order_release);
+        startTime_ = Clock::now();
+        LOG(INFO) << "Begin the action " << id_ << ": " << toString();
+    }
+
+    void finish(ResultCode rc) {
+        timeSpent_ = Clock::now() - startTime_;
+        recordMetrics(rc);
+        CHECK(Status::RUNNING == status());
+        endMs_.store(nowMs(), std::memory_order_relaxed);
+        if (rc == ResultCode::OK) {
+            status_.store(Status::SUCCEEDED, std::memory_order_release);
+            LOG(INFO) << "Then action " << id_ << ": " << toString() << " finished!";
+        } else {
+            status_.store(Status::FAILED, std::memory_order_release);
+            LOG(ERROR) << "The action " << id_ << ": " << toString()
+                       << " failed, rc " << static_cast<int32_t>(rc);
+        }
+    }
+
+    // Every run is recorded into the latency histogram of the action type.
+    void recordMetrics(ResultCode rc);
+
 protected:
     // other actions that depend on this action.
     std::vector<Action*>    dependers_;
@@ -156,9 +249,23 @@ protected:
     ActionContext*          ctx_ = nullptr;
 
 private:
-    Status status_{Status::INIT};
-    std::unique_ptr<folly::SharedPromise<folly::Unit>> promise_;
+    std::atomic<Status>     status_{Status::INIT};
     int32_t     id_ = -1;
+    TimePoint   startTime_;
+    std::atomic<int64_t>    startMs_{0};
+    std::atomic<int64_t>    endMs_{0};
+    std::atomic<int32_t>    runs_{0};
+    // Read by the status server, so it's replaced rather than modified.
+    std::shared_ptr<const std::string>  detail_;
+    // Resolved on the first run.
+    utils::Histogram*       latency_{nullptr};
+    utils::Counter*         failures_{nullptr};
+
+    // Scheduling state, owned by the DagScheduler running this action.
+    // The number of dependees which have not finished yet.
+    std::atomic<int32_t>    pendingDependees_{0};
+    // Whether any dependee failed, the action will be skipped if so.
+    std::atomic<bool>       dependeeFailed_{false};
 };
 
 using ActionPtr = std::unique_ptr<Action>;
@@ -178,6 +285,10 @@ public:
         return name_;
     }
 
+    bool isBlocking() const override {
+        return false;
+    }
+
 private:
     std::string name_;
 };
@@ -206,11 +317,20 @@ public:
                 LOG(ERROR) << "Recover failed!";
                 return rc;
             }
+            clearDetail();
         }
         return ResultCode::OK;
     }
 
+    // Only the disturb and recover steps hold a thread, the intervals are timers.
+    bool isBlocking() const override {
+        return false;
+    }
+
 protected:
+    void doRunAsync(Runtime* runtime, DoneCallback done) override;
+
+    // The disturbance set by disturb() via setDetail is cleared once recovered.
     virtual ResultCode disturb() = 0;
 
     virtual ResultCode recover() = 0;
@@ -218,6 +338,9 @@ protected:
     int32_t loopTimes_;
     int32_t timeToDisurb_;    // seconds
     int32_t timeToRecover_;   // seconds
+
+private:
+    void nextRound(Runtime* runtime, int32_t round, DoneCallback done);
 };
 
 }   // namespace core
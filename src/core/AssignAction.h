@@ -21,22 +21,23 @@ public:
                  const std::string& expr)
         : Action(ctx)
         , var_(var)
-        , exprStr_(expr) {}
+        , exprStr_(expr) {
+        // Compiled once, so an illegal expression fails the plan when loading.
+        expr_ = ParserHelper::compile(exprStr_, &ctx_->exprCtx);
+        CHECK(expr_ != nullptr) << "Compile " << exprStr_ << " failed!";
+        varSlot_ = ctx_->exprCtx.slot(var_);
+    }
 
     ~AssignAction() = default;
 
     ResultCode doRun() override {
-        auto expr = ParserHelper::parse(exprStr_);
-        if (expr == nullptr) {
-            return ResultCode::ERR_FAILED;
-        }
-        auto valOrErr = expr->eval(&ctx_->exprCtx);
+        auto valOrErr = expr_->eval(&ctx_->exprCtx);
         if (!valOrErr) {
             LOG(ERROR) << "Eval " << exprStr_ << " failed!";
             return ResultCode::ERR_FAILED;
         }
         auto val = std::move(valOrErr).value();
-        ctx_->exprCtx.setVar(var_, std::move(val));
+        ctx_->exprCtx.setVar(varSlot_, std::move(val));
         return ResultCode::OK;
     }
 
@@ -44,9 +45,15 @@ public:
         return folly::stringPrintf("$%s=%s", var_.c_str(), exprStr_.c_str());
     }
 
+    bool isBlocking() const override {
+        return false;
+    }
+
 private:
     std::string var_;
     std::string exprStr_;
+    std::unique_ptr<CompiledExpr> expr_;
+    VarSlot varSlot_;
 };
 
 }  // namespace core
@@ -5,6 +5,9 @@
  */
 
 #include "core/ChaosPlan.h"
+#include "core/DagScheduler.h"
+#include "utils/Metrics.h"
+#include <folly/json.h>
 
 namespace chaos {
 namespace core {
@@ -67,47 +70,30 @@ void ChaosPlan::schedule() {
         sourceAction->addDependency(action);
     }
 
+    std::vector<Action*> actions;
+    actions.reserve(actions_.size());
+    auto nodes = std::make_shared<std::vector<ActionNode>>();
     for (auto& action : actions_) {
-        std::vector<folly::Future<folly::Unit>> dependees;
-        for (auto* dee : action->dependees_) {
-            LOG(INFO) << "Add depender " << action->id() << " for " << dee->id();
-            dependees.emplace_back(dee->promise_->getFuture());
-        }
-        auto actionPtr = action.get();
-
-        folly::collectAll(std::move(dependees))
-            .via(threadsPool_.get())
-            .thenValue([this, actionPtr](const auto&& tries) mutable {
-                for (auto& t : tries) {
-                    if (t.hasException()) {
-                        auto ew = t.exception();
-                        LOG(ERROR) << "Run " << actionPtr->toString()
-                                   << " failed, msg " << ew.what();
-                        actionPtr->markFailed(std::move(ew));
-                        if (status_ == Status::SUCCEEDED) {
-                            status_ = Status::FAILED;
-                        }
-                        return;
-                    }
-                }
-                actionPtr->run();
-            })
-            .thenError([this, actionPtr](auto ew) {
-                LOG(ERROR) << "Run " << actionPtr->toString()
-                           << " failed, msg " << ew.what();
-                actionPtr->markFailed(std::move(ew));
-                if (status_ == Status::SUCCEEDED) {
-                    status_ = Status::FAILED;
-                }
-            });
-    }
-
-    sinkAction->promise_->getFuture().wait();
+        actions.emplace_back(action.get());
+        nodes->emplace_back(buildNode(action.get()));
+    }
+    std::atomic_store(&nodes_, std::shared_ptr<const std::vector<ActionNode>>(std::move(nodes)));
+    startMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    DagScheduler scheduler(runtime_.get(), concurrency_);
+    if (!scheduler.run(actions)) {
+        status_ = Status::FAILED;
+    }
+    endMs_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    LOG(INFO) << "Scheduling overhead: " << scheduler.stats().toString();
+
     if (sinkAction->status() == ActionStatus::FAILED) {
         LOG(INFO) << "The plan failed, rerun the last action "
                   << "to ensure the email has been send out!";
         sinkAction->doRun();
     }
+    finish();
     return;
 }
 
@@ -129,10 +115,113 @@ std::string ChaosPlan::toString() {
         str.seekp(-1, std::ios_base::end);
         str << std::endl;
     }
+    // The actions inside loops run many times, only their distribution makes sense.
+    str << "LATENCY OF ACTION TYPES (us):\n";
+    for (const auto& latency : utils::Metrics::snapshots("chaos_action_latency_us")) {
+        str << latency.first.front().second << ": " << latency.second.toString() << "\n";
+    }
     str << "TIME COSTS: "
         << std::chrono::duration_cast<std::chrono::milliseconds>(timeSpent_).count() << "ms\n";
     return str.str();
 }
 
+// static
+ChaosPlan::ActionNode ChaosPlan::buildNode(Action* action) {
+    ActionNode node;
+    node.action = action;
+    node.desc = action->toString();
+    for (auto* dee : action->dependees_) {
+        node.dependees.emplace_back(dee->id());
+    }
+    for (auto* sub : action->subActions()) {
+        node.subActions.emplace_back(buildNode(sub));
+    }
+    return node;
+}
+
+// static
+folly::dynamic ChaosPlan::nodeStatus(const ActionNode& node, int64_t nowMs) {
+    auto* action = node.action;
+    auto startMs = action->startTimeMs();
+    auto endMs = action->endTimeMs();
+    folly::dynamic obj = folly::dynamic::object
+        ("id", action->id())
+        ("type", action->typeName())
+        ("desc", node.desc)
+        ("status", action->statusStr())
+        ("runs", action->runs())
+        ("start_ms", startMs)
+        ("end_ms", endMs)
+        ("cost_ms", startMs == 0 ? 0 : (endMs >= startMs ? endMs : nowMs) - startMs);
+    auto detail = action->detail();
+    if (!detail.empty()) {
+        obj["detail"] = std::move(detail);
+    }
+    folly::dynamic dependees = folly::dynamic::array;
+    for (auto id : node.dependees) {
+        dependees.push_back(id);
+    }
+    obj["depends_on"] = std::move(dependees);
+    if (!node.subActions.empty()) {
+        folly::dynamic subActions = folly::dynamic::array;
+        for (const auto& sub : node.subActions) {
+            subActions.push_back(nodeStatus(sub, nowMs));
+        }
+        obj["sub_actions"] = std::move(subActions);
+    }
+    return obj;
+}
+
+// static
+void ChaosPlan::collectRunning(const std::vector<ActionNode>& nodes, folly::dynamic& running) {
+    for (const auto& node : nodes) {
+        if (node.action->status() != ActionStatus::RUNNING) {
+            continue;
+        }
+        if (node.subActions.empty()) {
+            folly::dynamic obj = folly::dynamic::object("id", node.action->id())("desc", node.desc);
+            auto detail = node.action->detail();
+            if (!detail.empty()) {
+                obj["detail"] = std::move(detail);
+            }
+            running.push_back(std::move(obj));
+        } else {
+            collectRunning(node.subActions, running);
+        }
+    }
+}
+
+std::string ChaosPlan::statusJson() const {
+    auto nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    auto startMs = startMs_.load();
+    auto endMs = endMs_.load();
+    std::string status = "init";
+    if (endMs != 0) {
+        status = status_ == Status::SUCCEEDED ? "succeeded" : "failed";
+    } else if (startMs != 0) {
+        status = "running";
+    }
+    folly::dynamic plan = folly::dynamic::object
+        ("plan", planName_)
+        ("status", status)
+        ("start_ms", startMs)
+        ("end_ms", endMs)
+        ("cost_ms", startMs == 0 ? 0 : (endMs != 0 ? endMs : nowMs) - startMs);
+    folly::dynamic actions = folly::dynamic::array;
+    // The running leaves, e.g. the disturbances in progress with their picked hosts.
+    folly::dynamic running = folly::dynamic::array;
+    auto nodes = std::atomic_load(&nodes_);
+    if (nodes != nullptr) {
+        for (const auto& node : *nodes) {
+            actions.push_back(nodeStatus(node, nowMs));
+        }
+        collectRunning(*nodes, running);
+    }
+    plan["running"] = std::move(running);
+    plan["actions"] = std::move(actions);
+    return folly::toPrettyJson(plan);
+}
+
 }  // namespace core
 }  // namespace chaos
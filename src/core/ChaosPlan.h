@@ -10,7 +10,8 @@
 #include "common/base/Base.h"
 #include "core/RunTaskAction.h"
 #include "core/SendEmailAction.h"
-#include <folly/executors/CPUThreadPoolExecutor.h>
+#include "core/Runtime.h"
+#include <folly/dynamic.h>
 
 namespace chaos {
 namespace core {
@@ -30,11 +31,12 @@ public:
               const std::string& planName = "") {
         emailTo_ = emailTo;
         planName_ = planName;
-        threadsPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(concurrency);
+        concurrency_ = concurrency;
+        runtime_ = std::make_unique<Runtime>(static_cast<size_t>(FLAGS_runtime_workers));
     }
 
     virtual ~ChaosPlan() {
-        threadsPool_->stop();
+        runtime_->stop();
     }
 
     // Transfer the ownership into the plan.
@@ -44,6 +46,9 @@ public:
 
     virtual void prepare() {}
 
+    // Called once all actions are done, to release what's set up by prepare().
+    virtual void finish() {}
+
     void schedule();
 
     const std::vector<std::unique_ptr<Action>>& actions() const {
@@ -56,18 +61,47 @@ public:
 
     std::string toString();
 
+    /**
+     * The live state of the actions in json, served by the status server.
+     * It could be called by other threads while the plan is running.
+     * */
+    std::string statusJson() const;
+
     void setAttachment(const std::string& attachment) {
         attachment_ = attachment;
     }
 
+private:
+    // The shape of the DAG is fixed once scheduled, only the states are read live.
+    struct ActionNode {
+        Action*                 action;
+        std::string             desc;
+        std::vector<int32_t>    dependees;
+        std::vector<ActionNode> subActions;
+    };
+
+    static ActionNode buildNode(Action* action);
+
+    static folly::dynamic nodeStatus(const ActionNode& node, int64_t nowMs);
+
+    static void collectRunning(const std::vector<ActionNode>& nodes, folly::dynamic& running);
+
 protected:
     std::vector<ActionPtr> actions_;
-    std::unique_ptr<folly::CPUThreadPoolExecutor> threadsPool_;
+    // Shared by all loops inside the plan, concurrency_ limits the actions in flight.
+    std::unique_ptr<Runtime> runtime_;
+    int32_t concurrency_;
     Status status_{Status::SUCCEEDED};
     Duration  timeSpent_;
     std::string  emailTo_;
     std::string  planName_;
     std::string  attachment_;
+
+private:
+    std::shared_ptr<const std::vector<ActionNode>> nodes_;
+    std::atomic<int64_t> startMs_{0};
+    // status_ is final once it's set.
+    std::atomic<int64_t> endMs_{0};
 };
 
 }  // namespace core
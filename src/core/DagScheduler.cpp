@@ -0,0 +1,192 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "core/DagScheduler.h"
+
+namespace chaos {
+namespace core {
+
+int64_t DagScheduler::Stats::overheadPerActionNs() const {
+    if (actions == 0) {
+        return 0;
+    }
+    auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(setup + dispatchTotal);
+    return total.count() / static_cast<int64_t>(actions);
+}
+
+std::string DagScheduler::Stats::toString() const {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    return folly::stringPrintf("%lu actions, setup %ldus, dispatch avg %ldus max %ldus, "
+                               "overhead %ldns per action",
+                               actions,
+                               duration_cast<microseconds>(setup).count(),
+                               actions == 0
+                                    ? 0L
+                                    : duration_cast<microseconds>(dispatchTotal).count()
+                                        / static_cast<int64_t>(actions),
+                               duration_cast<microseconds>(dispatchMax).count(),
+                               overheadPerActionNs());
+}
+
+bool DagScheduler::isAcyclic(const std::vector<Action*>& actions) {
+    std::vector<Action*> ready;
+    ready.reserve(actions.size());
+    for (auto* action : actions) {
+        action->pendingDependees_.store(action->dependees_.size(), std::memory_order_relaxed);
+        if (action->dependees_.empty()) {
+            ready.emplace_back(action);
+        }
+    }
+    size_t visited = 0;
+    while (!ready.empty()) {
+        auto* action = ready.back();
+        ready.pop_back();
+        visited++;
+        for (auto* der : action->dependers_) {
+            if (der->pendingDependees_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+                ready.emplace_back(der);
+            }
+        }
+    }
+    return visited == actions.size();
+}
+
+bool DagScheduler::run(const std::vector<Action*>& actions) {
+    auto start = Clock::now();
+    actions_ = actions.size();
+    dispatchTotalNs_ = 0;
+    dispatchMaxNs_ = 0;
+    failed_ = false;
+    if (actions.empty()) {
+        setup_ = Clock::now() - start;
+        return true;
+    }
+    if (!isAcyclic(actions)) {
+        LOG(ERROR) << "There is a cycle inside the actions, refuse to run them!";
+        return false;
+    }
+
+    std::vector<Action*> roots;
+    for (auto* action : actions) {
+        action->pendingDependees_.store(action->dependees_.size(), std::memory_order_relaxed);
+        action->dependeeFailed_.store(false, std::memory_order_relaxed);
+        if (action->dependees_.empty()) {
+            roots.emplace_back(action);
+        }
+    }
+    done_.reset();
+    inFlight_ = 0;
+    ready_.clear();
+    remaining_.store(actions.size(), std::memory_order_release);
+    setup_ = Clock::now() - start;
+    for (auto* action : roots) {
+        dispatch(action);
+    }
+
+    runtime_->wait(done_);
+    return !failed_.load(std::memory_order_acquire);
+}
+
+DagScheduler::Stats DagScheduler::stats() const {
+    Stats stats;
+    stats.actions = actions_;
+    stats.setup = setup_;
+    stats.dispatchTotal = std::chrono::nanoseconds(dispatchTotalNs_.load());
+    stats.dispatchMax = std::chrono::nanoseconds(dispatchMaxNs_.load());
+    return stats;
+}
+
+void DagScheduler::dispatch(Action* action) {
+    VLOG(1) << "Action " << action->id() << " is ready";
+    auto readyTime = Clock::now();
+    if (maxInFlight_ > 0) {
+        std::lock_guard<std::mutex> lk(readyLock_);
+        if (inFlight_ >= maxInFlight_) {
+            ready_.emplace_back(action, readyTime);
+            return;
+        }
+        inFlight_++;
+    }
+    submit(action, readyTime);
+}
+
+void DagScheduler::submit(Action* action, TimePoint readyTime) {
+    auto task = [this, action, readyTime] {
+        execute(action, readyTime);
+    };
+    if (action->isBlocking()) {
+        runtime_->addBlocking(std::move(task));
+    } else {
+        runtime_->add(std::move(task));
+    }
+}
+
+void DagScheduler::release() {
+    if (maxInFlight_ == 0) {
+        return;
+    }
+    std::pair<Action*, TimePoint> next;
+    {
+        std::lock_guard<std::mutex> lk(readyLock_);
+        if (ready_.empty()) {
+            inFlight_--;
+            return;
+        }
+        next = ready_.front();
+        ready_.pop_front();
+    }
+    submit(next.first, next.second);
+}
+
+void DagScheduler::execute(Action* action, TimePoint readyTime) {
+    auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - readyTime).count();
+    dispatchTotalNs_.fetch_add(latency, std::memory_order_relaxed);
+    auto max = dispatchMaxNs_.load(std::memory_order_relaxed);
+    while (latency > max
+            && !dispatchMaxNs_.compare_exchange_weak(max, latency, std::memory_order_relaxed)) {
+    }
+
+    if (action->dependeeFailed_.load(std::memory_order_acquire)) {
+        action->markFailed("one of its dependees failed");
+        release();
+        onFinished(action, false);
+        return;
+    }
+    try {
+        action->runAsync(runtime_, [this, action] {
+            release();
+            onFinished(action, action->status() == Action::Status::SUCCEEDED);
+        });
+    } catch (const std::exception& e) {
+        // The action threw before finishing, so done has not been called.
+        action->markFailed(folly::stringPrintf("exception %s", e.what()));
+        release();
+        onFinished(action, false);
+    }
+}
+
+void DagScheduler::onFinished(Action* action, bool succeeded) {
+    if (!succeeded) {
+        failed_.store(true, std::memory_order_release);
+    }
+    for (auto* der : action->dependers_) {
+        if (!succeeded) {
+            der->dependeeFailed_.store(true, std::memory_order_relaxed);
+        }
+        if (der->pendingDependees_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            dispatch(der);
+        }
+    }
+    // It must be the last step, the scheduler could be destroyed once it is posted.
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        done_.post();
+    }
+}
+
+}   // namespace core
+}   // namespace chaos
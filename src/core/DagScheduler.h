@@ -0,0 +1,103 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef CORE_DAGSCHEDULER_H_
+#define CORE_DAGSCHEDULER_H_
+
+#include "common/base/Base.h"
+#include "core/Action.h"
+#include "core/Runtime.h"
+#include <folly/synchronization/Baton.h>
+
+namespace chaos {
+namespace core {
+
+/**
+ * Event driven scheduler for a DAG of actions.
+ *
+ * Every action keeps a counter of the dependees which have not finished yet.
+ * The roots are pushed into the ready queue (the executor) at the beginning,
+ * and each finished action decrements the counters of its dependers, the one
+ * which drops the counter to zero pushes the depender. So the scheduling costs
+ * O(V + E) atomic operations and no allocation per edge.
+ *
+ * If an action fails, all actions depending on it (directly or not) are marked
+ * failed without running.
+ *
+ * At most maxInFlight actions run at the same time, the others wait in the
+ * scheduler's own ready queue. Blocking actions run on the blocking threads of
+ * the runtime, the light ones on its workers.
+ *
+ * One scheduler could only run one DAG at a time.
+ * */
+class DagScheduler {
+public:
+    struct Stats {
+        size_t      actions{0};
+        // Time to validate the DAG and push the roots.
+        Duration    setup{0};
+        // Sum and max of the time from an action becoming ready to starting running.
+        Duration    dispatchTotal{0};
+        Duration    dispatchMax{0};
+
+        // Average scheduling overhead per action, in nanoseconds.
+        int64_t overheadPerActionNs() const;
+
+        std::string toString() const;
+    };
+
+    // 0 maxInFlight means no limit.
+    explicit DagScheduler(Runtime* runtime, size_t maxInFlight = 0)
+        : runtime_(runtime)
+        , maxInFlight_(maxInFlight) {
+        CHECK_NOTNULL(runtime_);
+    }
+
+    /**
+     * Run all actions and wait until every one of them has finished or been skipped.
+     * The dependencies must be closed inside the actions.
+     * Return true if all actions succeeded.
+     * */
+    bool run(const std::vector<Action*>& actions);
+
+    Stats stats() const;
+
+private:
+    // Check there is no cycle inside the actions, it uses the pending counters.
+    bool isAcyclic(const std::vector<Action*>& actions);
+
+    // Called once the action is ready, it queues the action if too many are in flight.
+    void dispatch(Action* action);
+
+    void submit(Action* action, TimePoint readyTime);
+
+    // Called once the action finished, hand its slot to the next queued one.
+    void release();
+
+    void execute(Action* action, TimePoint readyTime);
+
+    void onFinished(Action* action, bool succeeded);
+
+private:
+    Runtime*                runtime_{nullptr};
+    size_t                  maxInFlight_{0};
+    std::mutex              readyLock_;
+    std::deque<std::pair<Action*, TimePoint>> ready_;
+    size_t                  inFlight_{0};
+    std::atomic<size_t>     remaining_{0};
+    std::atomic<bool>       failed_{false};
+    folly::Baton<>          done_;
+
+    size_t                  actions_{0};
+    Duration                setup_{0};
+    std::atomic<int64_t>    dispatchTotalNs_{0};
+    std::atomic<int64_t>    dispatchMaxNs_{0};
+};
+
+}   // namespace core
+}   // namespace chaos
+
+#endif  // CORE_DAGSCHEDULER_H_
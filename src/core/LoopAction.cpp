@@ -5,40 +5,40 @@
  */
 
 #include "core/LoopAction.h"
+#include "core/DagScheduler.h"
+#include "core/Runtime.h"
 #include "parser/ParserHelper.h"
 
 namespace chaos {
 namespace core {
 
+LoopAction::LoopAction(ActionContext* ctx,
+                       const std::string& conditionExpr,
+                       std::vector<ActionPtr>&& actions,
+                       int32_t concurrency)
+    : Action(ctx)
+    , conditionExpr_(conditionExpr)
+    , actions_(std::move(actions))
+    , concurrency_(concurrency) {
+    condition_ = ParserHelper::compile(conditionExpr_, &ctx_->exprCtx);
+    CHECK(condition_ != nullptr) << "Compile " << conditionExpr_ << " failed!";
+}
+
 ResultCode LoopAction::doRun() {
-    std::vector<Action*> rootActions;
-    std::vector<Action*> leafActions;
+    std::vector<Action*> actions;
+    actions.reserve(actions_.size());
     for (auto& action : actions_) {
-        if (action->dependees_.empty()) {
-            rootActions.emplace_back(action.get());
-        }
-        if (action->dependers_.empty()) {
-            leafActions.emplace_back(action.get());
-        }
-    }
-    actions_.emplace_back(std::make_unique<EmptyAction>("End"));
-    auto* sinkAction = actions_.back().get();
-    for (auto* action : leafActions) {
-        action->addDependency(sinkAction);
-    }
-
-    actions_.emplace_back(std::make_unique<EmptyAction>("Begin"));
-    auto* sourceAction = actions_.back().get();
-    for (auto* action : rootActions) {
-        sourceAction->addDependency(action);
+        actions.emplace_back(action.get());
     }
-    auto expr = ParserHelper::parse(conditionExpr_);
-    if (expr == nullptr) {
-        return ResultCode::ERR_FAILED;
+    auto* runtime = Runtime::current();
+    std::unique_ptr<Runtime> localRuntime;
+    if (runtime == nullptr) {
+        localRuntime = std::make_unique<Runtime>(concurrency_);
+        runtime = localRuntime.get();
     }
     int32_t loopTimes = 0;
     while (true) {
-        auto valOrErr = expr->eval(&ctx_->exprCtx);
+        auto valOrErr = condition_->eval(&ctx_->exprCtx);
         if (!valOrErr) {
             LOG(ERROR) << "Eval " << conditionExpr_ << " failed!";
             return ResultCode::ERR_FAILED;
@@ -49,33 +49,15 @@ ResultCode LoopAction::doRun() {
             break;
         }
         LOG(INFO) << "Loop the " << ++loopTimes << " times...";
-        ResultCode rc = ResultCode::OK;
+        setDetail(folly::stringPrintf("round %d", loopTimes));
         for (auto& action : actions_) {
             action->reset();
-            std::vector<folly::Future<folly::Unit>> dependees;
-            for (auto* dee : action->dependees_) {
-                dependees.emplace_back(dee->promise_->getFuture());
-            }
-            auto actionPtr = action.get();
-            folly::collect(dependees)
-                        .via(threadsPool_.get())
-                        .thenValue([actionPtr](auto&&) {
-                            actionPtr->run();
-                            LOG(INFO) << "Run " << actionPtr->toString() << " succeeded!";
-                        })
-                        .thenError([actionPtr, &rc](auto ew) {
-                            LOG(ERROR) << "Run " << actionPtr->toString()
-                                       << " failed, msg " << ew.what();
-                            actionPtr->markFailed(std::move(ew));
-                            if (rc == ResultCode::OK) {
-                                rc = ResultCode::ERR_FAILED;
-                            }
-                        });
         }
-        sinkAction->promise_->getFuture().wait();
-        if (rc != ResultCode::OK) {
+        DagScheduler scheduler(runtime, concurrency_);
+        if (!scheduler.run(actions)) {
             return ResultCode::ERR_FAILED;
         }
+        VLOG(1) << "Scheduling overhead: " << scheduler.stats().toString();
     }
     LOG(INFO) << "Loop total " << loopTimes << " times";
     return ResultCode::OK;
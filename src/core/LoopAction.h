@@ -8,21 +8,22 @@
 #define CORE_LOOPACTION_H_
 
 #include "core/Action.h"
-#include <folly/executors/CPUThreadPoolExecutor.h>
+#include "expression/ExprCompiler.h"
 
 namespace chaos {
 namespace core {
 
+/**
+ * Run the sub plan again and again while the condition is true.
+ * The sub plan runs on the runtime of the current thread (the plan's), a local
+ * one is created only if the loop is run outside of any runtime.
+ * */
 class LoopAction : public Action {
 public:
     LoopAction(ActionContext* ctx,
                const std::string& conditionExpr,
                std::vector<ActionPtr>&& actions,
-               int32_t concurrency)
-        : Action(ctx)
-        , conditionExpr_(conditionExpr)
-        , actions_(std::move(actions))
-        , threadsPool_(std::make_unique<folly::CPUThreadPoolExecutor>(concurrency)) {}
+               int32_t concurrency);
 
     ResultCode doRun() override;
 
@@ -30,10 +31,24 @@ public:
         return folly::stringPrintf("Run action, the condition is %s", conditionExpr_.c_str());
     }
 
+    std::vector<Action*> subActions() const override {
+        std::vector<Action*> actions;
+        for (auto& action : actions_) {
+            actions.emplace_back(action.get());
+        }
+        return actions;
+    }
+
+    // It only waits for the sub plan, and the worker helps running it meanwhile.
+    bool isBlocking() const override {
+        return false;
+    }
+
 private:
     std::string conditionExpr_;
+    std::unique_ptr<CompiledExpr> condition_;
     std::vector<ActionPtr> actions_;
-    std::unique_ptr<folly::CPUThreadPoolExecutor> threadsPool_;
+    int32_t concurrency_;
 };
 
 }   // namespace core
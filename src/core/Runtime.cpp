@@ -0,0 +1,307 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "core/Runtime.h"
+
+DEFINE_int32(runtime_workers, 0,
+             "The number of worker threads running the light actions, 0 means one per core");
+DEFINE_int32(max_blocking_threads, 1024,
+             "The max number of threads running the blocking actions of a plan");
+
+namespace chaos {
+namespace core {
+
+namespace {
+
+constexpr size_t kNoWorker = std::numeric_limits<size_t>::max();
+
+thread_local Runtime*   tlRuntime = nullptr;
+thread_local size_t     tlWorker = kNoWorker;
+
+}   // namespace
+
+Runtime::Runtime(size_t workers) {
+    if (workers == 0) {
+        workers = std::max(1U, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        workers_.emplace_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers; i++) {
+        workers_[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+    timerThread_ = std::make_unique<folly::ScopedEventBaseThread>("chaos-timer");
+}
+
+Runtime::~Runtime() {
+    stop();
+}
+
+// static
+Runtime* Runtime::current() {
+    return tlRuntime;
+}
+
+void Runtime::add(folly::Func func) {
+    if (tlRuntime == this && tlWorker != kNoWorker) {
+        auto& worker = workers_[tlWorker];
+        std::lock_guard<std::mutex> lk(worker->lock);
+        worker->tasks.emplace_back(std::move(func));
+    } else {
+        std::lock_guard<std::mutex> lk(injectLock_);
+        injected_.emplace_back(std::move(func));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        // Pair with the check inside workerLoop, so the notification is not lost.
+        std::lock_guard<std::mutex> lk(sleepLock_);
+    }
+    sleepCv_.notify_one();
+}
+
+void Runtime::addBlocking(folly::Func func) {
+    std::lock_guard<std::mutex> lk(blockingLock_);
+    blockingTasks_.emplace_back(std::move(func));
+    if (blockingTasks_.size() > idleBlocking_
+            && blockingThreads_.size() < static_cast<size_t>(FLAGS_max_blocking_threads)) {
+        blockingThreads_.emplace_back([this] { blockingLoop(); });
+        VLOG(1) << "Start the " << blockingThreads_.size() << "th blocking thread";
+    } else {
+        blockingCv_.notify_one();
+    }
+}
+
+void Runtime::runAfter(std::chrono::milliseconds delay, folly::Func func, bool blocking) {
+    if (stopping_.load(std::memory_order_acquire)) {
+        LOG(WARNING) << "The runtime has been stopped, drop the timer";
+        return;
+    }
+    auto* evb = timerThread_->getEventBase();
+    evb->runInEventBaseThread([this, evb, delay, blocking, func = std::move(func)] () mutable {
+        // Never run the task on the timer thread, it would delay all other timers.
+        evb->timer().scheduleTimeoutFn([this, blocking, func = std::move(func)] () mutable {
+            if (blocking) {
+                addBlocking(std::move(func));
+            } else {
+                add(std::move(func));
+            }
+        }, delay);
+    });
+}
+
+void Runtime::wait(folly::Baton<>& baton) {
+    if (tlRuntime != this || tlWorker == kNoWorker) {
+        baton.wait();
+        return;
+    }
+    // Hand the worker over to a standby thread instead of running the other tasks
+    // inline, otherwise the waiter could pick up e.g. a whole sub plan of another loop,
+    // and not resume until it finished, even if the baton has been posted long before.
+    Standby* standby = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(standbyLock_);
+        if (stopping_.load(std::memory_order_acquire)) {
+            // No task runs any more, nothing to hand over.
+        } else if (idleStandbys_.empty()) {
+            standbys_.emplace_back(std::make_unique<Standby>());
+            standby = standbys_.back().get();
+            standby->worker = tlWorker;
+            standby->thread = std::thread([this, standby] { standbyLoop(standby); });
+            VLOG(1) << "Start the " << standbys_.size() << "th standby thread";
+        } else {
+            standby = idleStandbys_.back();
+            idleStandbys_.pop_back();
+            standby->worker = tlWorker;
+            standby->retired.store(false, std::memory_order_release);
+            standby->cv.notify_one();
+        }
+    }
+    baton.wait();
+    if (standby == nullptr) {
+        return;
+    }
+    // The standby goes back to the pool after its current task, the waiter doesn't wait for it.
+    standby->retired.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lk(sleepLock_);
+    }
+    sleepCv_.notify_all();
+}
+
+size_t Runtime::blockingThreads() {
+    std::lock_guard<std::mutex> lk(blockingLock_);
+    return blockingThreads_.size();
+}
+
+size_t Runtime::standbyThreads() {
+    std::lock_guard<std::mutex> lk(standbyLock_);
+    return standbys_.size();
+}
+
+void Runtime::stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+    // The pending timers are dropped.
+    timerThread_.reset();
+    {
+        std::lock_guard<std::mutex> lk(sleepLock_);
+    }
+    sleepCv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(blockingLock_);
+    }
+    blockingCv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lk(blockingLock_);
+        threads.swap(blockingThreads_);
+        if (!blockingTasks_.empty()) {
+            LOG(WARNING) << "Drop " << blockingTasks_.size() << " blocking tasks";
+            blockingTasks_.clear();
+        }
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lk(standbyLock_);
+        for (auto& standby : standbys_) {
+            standby->cv.notify_one();
+        }
+    }
+    // No standby is added once stopping, the waiters bail out.
+    for (auto& standby : standbys_) {
+        standby->thread.join();
+    }
+}
+
+void Runtime::workerLoop(size_t index) {
+    tlRuntime = this;
+    tlWorker = index;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        if (tryRunOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(sleepLock_);
+        sleepCv_.wait(lk, [this] {
+            return stopping_.load(std::memory_order_acquire)
+                || queued_.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+void Runtime::blockingLoop() {
+    tlRuntime = this;
+    std::unique_lock<std::mutex> lk(blockingLock_);
+    while (true) {
+        if (!blockingTasks_.empty()) {
+            auto func = std::move(blockingTasks_.front());
+            blockingTasks_.pop_front();
+            lk.unlock();
+            runTask(func);
+            lk.lock();
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+        idleBlocking_++;
+        blockingCv_.wait(lk);
+        idleBlocking_--;
+    }
+}
+
+void Runtime::standbyLoop(Standby* standby) {
+    tlRuntime = this;
+    std::unique_lock<std::mutex> lk(standbyLock_);
+    while (!stopping_.load(std::memory_order_acquire)) {
+        if (standby->worker == kNoWorker) {
+            standby->cv.wait(lk);
+            continue;
+        }
+        tlWorker = standby->worker;
+        lk.unlock();
+        while (!standby->retired.load(std::memory_order_acquire)
+                && !stopping_.load(std::memory_order_acquire)) {
+            if (tryRunOne(tlWorker)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> sleepLk(sleepLock_);
+            sleepCv_.wait(sleepLk, [this, standby] {
+                return standby->retired.load(std::memory_order_acquire)
+                    || stopping_.load(std::memory_order_acquire)
+                    || queued_.load(std::memory_order_acquire) > 0;
+            });
+        }
+        tlWorker = kNoWorker;
+        lk.lock();
+        standby->worker = kNoWorker;
+        idleStandbys_.emplace_back(standby);
+    }
+}
+
+bool Runtime::tryRunOne(size_t index) {
+    folly::Func func;
+    if (popLocal(index, func) || popInjected(func) || steal(index, func)) {
+        queued_.fetch_sub(1, std::memory_order_acq_rel);
+        runTask(func);
+        return true;
+    }
+    return false;
+}
+
+bool Runtime::popLocal(size_t index, folly::Func& func) {
+    auto& worker = workers_[index];
+    std::lock_guard<std::mutex> lk(worker->lock);
+    if (worker->tasks.empty()) {
+        return false;
+    }
+    func = std::move(worker->tasks.back());
+    worker->tasks.pop_back();
+    return true;
+}
+
+bool Runtime::popInjected(folly::Func& func) {
+    std::lock_guard<std::mutex> lk(injectLock_);
+    if (injected_.empty()) {
+        return false;
+    }
+    func = std::move(injected_.front());
+    injected_.pop_front();
+    return true;
+}
+
+bool Runtime::steal(size_t index, folly::Func& func) {
+    for (size_t i = 1; i < workers_.size(); i++) {
+        auto& victim = workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lk(victim->lock);
+        if (!victim->tasks.empty()) {
+            func = std::move(victim->tasks.front());
+            victim->tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+// static
+void Runtime::runTask(folly::Func& func) {
+    try {
+        func();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Task threw an exception: " << e.what();
+    }
+}
+
+}   // namespace core
+}   // namespace chaos
@@ -0,0 +1,134 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef CORE_RUNTIME_H_
+#define CORE_RUNTIME_H_
+
+#include "common/base/Base.h"
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <folly/Executor.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/synchronization/Baton.h>
+
+DECLARE_int32(runtime_workers);
+
+namespace chaos {
+namespace core {
+
+/**
+ * The runtime shared by a whole plan, including the sub plans of all loops.
+ *
+ * Workers run the light tasks with work stealing: every worker owns a deque,
+ * it pushes and pops at the back, and steals from the front of the others
+ * once its own is empty. Tasks added from outside go into a shared queue.
+ *
+ * Blocking tasks (ssh, sleeping, graph queries) are parked on separate threads,
+ * which are created on demand and reused, so they never hold a worker.
+ *
+ * A worker which has to wait (e.g. a LoopAction waiting for its sub plan) hands
+ * its deque over to a standby thread and blocks, so it resumes as soon as it's
+ * woken up, whatever the others are running. The standby threads go back to an
+ * idle pool afterwards, so there are never more of them than waits in flight.
+ *
+ * Delayed tasks are kept in the timer wheel of one event base thread, so a
+ * pending wait costs no thread at all.
+ * */
+class Runtime final : public folly::Executor {
+public:
+    // 0 workers means one per core.
+    explicit Runtime(size_t workers = 0);
+
+    ~Runtime() override;
+
+    // Add a light task, it must not block.
+    void add(folly::Func func) override;
+
+    // Add a task which may block for a long time.
+    void addBlocking(folly::Func func);
+
+    // Run the task after the delay, on a worker or a blocking thread.
+    void runAfter(std::chrono::milliseconds delay, folly::Func func, bool blocking = false);
+
+    // Wait until the baton is posted, a standby thread runs the tasks of the worker meanwhile.
+    void wait(folly::Baton<>& baton);
+
+    // Stop all threads, the tasks not run yet are dropped.
+    void stop();
+
+    size_t workers() const {
+        return workers_.size();
+    }
+
+    size_t blockingThreads();
+
+    size_t standbyThreads();
+
+    // The runtime owning the current thread, nullptr if it is not a runtime thread.
+    static Runtime* current();
+
+private:
+    struct Worker {
+        std::mutex                  lock;
+        std::deque<folly::Func>     tasks;
+        std::thread                 thread;
+    };
+
+    struct Standby {
+        std::thread                 thread;
+        std::condition_variable     cv;
+        // The worker it stands in for, guarded by standbyLock_.
+        size_t                      worker;
+        // Set once the waiter has resumed.
+        std::atomic<bool>           retired{false};
+    };
+
+    void workerLoop(size_t index);
+
+    void blockingLoop();
+
+    void standbyLoop(Standby* standby);
+
+    bool tryRunOne(size_t index);
+
+    bool popLocal(size_t index, folly::Func& func);
+
+    bool popInjected(folly::Func& func);
+
+    bool steal(size_t index, folly::Func& func);
+
+    static void runTask(folly::Func& func);
+
+private:
+    std::vector<std::unique_ptr<Worker>>    workers_;
+
+    std::mutex                              injectLock_;
+    std::deque<folly::Func>                 injected_;
+    // Number of light tasks not picked up yet.
+    std::atomic<size_t>                     queued_{0};
+    std::mutex                              sleepLock_;
+    std::condition_variable                 sleepCv_;
+
+    std::mutex                              blockingLock_;
+    std::condition_variable                 blockingCv_;
+    std::deque<folly::Func>                 blockingTasks_;
+    std::vector<std::thread>                blockingThreads_;
+    size_t                                  idleBlocking_{0};
+
+    std::mutex                              standbyLock_;
+    std::vector<std::unique_ptr<Standby>>   standbys_;
+    std::vector<Standby*>                   idleStandbys_;
+
+    std::unique_ptr<folly::ScopedEventBaseThread> timerThread_;
+
+    std::atomic<bool>                       stopping_{false};
+};
+
+}   // namespace core
+}   // namespace chaos
+
+#endif  // CORE_RUNTIME_H_
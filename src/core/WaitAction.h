@@ -9,6 +9,7 @@
 
 #include "common/base/Base.h"
 #include "core/Action.h"
+#include "core/Runtime.h"
 
 namespace chaos {
 namespace core {
@@ -31,7 +32,19 @@ public:
         return folly::stringPrintf("wait %ldms", waitTimeMs_);
     }
 
+    bool isBlocking() const override {
+        return false;
+    }
+
 protected:
+    // Wait on the timer of the runtime, no thread is held meanwhile.
+    void doRunAsync(Runtime* runtime, DoneCallback done) override {
+        runtime->runAfter(std::chrono::milliseconds(waitTimeMs_),
+                          [done = std::move(done)] () mutable {
+            done(ResultCode::OK);
+        });
+    }
+
     uint64_t waitTimeMs_ = 0;
 };
 
@@ -8,10 +8,16 @@
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <folly/init/Init.h>
+#include <folly/json.h>
+#include "core/ChaosPlan.h"
 #include "core/CheckProcAction.h"
 #include "core/SendEmailAction.h"
 #include "core/LoopAction.h"
 #include "core/AssignAction.h"
+#include "core/RunTaskAction.h"
+#include "core/DagScheduler.h"
+#include "core/Runtime.h"
+#include "core/WaitAction.h"
 
 namespace chaos {
 namespace core {
@@ -71,6 +77,251 @@ TEST(ActionsTest, AssignActionTest) {
     CHECK_EQ(7, ExprUtils::asInt(valOrErr.value()));
 }
 
+TEST(ActionsTest, DagSchedulerTest) {
+    Runtime runtime(4);
+    {
+        // Layers of 100 actions, each action depends on every action of the last layer.
+        std::vector<ActionPtr> owners;
+        std::vector<Action*> actions;
+        std::vector<Action*> lastLayer;
+        for (int32_t layer = 0; layer < 100; layer++) {
+            std::vector<Action*> curLayer;
+            for (int32_t i = 0; i < 100; i++) {
+                owners.emplace_back(std::make_unique<EmptyAction>());
+                auto* action = owners.back().get();
+                action->setId(owners.size() - 1);
+                for (auto* dee : lastLayer) {
+                    action->addDependee(dee);
+                }
+                curLayer.emplace_back(action);
+                actions.emplace_back(action);
+            }
+            lastLayer = std::move(curLayer);
+        }
+        DagScheduler scheduler(&runtime);
+        EXPECT_TRUE(scheduler.run(actions));
+        for (auto* action : actions) {
+            EXPECT_EQ(Action::Status::SUCCEEDED, action->status());
+        }
+        auto stats = scheduler.stats();
+        EXPECT_EQ(10000UL, stats.actions);
+        LOG(INFO) << "Scheduling overhead: " << stats.toString();
+    }
+    {
+        // action2 fails, action3 depends on it and should not run.
+        std::atomic<int32_t> runTimes{0};
+        auto action1 = std::make_unique<RunTaskAction>([&runTimes] {
+            runTimes++;
+            return ResultCode::OK;
+        }, "action1");
+        auto action2 = std::make_unique<RunTaskAction>([&runTimes] {
+            runTimes++;
+            return ResultCode::ERR_FAILED;
+        }, "action2");
+        auto action3 = std::make_unique<RunTaskAction>([&runTimes] {
+            runTimes++;
+            return ResultCode::OK;
+        }, "action3");
+        action2->addDependee(action1.get());
+        action3->addDependee(action2.get());
+        DagScheduler scheduler(&runtime);
+        EXPECT_FALSE(scheduler.run({action1.get(), action2.get(), action3.get()}));
+        EXPECT_EQ(2, runTimes.load());
+        EXPECT_EQ(Action::Status::SUCCEEDED, action1->status());
+        EXPECT_EQ(Action::Status::FAILED, action2->status());
+        EXPECT_EQ(Action::Status::FAILED, action3->status());
+    }
+    {
+        // Cycle is refused.
+        auto action1 = std::make_unique<EmptyAction>("action1");
+        auto action2 = std::make_unique<EmptyAction>("action2");
+        action1->addDependee(action2.get());
+        action2->addDependee(action1.get());
+        DagScheduler scheduler(&runtime);
+        EXPECT_FALSE(scheduler.run({action1.get(), action2.get()}));
+        EXPECT_EQ(Action::Status::INIT, action1->status());
+    }
+}
+
+TEST(ActionsTest, RuntimeTest) {
+    {
+        // The blocking actions never exceed the limit of actions in flight.
+        Runtime runtime(2);
+        std::atomic<int32_t> running{0};
+        std::atomic<int32_t> maxRunning{0};
+        std::vector<ActionPtr> owners;
+        std::vector<Action*> actions;
+        for (int32_t i = 0; i < 20; i++) {
+            owners.emplace_back(std::make_unique<RunTaskAction>([&running, &maxRunning] {
+                auto cur = ++running;
+                auto max = maxRunning.load();
+                while (cur > max && !maxRunning.compare_exchange_weak(max, cur)) {
+                }
+                usleep(10 * 1000);
+                running--;
+                return ResultCode::OK;
+            }, "sleep"));
+            actions.emplace_back(owners.back().get());
+        }
+        DagScheduler scheduler(&runtime, 3);
+        EXPECT_TRUE(scheduler.run(actions));
+        EXPECT_LE(maxRunning.load(), 3);
+        EXPECT_LE(runtime.blockingThreads(), 3UL);
+    }
+    {
+        // Nested loops on a single worker, the sub plans run on the standby threads.
+        Runtime runtime(1);
+        ActionContext ctx;
+        ctx.exprCtx.setVar("i", 0L);
+        ctx.exprCtx.setVar("j", 0L);
+        std::vector<ActionPtr> inner;
+        inner.emplace_back(std::make_unique<AssignAction>(&ctx, "j", "$j + 1"));
+        std::vector<ActionPtr> outer;
+        outer.emplace_back(std::make_unique<AssignAction>(&ctx, "j", "0"));
+        outer.emplace_back(std::make_unique<LoopAction>(&ctx, "$j < 5", std::move(inner), 2));
+        outer.emplace_back(std::make_unique<AssignAction>(&ctx, "i", "$i + 1"));
+        outer[1]->addDependee(outer[0].get());
+        outer[2]->addDependee(outer[1].get());
+        LoopAction loop(&ctx, "$i < 3", std::move(outer), 2);
+        DagScheduler scheduler(&runtime);
+        EXPECT_TRUE(scheduler.run({&loop}));
+        EXPECT_EQ(3, ExprUtils::asInt(ctx.exprCtx.getVar("i").value()));
+        EXPECT_EQ(5, ExprUtils::asInt(ctx.exprCtx.getVar("j").value()));
+        EXPECT_EQ(0UL, runtime.blockingThreads());
+    }
+    {
+        // The standby threads are reused, thousands of waits start only a few of them.
+        Runtime runtime(2);
+        ActionContext ctx;
+        ctx.exprCtx.setVar("i", 0L);
+        ctx.exprCtx.setVar("j", 0L);
+        std::vector<ActionPtr> inner;
+        inner.emplace_back(std::make_unique<AssignAction>(&ctx, "j", "$j + 1"));
+        std::vector<ActionPtr> outer;
+        outer.emplace_back(std::make_unique<AssignAction>(&ctx, "j", "0"));
+        outer.emplace_back(std::make_unique<LoopAction>(&ctx, "$j < 10", std::move(inner), 1));
+        outer.emplace_back(std::make_unique<AssignAction>(&ctx, "i", "$i + 1"));
+        outer[1]->addDependee(outer[0].get());
+        outer[2]->addDependee(outer[1].get());
+        LoopAction loop(&ctx, "$i < 200", std::move(outer), 1);
+        DagScheduler scheduler(&runtime);
+        EXPECT_TRUE(scheduler.run({&loop}));
+        EXPECT_EQ(200, ExprUtils::asInt(ctx.exprCtx.getVar("i").value()));
+        EXPECT_LE(runtime.standbyThreads(), 8UL);
+    }
+    {
+        // The waiter resumes once woken up, it doesn't wait for the tasks of its standby.
+        Runtime runtime(1);
+        folly::Baton<> baton;
+        folly::Baton<> resumed;
+        folly::Baton<> longDone;
+        std::atomic<bool> longFinished{false};
+        runtime.add([&] {
+            runtime.add([&] {
+                usleep(300 * 1000);
+                longFinished = true;
+                longDone.post();
+            });
+            runtime.wait(baton);
+            EXPECT_FALSE(longFinished.load());
+            resumed.post();
+        });
+        usleep(50 * 1000);
+        baton.post();
+        resumed.wait();
+        longDone.wait();
+    }
+}
+
+class CountDisturbAction : public DisturbAction {
+public:
+    explicit CountDisturbAction(int32_t loopTimes)
+        : DisturbAction(loopTimes, 0, 0) {}
+
+    std::string toString() override {
+        return "Count disturb";
+    }
+
+    std::atomic<int32_t> disturbTimes{0};
+    std::atomic<int32_t> recoverTimes{0};
+
+protected:
+    ResultCode disturb() override {
+        EXPECT_EQ(disturbTimes.load(), recoverTimes.load());
+        disturbTimes++;
+        setDetail(folly::stringPrintf("disturb %d", disturbTimes.load()));
+        return ResultCode::OK;
+    }
+
+    ResultCode recover() override {
+        EXPECT_EQ(folly::stringPrintf("disturb %d", disturbTimes.load()), detail());
+        recoverTimes++;
+        return ResultCode::OK;
+    }
+};
+
+TEST(ActionsTest, TimerTest) {
+    {
+        // Pending waits hold no thread, 50 waits of 200ms on one worker finish together.
+        Runtime runtime(1);
+        std::vector<ActionPtr> owners;
+        std::vector<Action*> actions;
+        for (int32_t i = 0; i < 50; i++) {
+            owners.emplace_back(std::make_unique<WaitAction>(200));
+            actions.emplace_back(owners.back().get());
+        }
+        auto start = Clock::now();
+        DagScheduler scheduler(&runtime);
+        EXPECT_TRUE(scheduler.run(actions));
+        auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+                Clock::now() - start).count();
+        EXPECT_LT(cost, 2000);
+        EXPECT_EQ(0UL, runtime.blockingThreads());
+    }
+    {
+        Runtime runtime(1);
+        CountDisturbAction action(3);
+        DagScheduler scheduler(&runtime);
+        EXPECT_TRUE(scheduler.run({&action}));
+        EXPECT_EQ(3, action.disturbTimes.load());
+        EXPECT_EQ(3, action.recoverTimes.load());
+        EXPECT_EQ("", action.detail());
+    }
+}
+
+TEST(ActionsTest, PlanStatusTest) {
+    ChaosPlan plan(2);
+    std::string live;
+    auto* p = &plan;
+    plan.addAction(std::make_unique<RunTaskAction>([p, &live] {
+        live = p->statusJson();
+        return ResultCode::OK;
+    }, "probe"));
+    EXPECT_EQ("init", folly::parseJson(plan.statusJson())["status"].asString());
+    plan.schedule();
+    {
+        // Seen by the action itself while the plan is running.
+        auto status = folly::parseJson(live);
+        EXPECT_EQ("running", status["status"].asString());
+        ASSERT_EQ(1UL, status["running"].size());
+        EXPECT_EQ(0, status["running"][0]["id"].asInt());
+        EXPECT_EQ("probe", status["running"][0]["desc"].asString());
+    }
+    {
+        auto status = folly::parseJson(plan.statusJson());
+        EXPECT_EQ("succeeded", status["status"].asString());
+        EXPECT_EQ(0UL, status["running"].size());
+        // The probe, the sink and the source.
+        ASSERT_EQ(3UL, status["actions"].size());
+        for (const auto& action : status["actions"]) {
+            EXPECT_EQ("succeeded", action["status"].asString());
+            EXPECT_EQ(1, action["runs"].asInt());
+            EXPECT_LE(action["start_ms"].asInt(), action["end_ms"].asInt());
+        }
+        EXPECT_EQ("RunTaskAction", status["actions"][0]["type"].asString());
+    }
+}
+
 }  // namespace core
 }  // namespace chaos
 
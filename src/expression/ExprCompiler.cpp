@@ -0,0 +1,149 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "expression/ExprCompiler.h"
+#include <folly/small_vector.h>
+
+namespace chaos {
+
+namespace {
+
+// The conditions of the plans are shallow, their stack never touches the heap.
+constexpr size_t kInlineDepth = 16;
+
+using Stack = folly::small_vector<Value, kInlineDepth>;
+
+// Pop the right operand, the result replaces the left one on success.
+template <typename Expr>
+ValueOrErr reduce(Stack& stack, uint8_t op) {
+    DCHECK_GE(stack.size(), 2UL);
+    auto valOrErr = Expr::compute(stack[stack.size() - 2],
+                                  static_cast<typename Expr::Operator>(op),
+                                  stack.back());
+    stack.pop_back();
+    return valOrErr;
+}
+
+}   // namespace
+
+ValueOrErr CompiledExpr::eval(ExprContext* ctx) const {
+    if (ctx == nullptr) {
+        LOG(INFO) << "The expr context is nullptr";
+        return folly::makeUnexpected(ErrorCode::ERR_BAD_PARAMS);
+    }
+    Stack stack;
+    stack.reserve(maxDepth_);
+    for (const auto& ins : code_) {
+        ValueOrErr valOrErr;
+        switch (ins.code) {
+            case kPushConst:
+                stack.emplace_back(constants_[ins.arg]);
+                continue;
+            case kLoadVar:
+                valOrErr = ctx->getVar(static_cast<VarSlot>(ins.arg));
+                if (!valOrErr) {
+                    return valOrErr;
+                }
+                stack.emplace_back(std::move(valOrErr).value());
+                continue;
+            case kUnary:
+                DCHECK(!stack.empty());
+                valOrErr = UnaryExpression::compute(
+                        static_cast<UnaryExpression::Operator>(ins.op), stack.back());
+                break;
+            case kArithmetic:
+                valOrErr = reduce<ArithmeticExpression>(stack, ins.op);
+                break;
+            case kRelational:
+                valOrErr = reduce<RelationalExpression>(stack, ins.op);
+                break;
+            case kLogical:
+                valOrErr = reduce<LogicalExpression>(stack, ins.op);
+                break;
+        }
+        if (!valOrErr) {
+            return valOrErr;
+        }
+        stack.back() = std::move(valOrErr).value();
+    }
+    DCHECK_EQ(1UL, stack.size());
+    return std::move(stack.back());
+}
+
+// static
+std::unique_ptr<CompiledExpr> ExprCompiler::compile(const Expression* expr, ExprContext* ctx) {
+    if (expr == nullptr || ctx == nullptr) {
+        return nullptr;
+    }
+    std::unique_ptr<CompiledExpr> compiled(new CompiledExpr());
+    if (!emit(expr, ctx, 0, compiled.get())) {
+        return nullptr;
+    }
+    return compiled;
+}
+
+// static
+bool ExprCompiler::emit(const Expression* expr,
+                        ExprContext* ctx,
+                        size_t depth,
+                        CompiledExpr* compiled) {
+    auto& code = compiled->code_;
+    compiled->maxDepth_ = std::max(compiled->maxDepth_, depth + 1);
+    switch (expr->type()) {
+        case Expression::kConstant: {
+            auto* constant = static_cast<const ConstantExpression*>(expr);
+            compiled->constants_.emplace_back(constant->operand_);
+            uint32_t index = compiled->constants_.size() - 1;
+            code.push_back({CompiledExpr::kPushConst, 0, index});
+            return true;
+        }
+        case Expression::kVariable: {
+            auto* variable = static_cast<const VariableExpression*>(expr);
+            code.push_back({CompiledExpr::kLoadVar, 0, ctx->slot(variable->varName_)});
+            return true;
+        }
+        case Expression::kUnary: {
+            auto* unary = static_cast<const UnaryExpression*>(expr);
+            if (!emit(unary->operand_.get(), ctx, depth, compiled)) {
+                return false;
+            }
+            code.push_back({CompiledExpr::kUnary, unary->op_, 0});
+            return true;
+        }
+        case Expression::kArithmetic: {
+            auto* arith = static_cast<const ArithmeticExpression*>(expr);
+            if (!emit(arith->left_.get(), ctx, depth, compiled)
+                    || !emit(arith->right_.get(), ctx, depth + 1, compiled)) {
+                return false;
+            }
+            code.push_back({CompiledExpr::kArithmetic, arith->op_, 0});
+            return true;
+        }
+        case Expression::kRelational: {
+            auto* rel = static_cast<const RelationalExpression*>(expr);
+            if (!emit(rel->left_.get(), ctx, depth, compiled)
+                    || !emit(rel->right_.get(), ctx, depth + 1, compiled)) {
+                return false;
+            }
+            code.push_back({CompiledExpr::kRelational, rel->op_, 0});
+            return true;
+        }
+        case Expression::kLogical: {
+            auto* logical = static_cast<const LogicalExpression*>(expr);
+            if (!emit(logical->left_.get(), ctx, depth, compiled)
+                    || !emit(logical->right_.get(), ctx, depth + 1, compiled)) {
+                return false;
+            }
+            code.push_back({CompiledExpr::kLogical, logical->op_, 0});
+            return true;
+        }
+        default:
+            LOG(ERROR) << "Unknown expression type " << expr->typeStr();
+            return false;
+    }
+}
+
+}   // namespace chaos
@@ -0,0 +1,80 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef EXPRESSION_EXPRCOMPILER_H_
+#define EXPRESSION_EXPRCOMPILER_H_
+
+#include "common/base/Base.h"
+#include "expression/Expressions.h"
+
+namespace chaos {
+
+/**
+ * An expression compiled into a stack bytecode.
+ *
+ * The variables are resolved to the slots of the context when compiling, so the
+ * evaluation neither walks the tree nor looks up any variable by name.
+ * It has the same semantics as Expression::eval, including evaluating both
+ * sides of the logical operators.
+ * */
+class CompiledExpr final {
+    friend class ExprCompiler;
+
+public:
+    // ctx must be the context the expression was compiled for.
+    ValueOrErr eval(ExprContext* ctx) const;
+
+    size_t codeSize() const {
+        return code_.size();
+    }
+
+    // The max depth of the stack when evaluating.
+    size_t maxDepth() const {
+        return maxDepth_;
+    }
+
+private:
+    enum OpCode : uint8_t {
+        kPushConst,     // push constants_[arg]
+        kLoadVar,       // push the variable in slot arg
+        kUnary,         // pop one, push op(value)
+        kArithmetic,    // pop two, push left op right
+        kRelational,
+        kLogical,
+    };
+
+    struct Instruction {
+        OpCode      code;
+        // The operator of the expression, see the Operator of each expression.
+        uint8_t     op;
+        uint32_t    arg;
+    };
+
+    CompiledExpr() = default;
+
+private:
+    std::vector<Instruction>    code_;
+    std::vector<Value>          constants_;
+    size_t                      maxDepth_{0};
+};
+
+class ExprCompiler final {
+public:
+    // Compile the expression for ctx, return nullptr if it contains unknown nodes.
+    static std::unique_ptr<CompiledExpr> compile(const Expression* expr, ExprContext* ctx);
+
+private:
+    ExprCompiler() = default;
+
+    // Emit the code in post order, depth is the stack depth before the node runs.
+    static bool emit(const Expression* expr,
+                     ExprContext* ctx,
+                     size_t depth,
+                     CompiledExpr* compiled);
+};
+
+}   // namespace chaos
+#endif  // EXPRESSION_EXPRCOMPILER_H_
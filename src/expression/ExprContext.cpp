@@ -0,0 +1,137 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "expression/ExprContext.h"
+#include <folly/portability/Asm.h>
+
+namespace chaos {
+
+ExprContext::~ExprContext() {
+    for (auto& chunk : chunks_) {
+        delete chunk.load(std::memory_order_relaxed);
+    }
+}
+
+VarSlot ExprContext::slot(const std::string& name) {
+    {
+        folly::SharedMutex::ReadHolder rh(namesLock_);
+        auto it = names_.find(name);
+        if (it != names_.end()) {
+            return it->second;
+        }
+    }
+    folly::SharedMutex::WriteHolder wh(namesLock_);
+    auto it = names_.find(name);
+    if (it != names_.end()) {
+        return it->second;
+    }
+    auto slot = size_.load(std::memory_order_relaxed);
+    auto chunkIndex = slot / kChunkSize;
+    if (chunkIndex >= kMaxChunks) {
+        LOG(FATAL) << "Too many variables, at most " << kChunkSize * kMaxChunks;
+    }
+    if (slot % kChunkSize == 0) {
+        chunks_[chunkIndex].store(new Chunk(), std::memory_order_release);
+    }
+    names_.emplace(name, slot);
+    size_.store(slot + 1, std::memory_order_release);
+    return slot;
+}
+
+ValueOrErr ExprContext::getVar(const std::string& name) const {
+    VarSlot slot;
+    {
+        folly::SharedMutex::ReadHolder rh(namesLock_);
+        auto it = names_.find(name);
+        if (it == names_.end()) {
+            return folly::makeUnexpected(ErrorCode::ERR_NULL);
+        }
+        slot = it->second;
+    }
+    return getVar(slot);
+}
+
+ValueOrErr ExprContext::getVar(VarSlot slot) const {
+    DCHECK_LT(slot, size());
+    auto* s = slotPtr(slot);
+    while (true) {
+        auto seq = s->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            folly::asm_volatile_pause();
+            continue;
+        }
+        auto which = s->which.load(std::memory_order_relaxed);
+        auto bits = s->bits.load(std::memory_order_relaxed);
+        std::shared_ptr<const std::string> str;
+        if (which == VAR_STR) {
+            str = std::atomic_load_explicit(&s->str, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s->seq.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+        switch (which) {
+            case VAR_INT64:
+                return static_cast<int64_t>(bits);
+            case VAR_DOUBLE: {
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                return d;
+            }
+            case VAR_BOOL:
+                return bits != 0;
+            case VAR_STR:
+                DCHECK(str != nullptr);
+                return *str;
+            default:
+                return folly::makeUnexpected(ErrorCode::ERR_NULL);
+        }
+    }
+}
+
+void ExprContext::setVar(const std::string& name, Value val) {
+    setVar(slot(name), std::move(val));
+}
+
+void ExprContext::setVar(VarSlot slot, Value val) {
+    DCHECK_LT(slot, size());
+    auto* s = slotPtr(slot);
+    // Build the string before entering the critical section, readers spin in it.
+    uint64_t bits = 0;
+    std::shared_ptr<const std::string> str;
+    switch (val.which()) {
+        case VAR_INT64:
+            bits = static_cast<uint64_t>(boost::get<int64_t>(val));
+            break;
+        case VAR_DOUBLE: {
+            auto d = boost::get<double>(val);
+            memcpy(&bits, &d, sizeof(d));
+            break;
+        }
+        case VAR_BOOL:
+            bits = boost::get<bool>(val) ? 1 : 0;
+            break;
+        case VAR_STR:
+            str = std::make_shared<const std::string>(
+                    std::move(boost::get<std::string>(val)));
+            break;
+    }
+
+    auto seq = s->seq.load(std::memory_order_relaxed);
+    while ((seq & 1)
+            || !s->seq.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed)) {
+        folly::asm_volatile_pause();
+        seq = s->seq.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    s->which.store(val.which(), std::memory_order_relaxed);
+    s->bits.store(bits, std::memory_order_relaxed);
+    // The old string is released by whoever drops the last reference.
+    std::atomic_store_explicit(&s->str, std::move(str), std::memory_order_relaxed);
+    s->seq.store(seq + 2, std::memory_order_release);
+}
+
+}   // namespace chaos
@@ -0,0 +1,92 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef EXPRESSION_EXPRCONTEXT_H_
+#define EXPRESSION_EXPRCONTEXT_H_
+
+#include "common/base/Base.h"
+#include <folly/SharedMutex.h>
+#include "expression/ExprUtils.h"
+
+namespace chaos {
+
+// The index of a variable in its context.
+using VarSlot = uint32_t;
+
+/**
+ * The variables shared by all actions of a plan, which run concurrently.
+ *
+ * Every variable lives in a fixed slot, the slots are allocated in chunks which
+ * never move, so a slot resolved at load time is read without any lock.
+ * Each slot is guarded by a seqlock: the integer, double and bool values are
+ * stored inline, the strings are shared_ptr swapped atomically. Readers retry
+ * if a writer raced with them, writers of the same slot are serialized.
+ *
+ * The names are only looked up when resolving a slot, behind a shared mutex.
+ * */
+class ExprContext {
+public:
+    ExprContext() = default;
+
+    virtual ~ExprContext();
+
+    ExprContext(const ExprContext&) = delete;
+    ExprContext& operator=(const ExprContext&) = delete;
+
+    // Return the slot of the variable, create an empty one if it doesn't exist.
+    // The slot of a name never changes during the life of the context.
+    VarSlot slot(const std::string& name);
+
+    virtual ValueOrErr getVar(const std::string& name) const;
+
+    ValueOrErr getVar(VarSlot slot) const;
+
+    // insert or overwrite the variable named "name"
+    virtual void setVar(const std::string& name, Value val);
+
+    void setVar(VarSlot slot, Value val);
+
+    size_t size() const {
+        return size_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kChunkSize = 64;
+    static constexpr size_t kMaxChunks = 1024;
+    static constexpr int32_t kNull = -1;
+
+    struct Slot {
+        // Odd while a writer is updating the slot.
+        std::atomic<uint64_t>               seq{0};
+        // Value::which() of the value, kNull if never set.
+        std::atomic<int32_t>                which{kNull};
+        // The bits of an int64, a double or a bool.
+        std::atomic<uint64_t>               bits{0};
+        // Only accessed by std::atomic_load/std::atomic_store.
+        std::shared_ptr<const std::string>  str;
+    };
+
+    struct Chunk {
+        Slot slots[kChunkSize];
+    };
+
+    Slot* slotPtr(VarSlot slot) const {
+        auto* chunk = chunks_[slot / kChunkSize].load(std::memory_order_acquire);
+        DCHECK(chunk != nullptr) << "Slot " << slot << " is not allocated";
+        return &chunk->slots[slot % kChunkSize];
+    }
+
+private:
+    std::atomic<Chunk*>                         chunks_[kMaxChunks] = {};
+    std::atomic<size_t>                         size_{0};
+
+    // Protect the names, readers by slot never take it.
+    mutable folly::SharedMutex                  namesLock_;
+    std::unordered_map<std::string, VarSlot>    names_;
+};
+
+}   // namespace chaos
+#endif  // EXPRESSION_EXPRCONTEXT_H_
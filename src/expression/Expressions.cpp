@@ -76,10 +76,14 @@ ValueOrErr UnaryExpression::eval(ExprContext* ctx) const {
     if (!valOrErr) {
         return valOrErr;
     }
-    auto value = valOrErr.value();
-    if (op_ == PLUS) {
+    return compute(op_, valOrErr.value());
+}
+
+// static
+ValueOrErr UnaryExpression::compute(Operator op, const Value& value) {
+    if (op == PLUS) {
         return value;
-    } else if (op_ == NEGATE) {
+    } else if (op == NEGATE) {
         if (ExprUtils::isInt(value)) {
             return -ExprUtils::asInt(value);
         } else if (ExprUtils::isDouble(value)) {
@@ -127,9 +131,11 @@ ValueOrErr ArithmeticExpression::eval(ExprContext* ctx) const {
     if (!rValOrErr) {
         return rValOrErr;
     }
-    auto l = lValOrErr.value();
-    auto r = rValOrErr.value();
+    return compute(lValOrErr.value(), op_, rValOrErr.value());
+}
 
+// static
+ValueOrErr ArithmeticExpression::compute(const Value& l, Operator op, const Value& r) {
     static constexpr int64_t maxInt = std::numeric_limits<int64_t>::max();
     static constexpr int64_t minInt = std::numeric_limits<int64_t>::min();
 
@@ -167,7 +173,7 @@ ValueOrErr ArithmeticExpression::eval(ExprContext* ctx) const {
         }
     };
 
-    switch (op_) {
+    switch (op) {
         case ADD:
             if (ExprUtils::isArithmetic(l) && ExprUtils::isArithmetic(r)) {
                 if (ExprUtils::isDouble(l) || ExprUtils::isDouble(r)) {
@@ -285,10 +291,12 @@ ValueOrErr RelationalExpression::eval(ExprContext* ctx) const {
     if (!rValOrErr) {
         return rValOrErr;
     }
-    auto l = lValOrErr.value();
-    auto r = rValOrErr.value();
+    return compute(lValOrErr.value(), op_, rValOrErr.value());
+}
 
-    switch (op_) {
+// static
+ValueOrErr RelationalExpression::compute(const Value& l, Operator op, const Value& r) {
+    switch (op) {
         case LT:
             return l < r;
         case LE:
@@ -347,23 +355,26 @@ ValueOrErr LogicalExpression::eval(ExprContext* ctx) const {
     if (!rValOrErr) {
         return rValOrErr;
     }
-    auto l = lValOrErr.value();
-    auto r = rValOrErr.value();
+    return compute(lValOrErr.value(), op_, rValOrErr.value());
+}
+
+// static
+ValueOrErr LogicalExpression::compute(const Value& l, Operator op, const Value& r) {
     VLOG(3) << "left: " << ExprUtils::asBool(l)
             << ", right:" << ExprUtils::asBool(r)
-            << ", op " << static_cast<int32_t>(op_);
-    if (op_ == AND) {
+            << ", op " << static_cast<int32_t>(op);
+    if (op == AND) {
         if (!ExprUtils::asBool(l)) {
             return false;
         }
         return ExprUtils::asBool(r);
-    } else if (op_ == OR) {
+    } else if (op == OR) {
         if (ExprUtils::asBool(l)) {
             return true;
         }
         return ExprUtils::asBool(r);
     } else {
-        // op_ == XOR
+        // op == XOR
         return ExprUtils::asBool(l) != ExprUtils::asBool(r);
     }
 }
@@ -8,30 +8,12 @@
 #define EXPRESSION_EXPRESSIONS_H_
 
 #include "common/base/Base.h"
+#include "expression/ExprContext.h"
 #include "expression/ExprUtils.h"
 
 namespace chaos {
 
-class ExprContext {
-public:
-    virtual ValueOrErr getVar(const std::string& name) const {
-        auto it = variables_.find(name);
-        if (it == variables_.end()) {
-            return folly::makeUnexpected(ErrorCode::ERR_NULL);
-        }
-        return it->second;
-    }
-
-    // insert or overwrite the variable named "name"
-    virtual void setVar(const std::string& name, Value val) {
-        variables_[name] = std::move(val);
-    }
-
-    virtual ~ExprContext() = default;
-
-private:
-    std::unordered_map<std::string, Value> variables_;
-};
+class ExprCompiler;
 
 class Expression {
 public:
@@ -81,6 +63,8 @@ protected:
 
 // literal constants: bool, integer, double, string
 class ConstantExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     explicit ConstantExpression(bool val) {
         type_ = kConstant;
@@ -111,6 +95,8 @@ private:
 };
 
 class VariableExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     explicit VariableExpression(std::string valName) {
         type_ = kVariable;
@@ -129,6 +115,8 @@ private:
 
 // +expr, -expr, !expr
 class UnaryExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     enum Operator : uint8_t {
         PLUS, NEGATE, NOT
@@ -145,6 +133,9 @@ public:
 
     ValueOrErr eval(ExprContext*) const override;
 
+    // Shared by the tree and the compiled expression.
+    static ValueOrErr compute(Operator op, const Value& value);
+
 private:
     std::string opStr() const {
         switch (op_) {
@@ -166,6 +157,8 @@ private:
 
 // +, -, *, /, %
 class ArithmeticExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     enum Operator : uint8_t {
         ADD, SUB, MUL, DIV, MOD
@@ -183,6 +176,8 @@ public:
 
     ValueOrErr eval(ExprContext*) const override;
 
+    static ValueOrErr compute(const Value& l, Operator op, const Value& r);
+
 private:
     std::string opStr() const {
         switch (op_) {
@@ -209,6 +204,8 @@ private:
 
 // <, <=, >, >=, ==, !=
 class RelationalExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     enum Operator : uint8_t {
         LT, LE, GT, GE, EQ, NE
@@ -224,6 +221,8 @@ public:
 
     ValueOrErr eval(ExprContext*) const override;
 
+    static ValueOrErr compute(const Value& l, Operator op, const Value& r);
+
     std::string toString() override;
 
     std::string opStr() const {
@@ -254,6 +253,8 @@ private:
 
 // &&, ||, ^
 class LogicalExpression final : public Expression {
+    friend class ExprCompiler;
+
 public:
     enum Operator : uint8_t {
         AND, OR, XOR
@@ -269,6 +270,8 @@ public:
 
     ValueOrErr eval(ExprContext*) const override;
 
+    static ValueOrErr compute(const Value& l, Operator op, const Value& r);
+
     std::string toString() override;
 
     std::string opStr() const {
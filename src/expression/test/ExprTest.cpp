@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <folly/init/Init.h>
+#include <thread>
 #include "expression/Expressions.h"
 
 namespace chaos {
@@ -33,6 +34,69 @@ TEST(ExprTest, ExprTest) {
     }
 }
 
+TEST(ExprTest, ExprContextTest) {
+    ExprContext ctx;
+    EXPECT_FALSE(ctx.getVar("a"));
+    auto a = ctx.slot("a");
+    EXPECT_EQ(a, ctx.slot("a"));
+    EXPECT_FALSE(ctx.getVar(a));
+    ctx.setVar(a, 1.5);
+    EXPECT_EQ(Value(1.5), ctx.getVar("a").value());
+    ctx.setVar("a", std::string("str"));
+    EXPECT_EQ(Value(std::string("str")), ctx.getVar(a).value());
+    ctx.setVar("a", false);
+    EXPECT_EQ(Value(false), ctx.getVar(a).value());
+
+    // Readers never see a torn value, while the writers change the types and
+    // new variables are added concurrently.
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int32_t w = 0; w < 2; w++) {
+        threads.emplace_back([&ctx, a] {
+            for (int64_t i = 0; i < 100000; i++) {
+                if (i % 2 == 0) {
+                    ctx.setVar(a, i);
+                } else {
+                    ctx.setVar(a, folly::to<std::string>(i));
+                }
+            }
+        });
+    }
+    threads.emplace_back([&ctx] {
+        for (int32_t i = 0; i < 1000; i++) {
+            ctx.setVar(folly::stringPrintf("var_%d", i), static_cast<int64_t>(i));
+        }
+    });
+    std::atomic<int64_t> reads{0};
+    for (int32_t r = 0; r < 2; r++) {
+        threads.emplace_back([&ctx, &stop, &reads, a] {
+            while (!stop.load()) {
+                auto val = ctx.getVar(a).value();
+                if (ExprUtils::isInt(val)) {
+                    EXPECT_EQ(0, ExprUtils::asInt(val) % 2);
+                } else if (ExprUtils::isString(val)) {
+                    EXPECT_EQ(1, folly::to<int64_t>(ExprUtils::asString(val)) % 2);
+                } else {
+                    EXPECT_EQ(Value(false), val);
+                }
+                reads++;
+            }
+        });
+    }
+    for (size_t i = 0; i < 3; i++) {
+        threads[i].join();
+    }
+    stop = true;
+    for (size_t i = 3; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    EXPECT_EQ(1001UL, ctx.size());
+    for (int32_t i = 0; i < 1000; i++) {
+        EXPECT_EQ(i, ExprUtils::asInt(ctx.getVar(folly::stringPrintf("var_%d", i)).value()));
+    }
+    LOG(INFO) << reads.load() << " reads during the writes";
+}
+
 }  // namespace chaos
 
 int main(int argc, char** argv) {
@@ -0,0 +1,116 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "nebula/ActionRegistry.h"
+#include <dlfcn.h>
+
+DEFINE_string(action_plugins, "",
+              "The shared objects registering more action types, separated by comma");
+
+namespace chaos {
+namespace nebula_chaos {
+
+// static
+ActionRegistry& ActionRegistry::instance() {
+    // Never destroyed, the plugins may still refer to it at exit.
+    static auto* registry = new ActionRegistry();
+    return *registry;
+}
+
+bool ActionRegistry::add(const std::string& type, ActionSchema schema, ActionFactory factory) {
+    CHECK(factory != nullptr) << "No factory for " << type;
+    folly::SharedMutex::WriteHolder wh(lock_);
+    if (ids_.find(type) != ids_.end()) {
+        LOG(ERROR) << "The action type " << type << " has been registered";
+        return false;
+    }
+    auto entry = std::make_unique<Entry>();
+    entry->type = type;
+    entry->keys.emplace("type");
+    entry->keys.emplace("depends");
+    entry->keys.insert(schema.required.begin(), schema.required.end());
+    entry->keys.insert(schema.optional.begin(), schema.optional.end());
+    entry->schema = std::move(schema);
+    entry->factory = std::move(factory);
+    ids_.emplace(type, entries_.size());
+    entries_.emplace_back(std::move(entry));
+    return true;
+}
+
+ActionRegistry::TypeId ActionRegistry::typeId(const std::string& type) const {
+    folly::SharedMutex::ReadHolder rh(lock_);
+    auto it = ids_.find(type);
+    return it == ids_.end() ? kUnknownType : it->second;
+}
+
+const ActionRegistry::Entry& ActionRegistry::entry(TypeId id) const {
+    folly::SharedMutex::ReadHolder rh(lock_);
+    CHECK_LT(id, entries_.size());
+    return *entries_[id];
+}
+
+bool ActionRegistry::validate(TypeId id, const folly::dynamic& obj) const {
+    const auto& e = entry(id);
+    if (!obj.isObject()) {
+        LOG(ERROR) << "The action " << e.type << " is not an object";
+        return false;
+    }
+    for (const auto& key : e.schema.required) {
+        if (obj.count(key) == 0) {
+            LOG(ERROR) << "The action " << e.type << " misses the key \"" << key << "\"";
+            return false;
+        }
+    }
+    for (const auto& item : obj.items()) {
+        if (!item.first.isString() || e.keys.count(item.first.getString()) == 0) {
+            LOG(WARNING) << "Unknown key " << item.first << " of the action " << e.type;
+        }
+    }
+    return true;
+}
+
+core::ActionPtr ActionRegistry::create(TypeId id,
+                                       const folly::dynamic& obj,
+                                       const LoadContext& ctx) const {
+    return entry(id).factory(obj, ctx);
+}
+
+std::vector<std::string> ActionRegistry::types() const {
+    folly::SharedMutex::ReadHolder rh(lock_);
+    std::vector<std::string> types;
+    types.reserve(entries_.size());
+    for (const auto& e : entries_) {
+        types.emplace_back(e->type);
+    }
+    return types;
+}
+
+bool ActionRegistry::loadPlugin(const std::string& path) {
+    auto before = types().size();
+    // The handle is never closed, the factories live in the plugin.
+    auto* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_GLOBAL);
+    if (handle == nullptr) {
+        LOG(ERROR) << "Load the action plugin " << path << " failed: " << dlerror();
+        return false;
+    }
+    LOG(INFO) << "Load the action plugin " << path << ", "
+              << types().size() - before << " types registered";
+    return true;
+}
+
+void ActionRegistry::loadPlugins() {
+    std::call_once(pluginsOnce_, [this] {
+        std::vector<std::string> paths;
+        folly::split(",", FLAGS_action_plugins, paths, true);
+        for (auto& path : paths) {
+            CHECK(loadPlugin(folly::trimWhitespace(path).str()))
+                << "Load the action plugin " << path << " failed!";
+        }
+    });
+}
+
+}   // namespace nebula_chaos
+}   // namespace chaos
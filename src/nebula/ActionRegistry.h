@@ -0,0 +1,102 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef NEBULA_ACTIONREGISTRY_H_
+#define NEBULA_ACTIONREGISTRY_H_
+
+#include "common/base/Base.h"
+#include <folly/SharedMutex.h>
+#include <folly/dynamic.h>
+#include "core/Action.h"
+
+DECLARE_string(action_plugins);
+
+namespace chaos {
+namespace nebula_chaos {
+
+struct LoadContext;
+
+using ActionFactory = std::function<core::ActionPtr(const folly::dynamic& obj,
+                                                    const LoadContext& ctx)>;
+
+// The keys of an action in the plan, besides "type" and "depends".
+struct ActionSchema {
+    std::vector<std::string> required;
+    std::vector<std::string> optional;
+};
+
+/**
+ * All action types known by the loader, each registers a factory and a schema.
+ *
+ * A type gets a dense id when registered, the loader resolves the type name of
+ * an action once and creates it by indexing the factories with the id.
+ *
+ * The built-in types register themselves in static initializers with
+ * CHAOS_REGISTER_ACTION, and so do the plugins: a plugin is a shared object
+ * which registers its types when it is loaded with loadPlugin (see
+ * --action_plugins), no change to the loader or run_chaos_plan is needed.
+ * */
+class ActionRegistry final {
+public:
+    using TypeId = uint32_t;
+    static constexpr TypeId kUnknownType = std::numeric_limits<TypeId>::max();
+
+    static ActionRegistry& instance();
+
+    // Return false if the type has been registered.
+    bool add(const std::string& type, ActionSchema schema, ActionFactory factory);
+
+    // Return kUnknownType if the type is not registered.
+    TypeId typeId(const std::string& type) const;
+
+    // Return false if a required key is missing, the unknown keys are only warned.
+    bool validate(TypeId id, const folly::dynamic& obj) const;
+
+    core::ActionPtr create(TypeId id, const folly::dynamic& obj, const LoadContext& ctx) const;
+
+    std::vector<std::string> types() const;
+
+    // Load a plugin, its types are registered when its static initializers run.
+    bool loadPlugin(const std::string& path);
+
+    // Load the plugins in --action_plugins, only the first call loads them.
+    void loadPlugins();
+
+private:
+    struct Entry {
+        std::string                     type;
+        ActionSchema                    schema;
+        ActionFactory                   factory;
+        std::unordered_set<std::string> keys;
+    };
+
+    ActionRegistry() = default;
+
+    const Entry& entry(TypeId id) const;
+
+private:
+    // Types are only added at start up or when loading plugins.
+    mutable folly::SharedMutex                      lock_;
+    std::unordered_map<std::string, TypeId>         ids_;
+    // Never shrinks, and an entry never moves once added.
+    std::vector<std::unique_ptr<Entry>>             entries_;
+    std::once_flag                                  pluginsOnce_;
+};
+
+}   // namespace nebula_chaos
+}   // namespace chaos
+
+/**
+ * Register an action type, e.g.
+ *   CHAOS_REGISTER_ACTION(WaitAction, loadWaitAction, {"wait_time_ms"}, {});
+ * the arguments after the factory are the required keys and the optional keys.
+ * */
+#define CHAOS_REGISTER_ACTION(type, factory, ...)                                  \
+    static const bool FOLLY_ANONYMOUS_VARIABLE(kChaosAction##type##Registered) =   \
+        ::chaos::nebula_chaos::ActionRegistry::instance().add(                     \
+                #type, ::chaos::nebula_chaos::ActionSchema{__VA_ARGS__}, factory)
+
+#endif  // NEBULA_ACTIONREGISTRY_H_
@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "nebula/InstanceMonitor.h"
+#include "utils/SshHelper.h"
+
+DEFINE_int32(instance_probe_interval_ms, 10000,
+             "The interval to revalidate the cached pid and state of the instances, "
+             "0 to disable it");
+
+namespace chaos {
+namespace nebula_chaos {
+
+void InstanceMonitor::start(std::chrono::milliseconds interval) {
+    if (running_ || insts_.empty()) {
+        return;
+    }
+    scheduler_.setThreadName("inst-monitor");
+    scheduler_.addFunction([this] { probe(); }, interval, "probe");
+    scheduler_.start();
+    running_ = true;
+    LOG(INFO) << "Probe " << insts_.size() << " instances every " << interval.count() << "ms";
+}
+
+void InstanceMonitor::stop() {
+    if (!running_) {
+        return;
+    }
+    scheduler_.shutdown();
+    running_ = false;
+}
+
+void InstanceMonitor::probe() {
+    struct Probed {
+        NebulaInstance* inst;
+        uint64_t        gen;
+    };
+    // The instances of the same remote are probed by a single command.
+    std::map<std::pair<std::string, std::string>, std::vector<Probed>> remotes;
+    std::map<std::pair<std::string, std::string>, std::vector<std::string>> pidFiles;
+    for (auto* inst : insts_) {
+        const auto& pidFile = inst->pidFile();
+        if (!pidFile.hasValue()) {
+            continue;
+        }
+        auto remote = std::make_pair(inst->getHost(), inst->owner());
+        // Take the generation before the probe, the result is dropped if it's changed.
+        remotes[remote].emplace_back(Probed{inst, inst->generation()});
+        pidFiles[remote].emplace_back(pidFile.value());
+    }
+    std::vector<utils::RemoteCommand> commands;
+    for (const auto& remote : pidFiles) {
+        commands.emplace_back(utils::RemoteCommand{probeCommand(remote.second),
+                                                   remote.first.first,
+                                                   remote.first.second});
+    }
+    auto results = utils::SshHelper::runOnHosts(commands);
+    auto it = remotes.begin();
+    for (const auto& result : results) {
+        const auto& probed = it->second;
+        if (!result.ok()) {
+            // The host is not reachable, we know nothing about its instances.
+            LOG(WARNING) << "Probe the instances on " << it->first.first << " failed, "
+                         << result.err;
+        } else {
+            auto alive = parseProbe(result.out);
+            for (size_t i = 0; i < probed.size(); i++) {
+                auto found = alive.find(i);
+                probed[i].inst->onProbed(probed[i].gen,
+                                         found != alive.end(),
+                                         found != alive.end() ? found->second : -1);
+            }
+        }
+        it++;
+    }
+}
+
+// static
+std::string InstanceMonitor::probeCommand(const std::vector<std::string>& pidFiles) {
+    std::string command;
+    for (size_t i = 0; i < pidFiles.size(); i++) {
+        command.append(folly::stringPrintf(
+                "p=$(cat %s 2>/dev/null) && kill -0 $p 2>/dev/null && echo \"%zu $p\"; ",
+                pidFiles[i].c_str(), i));
+    }
+    // The exit status is of the last instance, it's not an error if it's not alive.
+    command.append("true");
+    return command;
+}
+
+// static
+std::unordered_map<size_t, int32_t> InstanceMonitor::parseProbe(const std::string& out) {
+    std::unordered_map<size_t, int32_t> alive;
+    folly::gen::lines(out) | [&](folly::StringPiece line) {
+        line = folly::trimWhitespace(line);
+        if (line.empty()) {
+            return;
+        }
+        size_t index;
+        int32_t pid;
+        if (folly::split(' ', line, index, pid)) {
+            alive[index] = pid;
+        } else {
+            LOG(ERROR) << "Bad probe output " << line;
+        }
+    };
+    return alive;
+}
+
+}   // namespace nebula_chaos
+}   // namespace chaos
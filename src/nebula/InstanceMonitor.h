@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef NEBULA_INSTANCEMONITOR_H_
+#define NEBULA_INSTANCEMONITOR_H_
+
+#include "common/base/Base.h"
+#include <folly/experimental/FunctionScheduler.h>
+#include "nebula/NebulaInstance.h"
+
+DECLARE_int32(instance_probe_interval_ms);
+
+namespace chaos {
+namespace nebula_chaos {
+
+/**
+ * Revalidate the cached state of the instances in the background, so the actions
+ * read the pid and the state in memory instead of asking the remotes every time.
+ *
+ * Every probe sends one command to each remote (host and user) for all of its
+ * instances, which reads the pid file and checks the process by "kill -0".
+ * The instances exited unexpectedly are marked stopped, and the ones started
+ * outside the plan are marked running.
+ * */
+class InstanceMonitor final {
+public:
+    explicit InstanceMonitor(std::vector<NebulaInstance*> insts)
+        : insts_(std::move(insts)) {}
+
+    ~InstanceMonitor() {
+        stop();
+    }
+
+    void start(std::chrono::milliseconds interval);
+
+    void stop();
+
+    // Probe all instances once.
+    void probe();
+
+    // The command to probe the pid files, it prints "<index> <pid>" for the alive ones.
+    static std::string probeCommand(const std::vector<std::string>& pidFiles);
+
+    // Parse the output of probeCommand, return the pid of the alive ones by the index.
+    static std::unordered_map<size_t, int32_t> parseProbe(const std::string& out);
+
+private:
+    std::vector<NebulaInstance*>    insts_;
+    folly::FunctionScheduler        scheduler_;
+    bool                            running_{false};
+};
+
+}   // namespace nebula_chaos
+}   // namespace chaos
+
+#endif  // NEBULA_INSTANCEMONITOR_H_
@@ -6,20 +6,296 @@
 
 #include "nebula/NebulaAction.h"
 #include "nebula/NebulaUtils.h"
+#include "utils/AgentClient.h"
+#include "utils/Metrics.h"
 #include "utils/SshHelper.h"
+#include "utils/Parallel.h"
 #include "utils/Utils.h"
 #include "core/CheckProcAction.h"
+#include "parser/ParserHelper.h"
 #include <folly/Random.h>
 #include <folly/GLog.h>
+#include <folly/ScopeGuard.h>
+#include <folly/TokenBucket.h>
+#include <numeric>
 #include "boost/filesystem/operations.hpp"
 
 namespace chaos {
 namespace nebula_chaos {
 
+namespace {
+
+// The vid or the property of the circle as a number, it is a string or an int.
+folly::Optional<uint64_t> asId(const nebula::Value& val) {
+    if (val.isInt()) {
+        return static_cast<uint64_t>(val.getInt());
+    }
+    if (val.isStr()) {
+        auto id = folly::tryTo<uint64_t>(val.getStr());
+        if (id.hasValue()) {
+            return id.value();
+        }
+    }
+    return folly::none;
+}
+
+// e.g. "iptables -I INPUT ...; iptables -I OUTPUT ..."
+std::string rulesToString(const std::vector<utils::Rule>& rules) {
+    std::vector<std::string> strs;
+    for (const auto& rule : rules) {
+        strs.emplace_back(utils::toString(rule));
+    }
+    return folly::join("; ", strs);
+}
+
+// The shell command of the rule run by ssh, the rule has been validated.
+std::string shellCommand(const utils::Rule& rule) {
+    auto args = folly::join(" ", utils::ruleArgs(rule));
+    switch (rule.op) {
+        case utils::RuleOp::kIptablesInsert:
+            return "sudo iptables " + args;
+        case utils::RuleOp::kIptablesDelete: {
+            // The same as the agent, remove all copies of the rule.
+            auto check = args;
+            check.replace(0, 2, "-C");
+            return folly::stringPrintf("while sudo iptables %s 2>/dev/null; do "
+                                       "sudo iptables %s || break; done; "
+                                       "! sudo iptables %s 2>/dev/null",
+                                       check.c_str(), args.c_str(), check.c_str());
+        }
+        case utils::RuleOp::kTcAdd:
+            return "tcset " + args;
+        case utils::RuleOp::kTcDel:
+            return "tcdel " + args;
+    }
+    LOG(FATAL) << "Unknown op " << static_cast<int32_t>(rule.op);
+    return "";
+}
+
+/**
+ * Apply the rules on the host of the instance by its chaos agent with --use_chaos_agent,
+ * or by ssh if it's disabled or not reachable. The rollback is only done by the agent,
+ * by ssh an atomic request stops at the first failed rule.
+ * */
+bool applyRules(NebulaInstance* inst, const utils::AgentRequest& req) {
+    if (req.rules.empty()) {
+        return true;
+    }
+    for (const auto& rule : req.rules) {
+        std::string reason;
+        if (!utils::validateRule(rule, reason)) {
+            LOG(ERROR) << "Bad rule " << utils::toString(rule) << ", " << reason;
+            return false;
+        }
+    }
+    if (FLAGS_use_chaos_agent) {
+        utils::AgentResponse resp;
+        auto status = utils::AgentClient::of(inst->getHost())->apply(req, resp);
+        if (status == utils::AgentClient::Status::kApplied) {
+            for (const auto& result : resp.results) {
+                if (result.exitStatus != 0) {
+                    LOG(ERROR) << "The error is " << result.err;
+                }
+            }
+            LOG(INFO) << "Applied " << req.rules.size() << " rules on " << inst->toString()
+                      << " by the chaos agent, cost " << resp.done.costUs << "us"
+                      << (resp.done.rolledBack ? ", rolled back" : "");
+            return resp.done.ok;
+        }
+        if (status == utils::AgentClient::Status::kUnknown) {
+            // Applying them again by ssh would duplicate the applied ones.
+            LOG(ERROR) << "The rules sent to the chaos agent on " << inst->getHost()
+                       << " may have been applied or not";
+            return false;
+        }
+        LOG(WARNING) << "The chaos agent on " << inst->getHost() << " is not reachable, "
+                     << "apply the rules by ssh";
+    }
+    std::vector<std::string> commands;
+    for (const auto& rule : req.rules) {
+        commands.emplace_back(shellCommand(rule));
+    }
+    // Every command is grouped, so the loop of a delete is kept as a whole.
+    std::string command;
+    if (req.atomic) {
+        command = "{ " + folly::join("; } && { ", commands) + "; }";
+    } else {
+        // Run all of them, and fail if any of them failed.
+        for (const auto& cmd : commands) {
+            command.append("{ ").append(cmd).append("; } || failed=1; ");
+        }
+        command.append("[ -z \"$failed\" ]");
+    }
+    VLOG(1) << command << " on " << inst->toString();
+    auto ret = utils::SshHelper::run(
+                command,
+                inst->getHost(),
+                [] (const std::string& outMsg) {
+                    VLOG(1) << "The output is " << outMsg;
+                },
+                [] (const std::string& errMsg) {
+                    LOG(ERROR) << "The error is " << errMsg;
+                },
+                inst->owner());
+    return ret.exitStatus() == 0;
+}
+
+// Pick an index by the weights, the picked one is never of weight 0.
+size_t pickWeighted(const std::vector<uint32_t>& weights) {
+    auto r = folly::Random::rand32(std::accumulate(weights.begin(), weights.end(), 0U));
+    for (size_t i = 0; i < weights.size(); i++) {
+        if (r < weights[i]) {
+            return i;
+        }
+        r -= weights[i];
+    }
+    LOG(FATAL) << "The weights are all 0";
+    return 0;
+}
+
+/**
+ * The load of a weighted mix of statement kinds, sent by the workers on their own
+ * sessions until the duration passed, or maxReqs statements have been sent.
+ * It keeps the latencies of this run, while the process wide metrics keep every run.
+ * */
+class LoadLoop final {
+public:
+    // Build a statement of the kind into stmt.
+    using StmtBuilder = std::function<void(size_t kind, utils::StatementBuffer& stmt)>;
+
+    struct Options {
+        uint32_t                    workers{1};
+        std::chrono::milliseconds   duration{0};
+        uint64_t                    maxReqs{std::numeric_limits<uint64_t>::max()};
+        // The rate of all workers, 0 means unlimited.
+        uint32_t                    qps{0};
+    };
+
+    // metrics are the process wide histograms of the kinds.
+    LoadLoop(GraphClient* client,
+             std::vector<uint32_t> weights,
+             std::vector<utils::Histogram*> metrics)
+        : client_(client)
+        , weights_(std::move(weights))
+        , metrics_(std::move(metrics))
+        , latencies_(new utils::Histogram[weights_.size() + 1])
+        , errors_(new std::atomic<uint64_t>[weights_.size()]()) {
+        CHECK_EQ(weights_.size(), metrics_.size());
+    }
+
+    // onProgress is called every second by the first worker, return false if no
+    // statement could be picked.
+    bool run(const Options& opts,
+             const StmtBuilder& build,
+             const std::function<void(std::string)>& onProgress) {
+        if (std::all_of(weights_.begin(), weights_.end(), [] (uint32_t w) { return w == 0; })) {
+            LOG(ERROR) << "The weights of the mix are all 0";
+            return false;
+        }
+        auto sessions = client_->ensureSessions(opts.workers);
+        if (sessions < opts.workers) {
+            LOG(WARNING) << "Only " << sessions << " sessions could be used";
+        }
+        // All workers share the bucket, so qps is the rate of the whole load.
+        std::unique_ptr<folly::TokenBucket> bucket;
+        if (opts.qps > 0) {
+            bucket = std::make_unique<folly::TokenBucket>(opts.qps, std::max(1U, opts.qps / 10));
+        }
+        std::atomic<uint64_t> nextReq{0};
+        auto start = core::Clock::now();
+        auto deadline = start + opts.duration;
+        auto& total = latencies_[weights_.size()];
+        utils::parallelFor(opts.workers, opts.workers, [&] (size_t worker) {
+            utils::StatementBuffer stmt;
+            DataSet resp;
+            auto lastReport = start;
+            while (core::Clock::now() < deadline
+                    && nextReq.fetch_add(1, std::memory_order_relaxed) < opts.maxReqs) {
+                if (bucket != nullptr) {
+                    bucket->consumeWithBorrowAndWait(1);
+                }
+                auto kind = pickWeighted(weights_);
+                build(kind, stmt);
+                auto reqStart = core::Clock::now();
+                auto code = client_->execute(stmt.piece(), resp);
+                auto now = core::Clock::now();
+                auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                        now - reqStart).count();
+                latencies_[kind].record(costUs);
+                total.record(costUs);
+                metrics_[kind]->record(costUs);
+                if (code != nebula::ErrorCode::SUCCEEDED) {
+                    errors_[kind].fetch_add(1, std::memory_order_relaxed);
+                }
+                if (worker == 0 && now - lastReport >= std::chrono::seconds(1)) {
+                    lastReport = now;
+                    onProgress(progress(now - start));
+                }
+            }
+        });
+        costMs_ = std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(
+                core::Clock::now() - start).count());
+        return true;
+    }
+
+    const utils::Histogram& latency(size_t kind) const {
+        return latencies_[kind];
+    }
+
+    // Of all kinds.
+    const utils::Histogram& total() const {
+        return latencies_[weights_.size()];
+    }
+
+    uint64_t errors(size_t kind) const {
+        return errors_[kind].load(std::memory_order_relaxed);
+    }
+
+    uint64_t totalErrors() const {
+        uint64_t errors = 0;
+        for (size_t kind = 0; kind < weights_.size(); kind++) {
+            errors += errors_[kind].load(std::memory_order_relaxed);
+        }
+        return errors;
+    }
+
+    // How long the last run took, at least 1ms.
+    int64_t costMs() const {
+        return costMs_;
+    }
+
+private:
+    std::string progress(core::Duration elapsed) const {
+        auto snapshot = total().snapshot();
+        uint64_t elapsedMs = std::max<int64_t>(
+                1, std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        return folly::stringPrintf("requests %lu, %lu qps, p50 %luus, p99 %luus, errors %lu",
+                                   snapshot.count, snapshot.count * 1000 / elapsedMs,
+                                   snapshot.percentile(0.5), snapshot.percentile(0.99),
+                                   totalErrors());
+    }
+
+private:
+    GraphClient*                                client_;
+    std::vector<uint32_t>                       weights_;
+    std::vector<utils::Histogram*>              metrics_;
+    // The last one is of all kinds.
+    std::unique_ptr<utils::Histogram[]>         latencies_;
+    std::unique_ptr<std::atomic<uint64_t>[]>    errors_;
+    int64_t                                     costMs_{1};
+};
+
+}   // namespace
+
 ResultCode CrashAction::doRun() {
     CHECK_NOTNULL(inst_);
     auto killCommand = inst_->killCommand();
     LOG(INFO) << killCommand << " on " << inst_->toString() << " as " << inst_->owner();
+    // The monitor must not see the instance in the middle of the change.
+    inst_->beginChange();
+    SCOPE_EXIT {
+        inst_->endChange();
+    };
     auto ret = utils::SshHelper::run(
                 killCommand,
                 inst_->getHost(),
@@ -31,6 +307,8 @@ ResultCode CrashAction::doRun() {
                 },
                 inst_->owner());
     CHECK_EQ(0, ret.exitStatus());
+    // The pid file may be rewritten, don't trust the cached one.
+    inst_->invalidate();
     auto pid = inst_->getPid();
     if (!pid.hasValue()) {
         return ResultCode::ERR_FAILED;
@@ -49,6 +327,10 @@ ResultCode StartAction::doRun() {
     CHECK_NOTNULL(inst_);
     auto startCommand = inst_->startCommand(parameters_);
     LOG(INFO) << startCommand << " on " << inst_->toString() << " as " << inst_->owner();
+    inst_->beginChange();
+    SCOPE_EXIT {
+        inst_->endChange();
+    };
     auto ret = utils::SshHelper::run(
                 startCommand,
                 inst_->getHost(),
@@ -60,6 +342,8 @@ ResultCode StartAction::doRun() {
                 },
                 inst_->owner());
     CHECK_EQ(0, ret.exitStatus());
+    // The pid file may be rewritten, don't trust the cached one.
+    inst_->invalidate();
     auto pid = inst_->getPid();
     if (!pid.hasValue()) {
         return ResultCode::ERR_FAILED;
@@ -77,6 +361,10 @@ ResultCode StopAction::doRun() {
     CHECK_NOTNULL(inst_);
     auto stopCommand = inst_->stopCommand();
     LOG(INFO) << stopCommand << " on " << inst_->toString() << " as " << inst_->owner();
+    inst_->beginChange();
+    SCOPE_EXIT {
+        inst_->endChange();
+    };
 
     int32_t tryTimes = 0;
     int32_t canTryTimes = 10;
@@ -92,6 +380,7 @@ ResultCode StopAction::doRun() {
                     },
                     inst_->owner());
         CHECK_EQ(0, ret.exitStatus());
+        inst_->invalidate();
         auto pid = inst_->getPid();
         if (!pid.hasValue()) {
             return ResultCode::ERR_FAILED;
@@ -124,7 +413,7 @@ ResultCode CleanDataAction::doRun() {
                    << " is still running";
         return ResultCode::OK;
     }
-    auto dataPaths = inst_->dataDirs();
+    const auto& dataPaths = inst_->dataDirs();
     if (!dataPaths.hasValue()) {
         LOG(ERROR) << "Can't find data path on " << inst_->toString();
         return ResultCode::ERR_FAILED;
@@ -199,22 +488,32 @@ ResultCode MetaAction::doRun() {
     return ResultCode::ERR_FAILED;
 }
 
-ResultCode WriteCircleAction::sendBatch(const std::vector<std::string>& batchCmds) {
-    auto joinStr = folly::join(",", batchCmds);
-    auto cmd = folly::stringPrintf("INSERT VERTEX %s (%s) VALUES %s",
-                                   tag_.c_str(),
-                                   col_.c_str(),
-                                   joinStr.c_str());
-    VLOG(1) << cmd;
+std::string WriteCircleAction::detail() const {
+    auto rows = writtenRows_.load(std::memory_order_relaxed);
+    auto endMs = endTimeMs();
+    if (endMs < startTimeMs()) {
+        endMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    uint64_t costMs = std::max<int64_t>(1, endMs - startTimeMs());
+    return folly::stringPrintf("rows %lu/%lu, %lu rows/s, retries %lu",
+                               rows, totalRows_, rows * 1000 / costMs,
+                               retries_.load(std::memory_order_relaxed));
+}
+
+ResultCode WriteCircleAction::sendBatch(const utils::StatementBuffer& stmt, uint64_t rows) {
+    VLOG(1) << stmt.str();
     DataSet resp;
     uint32_t tryTimes = 0;
     uint32_t retryInterval = retryIntervalMs_;
 
     while (++tryTimes < try_) {
-        auto res = client_->execute(cmd, resp);
+        auto res = client_->execute(stmt.piece(), resp);
         if (res == nebula::ErrorCode::SUCCEEDED) {
+            writtenRows_.fetch_add(rows, std::memory_order_relaxed);
             return ResultCode::OK;
         }
+        retries_.fetch_add(1, std::memory_order_relaxed);
 
         LOG(WARNING) << "Failed to send request, tryTimes " << tryTimes
                      << ", error code " << static_cast<int32_t>(res);
@@ -225,77 +524,228 @@ ResultCode WriteCircleAction::sendBatch(const std::vector<std::string>& batchCmd
     return ResultCode::ERR_FAILED;
 }
 
-std::string WriteCircleAction::genData() {
-    auto randchar = []() -> char {
-        const char charset[] =
-            "0123456789"
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz";
-        const size_t maxIndex = (sizeof(charset) - 1);
-        return charset[folly::Random::rand32(maxIndex)];
-    };
-    std::string str(rowSize_, 0);
-    std::generate_n(str.begin(), rowSize_, randchar);
-    return str;
+void WriteCircleAction::beginBatch(utils::StatementBuffer& stmt) {
+    stmt.clear();
+    stmt.append("INSERT VERTEX ").append(tag_).append(" (").append(col_).append(") VALUES ");
 }
 
-void WriteCircleAction::buildVIdAndValue(uint64_t vid,
-                                         std::string val,
-                                         std::vector<std::string>& cmds) {
+void WriteCircleAction::appendVId(uint64_t vid, bool first, utils::StatementBuffer& stmt) {
+    if (!first) {
+        stmt.append(',');
+    }
     if (stringVid_) {
-        cmds.emplace_back(folly::stringPrintf("\"%lu\":(\"%s\")",
-                          vid, val.c_str()));
+        stmt.append('"').appendUint(vid).append('"');
     } else {
-        cmds.emplace_back(folly::stringPrintf("%lu:(\"%s\")",
-                          vid, val.c_str()));
+        stmt.appendUint(vid);
     }
 }
 
+void WriteCircleAction::buildVIdAndRandomValue(uint64_t vid,
+                                               bool first,
+                                               utils::StatementBuffer& stmt) {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+    const size_t maxIndex = (sizeof(charset) - 1);
+    appendVId(vid, first, stmt);
+    stmt.append(":(\"");
+    auto* data = stmt.grow(rowSize_);
+    for (uint32_t i = 0; i < rowSize_; i++) {
+        data[i] = charset[folly::Random::rand32(maxIndex)];
+    }
+    stmt.append("\")");
+}
+
 void WriteCircleAction::buildVIdAndValue(uint64_t vid,
                                          uint64_t val,
-                                         std::vector<std::string>& cmds) {
-    if (stringVid_) {
-        cmds.emplace_back(folly::stringPrintf("\"%lu\":(\"%lu\")",
-                          vid, val));
-    } else {
-        cmds.emplace_back(folly::stringPrintf("%lu:(\"%lu\")",
-                          vid, val));
-    }
+                                         bool first,
+                                         utils::StatementBuffer& stmt) {
+    appendVId(vid, first, stmt);
+    stmt.append(":(\"").appendUint(val).append("\")");
 }
 
 ResultCode WriteCircleAction::doRun() {
     CHECK_NOTNULL(client_);
-    std::vector<std::string> batchCmds;
-    batchCmds.reserve(1024);
+    writtenRows_ = 0;
+    retries_ = 0;
+    if (targetQps_ > 0) {
+        return runOpenLoop();
+    }
+    if (pipelineDepth_ > 1 || sessions_ > 1) {
+        return runPipelined();
+    }
+    auto start = core::Clock::now();
+    utils::StatementBuffer stmt;
+    beginBatch(stmt);
+    uint32_t rows = 0;
     uint64_t row = 1;
     while (row < totalRows_) {
-        if (batchCmds.size() == batchNum_) {
-            auto res = sendBatch(batchCmds);
+        if (rows == batchNum_) {
+            auto res = sendBatch(stmt, rows);
             if (res != ResultCode::OK) {
                 LOG(ERROR) << "Send request failed!";
                 return res;
             }
             FB_LOG_EVERY_MS(INFO, 3000) << "Send requests successfully, row "
                                         << row;
-            batchCmds.clear();
+            beginBatch(stmt);
+            rows = 0;
         }
         if (randomVal_) {
-            buildVIdAndValue(startId_++, genData(), batchCmds);
+            buildVIdAndRandomValue(startId_++, rows++ == 0, stmt);
         } else {
-            buildVIdAndValue(row, row + 1, batchCmds);
+            buildVIdAndValue(row, row + 1, rows++ == 0, stmt);
         }
         row++;
     }
     if (randomVal_) {
-        buildVIdAndValue(startId_++, genData(), batchCmds);
+        buildVIdAndRandomValue(startId_++, rows == 0, stmt);
     } else {
-        buildVIdAndValue(row, 1, batchCmds);
+        buildVIdAndValue(row, 1, rows == 0, stmt);
     }
-    auto res = sendBatch(batchCmds);
-    LOG(INFO) << "Send all requests successfully, row " << row;
+    auto res = sendBatch(stmt, rows + 1);
+    auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            core::Clock::now() - start).count();
+    LOG(INFO) << "Send all requests successfully, row " << row << ", cost " << costMs
+              << "ms, " << row * 1000 / std::max<int64_t>(1, costMs) << " rows/s";
     return res;
 }
 
+uint64_t WriteCircleAction::buildBatch(uint64_t batch, utils::StatementBuffer& stmt) {
+    // Row r (from 1 to totalRows_) points to r + 1, and the last one points to 1.
+    uint64_t batchNum = std::max(1U, batchNum_);
+    beginBatch(stmt);
+    auto first = batch * batchNum + 1;
+    auto last = std::min(first + batchNum - 1, totalRows_);
+    for (auto row = first; row <= last; row++) {
+        if (randomVal_) {
+            buildVIdAndRandomValue(startId_ + row - 1, row == first, stmt);
+        } else {
+            buildVIdAndValue(row, row == totalRows_ ? 1 : row + 1, row == first, stmt);
+        }
+    }
+    return last - first + 1;
+}
+
+ResultCode WriteCircleAction::runPipelined() {
+    // The batches in flight run on different sessions of the client.
+    auto sessions = client_->ensureSessions(sessions_);
+    if (sessions < sessions_) {
+        LOG(WARNING) << "Only " << sessions << " sessions could be used";
+    }
+
+    uint64_t batchNum = std::max(1U, batchNum_);
+    uint64_t totalBatches = (totalRows_ + batchNum - 1) / batchNum;
+    std::atomic<uint64_t> nextBatch{0};
+    std::atomic<uint64_t> sentRows{0};
+    std::atomic<bool> failed{false};
+    auto start = core::Clock::now();
+    LOG(INFO) << "Write " << totalRows_ << " rows in " << totalBatches << " batches, "
+              << pipelineDepth_ << " in flight over " << sessions << " sessions";
+    utils::parallelFor(pipelineDepth_, pipelineDepth_, [&] (size_t) {
+        utils::StatementBuffer stmt;
+        uint64_t batch;
+        while (!failed.load(std::memory_order_relaxed)
+                && (batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) < totalBatches) {
+            auto rows = buildBatch(batch, stmt);
+            if (sendBatch(stmt, rows) != ResultCode::OK) {
+                LOG(ERROR) << "Send request failed, batch " << batch;
+                failed = true;
+                return;
+            }
+            auto sent = sentRows.fetch_add(rows, std::memory_order_relaxed);
+            FB_LOG_EVERY_MS(INFO, 3000) << "Send requests successfully, row " << sent;
+        }
+    });
+    if (failed) {
+        return ResultCode::ERR_FAILED;
+    }
+    if (randomVal_) {
+        startId_ += totalRows_;
+    }
+    auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            core::Clock::now() - start).count();
+    LOG(INFO) << "Send all requests successfully, row " << sentRows.load() << ", cost "
+              << costMs << "ms, " << sentRows.load() * 1000 / std::max<int64_t>(1, costMs)
+              << " rows/s, " << totalBatches * 1000 / std::max<int64_t>(1, costMs)
+              << " batches/s";
+    return ResultCode::OK;
+}
+
+ResultCode WriteCircleAction::runOpenLoop() {
+    auto sessions = client_->ensureSessions(sessions_);
+    if (sessions < sessions_) {
+        LOG(WARNING) << "Only " << sessions << " sessions could be used";
+    }
+    uint64_t batchNum = std::max(1U, batchNum_);
+    uint64_t totalBatches = (totalRows_ + batchNum - 1) / batchNum;
+    auto interval = std::chrono::duration_cast<core::Duration>(
+            std::chrono::duration<double>(1.0 / targetQps_));
+    // The histograms of this run for the summary, the ones of the metrics keep every run.
+    utils::Histogram latency;
+    utils::Histogram queueDelay;
+    auto* latencyMetric = utils::Metrics::histogram("chaos_write_latency_us", {{"tag", tag_}});
+    auto* queueMetric = utils::Metrics::histogram("chaos_write_queue_delay_us", {{"tag", tag_}});
+    std::atomic<uint64_t> nextBatch{0};
+    std::atomic<bool> failed{false};
+    auto start = core::Clock::now();
+    LOG(INFO) << "Write " << totalRows_ << " rows in " << totalBatches << " batches at "
+              << targetQps_ << " batches/s, at most " << pipelineDepth_ << " in flight over "
+              << sessions << " sessions";
+    utils::parallelFor(pipelineDepth_, pipelineDepth_, [&] (size_t) {
+        utils::StatementBuffer stmt;
+        uint64_t batch;
+        while (!failed.load(std::memory_order_relaxed)
+                && (batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) < totalBatches) {
+            auto rows = buildBatch(batch, stmt);
+            // Sleep until the batch is due, it's sent at once if we are behind.
+            auto due = start + interval * static_cast<int64_t>(batch);
+            std::this_thread::sleep_until(due);
+            auto sendTime = core::Clock::now();
+            auto rc = sendBatch(stmt, rows);
+            auto end = core::Clock::now();
+            auto latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    end - due).count();
+            auto queueUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    sendTime - due).count();
+            latency.record(latencyUs);
+            latencyMetric->record(latencyUs);
+            queueDelay.record(queueUs);
+            queueMetric->record(queueUs);
+            if (rc != ResultCode::OK) {
+                LOG(ERROR) << "Send request failed, batch " << batch;
+                failed = true;
+                return;
+            }
+            FB_LOG_EVERY_MS(INFO, 3000) << "Send requests successfully, batch " << batch
+                                        << ", queue delay " << queueUs << "us";
+        }
+    });
+    auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            core::Clock::now() - start).count();
+    auto latencySnapshot = latency.snapshot();
+    auto queueSnapshot = queueDelay.snapshot();
+    LOG(INFO) << "Sent " << latencySnapshot.count << " batches in " << costMs << "ms, "
+              << latencySnapshot.count * 1000 / std::max<int64_t>(1, costMs)
+              << " batches/s of the target " << targetQps_;
+    LOG(INFO) << "Latency from the due time (us): " << latencySnapshot.toString()
+              << ", p999 " << latencySnapshot.percentile(0.999);
+    LOG(INFO) << "Queue delay (us): " << queueSnapshot.toString();
+    if (queueSnapshot.percentile(0.5) > static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(interval).count())) {
+        LOG(WARNING) << "Most batches waited for a worker, the writer could not keep the rate, "
+                     << "try a larger pipeline_depth";
+    }
+    if (failed) {
+        return ResultCode::ERR_FAILED;
+    }
+    if (randomVal_) {
+        startId_ += totalRows_;
+    }
+    return ResultCode::OK;
+}
+
 folly::Expected<std::string, ResultCode>
 WalkThroughAction::sendCommand(const std::string& cmd) {
     VLOG(1) << cmd;
@@ -323,8 +773,122 @@ WalkThroughAction::sendCommand(const std::string& cmd) {
     return folly::makeUnexpected(ResultCode::ERR_FAILED);
 }
 
+folly::Expected<DataSet, ResultCode>
+WalkThroughAction::fetch(const utils::StatementBuffer& stmt) {
+    VLOG(1) << stmt.str();
+    DataSet resp;
+    uint32_t tryTimes = 0;
+    while (++tryTimes < try_) {
+        auto res = client_->execute(stmt.piece(), resp);
+        if (res == nebula::ErrorCode::SUCCEEDED) {
+            return resp;
+        }
+        LOG(WARNING) << "Failed to send request, tryTimes " << tryTimes
+                     << ", error code " << static_cast<int32_t>(res);
+        if (tryTimes + 1 < try_) {
+            usleep(retryIntervalMs_ * 1000 * tryTimes);
+        }
+    }
+    return folly::makeUnexpected(ResultCode::ERR_FAILED);
+}
+
+ResultCode WalkThroughAction::checkBatch(const DataSet& resp, uint64_t first, uint64_t last) {
+    std::vector<bool> found(last - first + 1, false);
+    for (const auto& row : resp.rows) {
+        if (row.size() < 2) {
+            LOG(ERROR) << "Bad result, row size " << row.size();
+            return ResultCode::ERR_FAILED;
+        }
+        auto vid = asId(row[0]);
+        auto next = asId(row[1]);
+        if (!vid.hasValue() || !next.hasValue()
+                || vid.value() < first || vid.value() > last) {
+            LOG(ERROR) << "Unexpected row (" << row[0] << ", " << row[1]
+                       << ") when fetching " << first << " to " << last;
+            return ResultCode::ERR_FAILED;
+        }
+        auto expected = vid.value() == totalRows_ ? 1 : vid.value() + 1;
+        if (next.value() != expected) {
+            LOG(ERROR) << "Wrong value of " << vid.value() << ", next " << next.value()
+                       << ", expected " << expected;
+            return ResultCode::ERR_FAILED;
+        }
+        auto index = vid.value() - first;
+        if (found[index]) {
+            LOG(ERROR) << "Vertex " << vid.value() << " is returned more than once";
+            return ResultCode::ERR_FAILED;
+        }
+        found[index] = true;
+    }
+    for (size_t i = 0; i < found.size(); i++) {
+        if (!found[i]) {
+            LOG(ERROR) << "Vertex " << first + i << " is missing";
+            return ResultCode::ERR_FAILED;
+        }
+    }
+    return ResultCode::OK;
+}
+
+ResultCode WalkThroughAction::runSharded() {
+    auto sessions = client_->ensureSessions(shards_);
+    auto rowsPerShard = (totalRows_ + shards_ - 1) / shards_;
+    std::atomic<bool> failed{false};
+    std::atomic<uint64_t> checked{0};
+    auto start = core::Clock::now();
+    LOG(INFO) << "Walk through " << totalRows_ << " rows in " << shards_ << " shards over "
+              << sessions << " sessions, " << batchSize_ << " vids per fetch";
+    utils::parallelFor(shards_, shards_, [&] (size_t shard) {
+        auto shardBegin = shard * rowsPerShard + 1;
+        auto shardEnd = std::min(shardBegin + rowsPerShard - 1, totalRows_);
+        utils::StatementBuffer stmt;
+        for (auto first = shardBegin;
+                first <= shardEnd && !failed.load(std::memory_order_relaxed);
+                first += batchSize_) {
+            auto last = std::min(first + batchSize_ - 1, shardEnd);
+            stmt.clear();
+            stmt.append("FETCH PROP ON ").append(tag_).append(' ');
+            for (auto vid = first; vid <= last; vid++) {
+                if (vid != first) {
+                    stmt.append(',');
+                }
+                if (stringVid_) {
+                    stmt.append('"').appendUint(vid).append('"');
+                } else {
+                    stmt.appendUint(vid);
+                }
+            }
+            stmt.append(" YIELD ").append(tag_).append('.').append(col_);
+            auto resp = fetch(stmt);
+            if (!resp.hasValue()) {
+                LOG(ERROR) << "Send command failed!";
+                failed = true;
+                return;
+            }
+            if (checkBatch(resp.value(), first, last) != ResultCode::OK) {
+                failed = true;
+                return;
+            }
+            auto count = checked.fetch_add(last - first + 1, std::memory_order_relaxed);
+            FB_LOG_EVERY_MS(INFO, 3000) << "Checked " << count << " rows";
+        }
+    });
+    if (failed) {
+        return ResultCode::ERR_FAILED;
+    }
+    auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            core::Clock::now() - start).count();
+    // Every vid from 1 to totalRows_ is found once and points to the next one,
+    // so they make a single closed circle.
+    LOG(INFO) << "The circle of " << checked.load() << " rows is closed, cost " << costMs
+              << "ms, " << checked.load() * 1000 / std::max<int64_t>(1, costMs) << " rows/s";
+    return checked.load() == totalRows_ ? ResultCode::OK : ResultCode::ERR_FAILED;
+}
+
 ResultCode WalkThroughAction::doRun() {
     CHECK_NOTNULL(client_);
+    if (shards_ > 1) {
+        return runSharded();
+    }
     auto id = std::to_string(start_);
     uint64_t count = 0;
     while (++count <= totalRows_) {
@@ -401,8 +965,121 @@ LookUpAction::sendCommand(const std::string& cmd) {
     return folly::makeUnexpected(ResultCode::ERR_FAILED);
 }
 
+ResultCode LookUpAction::checkBatch(const DataSet& resp, uint64_t first, uint64_t last) {
+    std::vector<int32_t> found(last - first + 1, 0);
+    for (const auto& row : resp.rows) {
+        if (row.size() < 2) {
+            LOG(ERROR) << "Bad result, row size " << row.size();
+            return ResultCode::ERR_FAILED;
+        }
+        auto vid = asId(row[0]);
+        auto key = asId(row[1]);
+        if (!vid.hasValue() || !key.hasValue()
+                || key.value() < first || key.value() > last) {
+            LOG(ERROR) << "Unexpected row (" << row[0] << ", " << row[1]
+                       << ") when looking up " << first << " to " << last;
+            return ResultCode::ERR_FAILED;
+        }
+        // Vertex i points to i + 1, and the last one points to 1.
+        auto expected = key.value() == 1 ? totalRows_ : key.value() - 1;
+        if (vid.value() != expected) {
+            LOG(ERROR) << "Key " << key.value() << " is on vertex " << vid.value()
+                       << ", expected " << expected;
+            return ResultCode::ERR_FAILED;
+        }
+        found[key.value() - first]++;
+    }
+    for (size_t i = 0; i < found.size(); i++) {
+        if (found[i] == 0) {
+            LOG(ERROR) << "Index entry of key " << first + i << " is missing";
+            return ResultCode::ERR_FAILED;
+        } else if (found[i] > 1) {
+            LOG(ERROR) << "Index entry of key " << first + i << " is duplicated "
+                       << found[i] << " times";
+            return ResultCode::ERR_FAILED;
+        }
+    }
+    return ResultCode::OK;
+}
+
+ResultCode LookUpAction::runBatched() {
+    auto sessions = client_->ensureSessions(concurrency_);
+    uint64_t totalBatches = (totalRows_ + batchSize_ - 1) / batchSize_;
+    std::atomic<uint64_t> nextBatch{0};
+    std::atomic<bool> failed{false};
+    // The metric accumulates over the runs, the latency of this run is logged on its own.
+    auto* metric = utils::Metrics::histogram("chaos_lookup_batch_latency_us");
+    utils::Histogram latency;
+    auto start = core::Clock::now();
+    LOG(INFO) << "Look up " << totalRows_ << " keys in " << totalBatches << " batches, "
+              << concurrency_ << " workers over " << sessions << " sessions";
+    utils::parallelFor(concurrency_, concurrency_, [&] (size_t) {
+        utils::StatementBuffer stmt;
+        uint64_t batch;
+        while (!failed.load(std::memory_order_relaxed)
+                && (batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) < totalBatches) {
+            auto first = batch * batchSize_ + 1;
+            auto last = std::min(first + batchSize_ - 1, totalRows_);
+            stmt.clear();
+            stmt.append("LOOKUP ON ").append(tag_).append(" WHERE ");
+            for (auto key = first; key <= last; key++) {
+                if (key != first) {
+                    stmt.append(" OR ");
+                }
+                stmt.append(tag_).append('.').append(col_).append(" == \"").appendUint(key)
+                    .append('"');
+            }
+            stmt.append(" YIELD ").append(tag_).append('.').append(col_);
+            VLOG(1) << stmt.str();
+
+            auto batchStart = core::Clock::now();
+            DataSet resp;
+            uint32_t tryTimes = 0;
+            auto res = nebula::ErrorCode::E_RPC_FAILURE;
+            while (++tryTimes < try_) {
+                res = client_->execute(stmt.piece(), resp);
+                if (res == nebula::ErrorCode::SUCCEEDED) {
+                    break;
+                }
+                LOG(WARNING) << "Failed to send request, tryTimes " << tryTimes
+                             << ", error code " << static_cast<int32_t>(res);
+                if (tryTimes + 1 < try_) {
+                    usleep(retryIntervalMs_ * 1000 * tryTimes);
+                }
+            }
+            if (res != nebula::ErrorCode::SUCCEEDED) {
+                LOG(ERROR) << "Send command failed!";
+                failed = true;
+                return;
+            }
+            auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    core::Clock::now() - batchStart).count();
+            metric->record(costUs);
+            latency.record(costUs);
+            if (checkBatch(resp, first, last) != ResultCode::OK) {
+                failed = true;
+                return;
+            }
+            FB_LOG_EVERY_MS(INFO, 3000) << "Checked " << batch + 1 << " batches";
+        }
+    });
+    if (failed) {
+        return ResultCode::ERR_FAILED;
+    }
+
+    auto costMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            core::Clock::now() - start).count();
+    LOG(INFO) << "All " << totalRows_ << " index entries are found exactly once, cost "
+              << costMs << "ms, " << totalRows_ * 1000 / std::max<int64_t>(1, costMs)
+              << " keys/s, batch latency (us): " << latency.snapshot().toString();
+    return ResultCode::OK;
+}
+
 ResultCode LookUpAction::doRun() {
     CHECK_NOTNULL(client_);
+    if (batchSize_ > 1 || concurrency_ > 1) {
+        return runBatched();
+    }
     auto id = std::to_string(start_);
     uint64_t count = 0;
 
@@ -438,6 +1115,125 @@ ResultCode LookUpAction::doRun() {
     return count == totalRows_ ? ResultCode::OK : ResultCode::ERR_FAILED;
 }
 
+// static
+const char* LatencyProbeAction::opName(Op op) {
+    switch (op) {
+        case kFetch:
+            return "FETCH";
+        case kInsert:
+            return "INSERT";
+        case kLookup:
+            return "LOOKUP";
+        default:
+            break;
+    }
+    return "UNKNOWN";
+}
+
+void LatencyProbeAction::buildStmt(Op op, uint64_t vid, utils::StatementBuffer& stmt) const {
+    auto appendId = [this, &stmt] (uint64_t id) {
+        if (stringVid_) {
+            stmt.append('"').appendUint(id).append('"');
+        } else {
+            stmt.appendUint(id);
+        }
+    };
+    stmt.clear();
+    switch (op) {
+        case kFetch:
+            stmt.append("FETCH PROP ON ").append(tag_).append(' ');
+            appendId(vid);
+            stmt.append(" YIELD ").append(tag_).append('.').append(col_);
+            return;
+        case kInsert:
+            // The same row as written by WriteCircleAction.
+            stmt.append("INSERT VERTEX ").append(tag_)
+                .append(" (").append(col_).append(") VALUES ");
+            appendId(vid);
+            stmt.append(":(\"").appendUint(vid == totalRows_ ? 1UL : vid + 1).append("\")");
+            return;
+        case kLookup:
+            // Find the vertex pointing to vid.
+            stmt.append("LOOKUP ON ").append(tag_).append(" WHERE ")
+                .append(tag_).append('.').append(col_)
+                .append(" == \"").appendUint(vid).append('"');
+            return;
+        default:
+            break;
+    }
+    LOG(FATAL) << "Unknown op " << static_cast<int32_t>(op);
+}
+
+ResultCode LatencyProbeAction::doRun() {
+    CHECK_NOTNULL(client_);
+    std::vector<utils::Histogram*> metrics;
+    for (int32_t op = 0; op < kOps; op++) {
+        metrics.emplace_back(utils::Metrics::histogram("chaos_probe_latency_us",
+                                                       {{"op", opName(static_cast<Op>(op))}}));
+    }
+    LoadLoop load(client_, {mix_.fetch, mix_.insert, mix_.lookup}, std::move(metrics));
+    LoadLoop::Options opts;
+    opts.workers = concurrency_;
+    opts.duration = std::chrono::milliseconds(durationMs_);
+    auto ok = load.run(opts,
+                       [this] (size_t op, utils::StatementBuffer& stmt) {
+                           buildStmt(static_cast<Op>(op),
+                                     folly::Random::rand64(1, totalRows_ + 1),
+                                     stmt);
+                       },
+                       [this] (std::string detail) {
+                           setDetail(std::move(detail));
+                       });
+    if (!ok) {
+        return ResultCode::ERR_BAD_ARGUMENT;
+    }
+
+    for (int32_t op = 0; op < kOps; op++) {
+        auto snapshot = load.latency(op).snapshot();
+        if (snapshot.count == 0) {
+            continue;
+        }
+        LOG(INFO) << opName(static_cast<Op>(op)) << " latency (us): " << snapshot.toString()
+                  << ", p999 " << snapshot.percentile(0.999) << ", errors " << load.errors(op);
+    }
+    auto total = load.total().snapshot();
+    if (total.count == 0) {
+        LOG(ERROR) << "No statement has been sent in " << durationMs_ << "ms";
+        return ResultCode::ERR_FAILED;
+    }
+    auto errorRatio = static_cast<double>(load.totalErrors()) / total.count;
+    LOG(INFO) << "Probed " << total.count << " statements, " << total.toString()
+              << ", p999 " << total.percentile(0.999) << ", error ratio " << errorRatio;
+
+    // Every op in the mix meets the SLO on its own, a slow op would hide behind
+    // a fast one with a bigger weight in the total.
+    bool breached = false;
+    const uint32_t weights[kOps] = {mix_.fetch, mix_.insert, mix_.lookup};
+    for (int32_t op = 0; op < kOps; op++) {
+        if (weights[op] == 0) {
+            continue;
+        }
+        auto snapshot = load.latency(op).snapshot();
+        auto check = [&] (const char* name, double p, uint64_t bound) {
+            auto latency = snapshot.percentile(p);
+            if (bound != 0 && latency > bound) {
+                LOG(ERROR) << "The " << name << " latency of " << opName(static_cast<Op>(op))
+                           << " " << latency << "us breaches the SLO of " << bound << "us";
+                breached = true;
+            }
+        };
+        check("p50", 0.5, slo_.p50Us);
+        check("p99", 0.99, slo_.p99Us);
+        check("p999", 0.999, slo_.p999Us);
+    }
+    if (errorRatio > slo_.maxErrorRatio) {
+        LOG(ERROR) << "The error ratio " << errorRatio
+                   << " breaches the SLO of " << slo_.maxErrorRatio;
+        breached = true;
+    }
+    return breached ? ResultCode::ERR_FAILED : ResultCode::OK;
+}
+
 ResultCode BalanceDataAction::checkResp(const DataSet&, std::string errMsg) {
     if (errMsg == "The cluster is balanced!") {
         return ResultCode::OK;
@@ -718,13 +1514,16 @@ ResultCode UpdateConfigsAction::doRun() {
     return ResultCode::ERR_FAILED;
 }
 
-ResultCode ExecutionExpressionAction::doRun() {
-    auto expr = ParserHelper::parse(condition_);
-    if (expr == nullptr) {
-        return ResultCode::ERR_FAILED;
-    }
+ExecutionExpressionAction::ExecutionExpressionAction(core::ActionContext* ctx,
+                                                     const std::string& condition)
+    : Action(ctx)
+    , condition_(condition) {
+    expr_ = ParserHelper::compile(condition_, &ctx_->exprCtx);
+    CHECK(expr_ != nullptr) << "Compile " << condition_ << " failed!";
+}
 
-    auto valOrErr = expr->eval(&ctx_->exprCtx);
+ResultCode ExecutionExpressionAction::doRun() {
+    auto valOrErr = expr_->eval(&ctx_->exprCtx);
     if (!valOrErr) {
         LOG(ERROR) << "Eval " << condition_ << " failed!";
         return ResultCode::ERR_FAILED;
@@ -777,6 +1576,8 @@ ResultCode RandomRestartAction::disturb() {
         }
         LOG(INFO) << "Finish to kill " << picked_->toString();
     }
+    setDetail(folly::stringPrintf("killed %s%s", picked_->toString().c_str(),
+                                  cleanData_ ? ", data cleaned" : ""));
 
     if (cleanData_) {
         // plan must make sure that snapshot would be sent within nextLoopInterval_,
@@ -812,7 +1613,7 @@ ResultCode CleanWalAction::doRun() {
         return rc;
     }
     auto spaceId = desc.spaceId();
-    auto wals = inst_->walDirs(spaceId);
+    const auto& wals = inst_->walDirs(spaceId);
     if (!wals.hasValue()) {
         LOG(ERROR) << "Can't find wals for space " << spaceName_ << " on " << inst_->toString();
         return ResultCode::ERR_FAILED;
@@ -840,7 +1641,17 @@ ResultCode RandomPartitionAction::disturb() {
     CHECK_NOTNULL(picked_);
     auto pickedHost = picked_->getHost();
     auto pickedPort = picked_->getPort().value();
-    paras_.clear();
+    rules_.clear();
+    // Drop the tcp packets from or to the peer on the ports, port 0 means any port.
+    auto drop = [this] (bool incoming, const std::string& peer, int32_t portMin, int32_t portMax) {
+        utils::Rule rule;
+        rule.op = utils::RuleOp::kIptablesInsert;
+        rule.incoming = incoming;
+        rule.peer = peer;
+        rule.portMin = portMin;
+        rule.portMax = portMax;
+        rules_.emplace_back(std::move(rule));
+    };
     for (auto* storage : storages_) {
         auto host = storage->getHost();
         auto port = storage->getPort().value();
@@ -848,69 +1659,51 @@ ResultCode RandomPartitionAction::disturb() {
             continue;
         }
         // forbid input packets from other storage hosts, both data port and raft port
-        paras_.emplace_back(folly::stringPrintf("INPUT -p tcp -m tcp -s %s --dport %d:%d -j DROP",
-                            host.c_str(), pickedPort, pickedPort + 1));
+        drop(true, host, pickedPort, pickedPort + 1);
         // forbid output packets to other storage hosts, both data port and raft port
-        paras_.emplace_back(folly::stringPrintf("OUTPUT -p tcp -m tcp -d %s --dport %d:%d -j DROP",
-                            host.c_str(), port, port + 1));
+        drop(false, host, port, port + 1);
     }
     for (auto* meta : metas_) {
         auto host = meta->getHost();
         auto port = meta->getPort().value();
         // forbid input packets from meta hosts
-        paras_.emplace_back(folly::stringPrintf("INPUT -p tcp -m tcp -s %s --dport %d -j DROP",
-                            host.c_str(), pickedPort));
+        drop(true, host, pickedPort, 0);
         // forbid output packets to meta hosts
-        paras_.emplace_back(folly::stringPrintf("OUTPUT -p tcp -m tcp -d %s --dport %d -j DROP",
-                            host.c_str(), port));
+        drop(false, host, port, 0);
     }
     {
         auto host = graph_->getHost();
         // forbid input packets from graph hosts
-        paras_.emplace_back(folly::stringPrintf("INPUT -p tcp -m tcp -s %s --dport %d -j DROP",
-                            host.c_str(), pickedPort));
+        drop(true, host, pickedPort, 0);
         // since we don't know graph port, just forbid all output packets to graph hosts
-        paras_.emplace_back(folly::stringPrintf("OUTPUT -p tcp -m tcp -d %s -j DROP",
-                            host.c_str()));
-    }
-    std::string iptable;
-    for (const auto& para : paras_) {
-        iptable.append(folly::stringPrintf("sudo iptables -I %s; ", para.c_str()));
+        drop(false, host, 0, 0);
     }
+    utils::AgentRequest req;
+    req.rules = rules_;
     LOG(INFO) << "Begin network partition of " << picked_->toString();
-    VLOG(1) << iptable << " on " << picked_->toString();
-    auto ret = utils::SshHelper::run(
-                iptable,
-                picked_->getHost(),
-                [] (const std::string& outMsg) {
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                picked_->owner());
-    CHECK_EQ(0, ret.exitStatus());
+    setDetail(folly::stringPrintf("partitioned %s, rules: %s",
+                                  picked_->toString().c_str(), rulesToString(rules_).c_str()));
+    if (!applyRules(picked_, req)) {
+        LOG(ERROR) << "Network partition of " << picked_->toString() << " failed";
+        // Some of the rules may be left, e.g. applied by ssh or with an unknown outcome.
+        recover();
+        return ResultCode::ERR_FAILED;
+    }
     return ResultCode::OK;
 }
 
 ResultCode RandomPartitionAction::recover() {
-    std::string iptable;
-    for (const auto& para : paras_) {
-        iptable.append(folly::stringPrintf("sudo iptables -D %s;", para.c_str()));
+    // Remove all rules even if some of them failed.
+    utils::AgentRequest req;
+    req.atomic = false;
+    for (const auto& rule : rules_) {
+        req.rules.emplace_back(utils::rollbackOf(rule).value());
     }
     LOG(INFO) << "Recover network partition of " << picked_->toString();
-    VLOG(1) << iptable << " on " << picked_->toString();
-    auto ret = utils::SshHelper::run(
-                iptable,
-                picked_->getHost(),
-                [] (const std::string& outMsg) {
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                picked_->owner());
-    CHECK_EQ(0, ret.exitStatus());
+    if (!applyRules(picked_, req)) {
+        LOG(ERROR) << "Recover network partition of " << picked_->toString() << " failed";
+        return ResultCode::ERR_FAILED;
+    }
     return ResultCode::OK;
 }
 
@@ -919,7 +1712,20 @@ ResultCode RandomTrafficControlAction::disturb() {
     CHECK_NOTNULL(picked_);
     auto pickedHost = picked_->getHost();
     auto pickedPort = picked_->getPort().value();
-    paras_.clear();
+    rules_.clear();
+    auto control = [this] (bool incoming, const std::string& peer, int32_t port) {
+        utils::Rule rule;
+        rule.op = utils::RuleOp::kTcAdd;
+        rule.incoming = incoming;
+        rule.peer = peer;
+        rule.portMin = port;
+        rule.device = device_;
+        rule.delay = delay_;
+        rule.distro = dist_;
+        rule.loss = loss_;
+        rule.duplicate = duplicate_;
+        rules_.emplace_back(std::move(rule));
+    };
     for (auto* storage : storages_) {
         auto host = storage->getHost();
         auto port = storage->getPort().value();
@@ -927,57 +1733,37 @@ ResultCode RandomTrafficControlAction::disturb() {
             continue;
         }
         // traffic control packets from other storage hosts, both data port and raft port
-        paras_.emplace_back(folly::stringPrintf(
-            "--direction incoming --src-network %s --dst-port %d", host.c_str(), pickedPort));
-        paras_.emplace_back(folly::stringPrintf(
-            "--direction incoming --src-network %s --dst-port %d", host.c_str(), pickedPort + 1));
+        control(true, host, pickedPort);
+        control(true, host, pickedPort + 1);
         // traffic contrl packets to other storage hosts, both data port and raft port
-        paras_.emplace_back(folly::stringPrintf(
-            "--direction outgoing --dst-network %s --dst-port %d", host.c_str(), port));
-        paras_.emplace_back(folly::stringPrintf(
-            "--direction outgoing --dst-network %s --dst-port %d", host.c_str(), port + 1));
-    }
-    std::string tcset;
-    for (const auto& para : paras_) {
-        tcset.append(folly::stringPrintf("tcset %s %s --delay %s --delay-distro %s "
-                                         "--loss %d --duplicate %d --add; ",
-                                         device_.c_str(), para.c_str(),  delay_.c_str(),
-                                         dist_.c_str(), loss_, duplicate_));
+        control(false, host, port);
+        control(false, host, port + 1);
     }
+    utils::AgentRequest req;
+    req.rules = rules_;
     LOG(INFO) << "Begin traffic control of " << picked_->toString();
-    VLOG(1) << tcset << " on " << picked_->toString();
-    auto ret = utils::SshHelper::run(
-                tcset,
-                picked_->getHost(),
-                [] (const std::string& outMsg) {
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                picked_->owner());
-    CHECK_EQ(0, ret.exitStatus());
+    setDetail(folly::stringPrintf("traffic control of %s, delay %s, loss %d%%, rules: %s",
+                                  picked_->toString().c_str(), delay_.c_str(), loss_,
+                                  rulesToString(rules_).c_str()));
+    if (!applyRules(picked_, req)) {
+        LOG(ERROR) << "Traffic control of " << picked_->toString() << " failed";
+        recover();
+        return ResultCode::ERR_FAILED;
+    }
     return ResultCode::OK;
 }
 
 ResultCode RandomTrafficControlAction::recover() {
-    std::string tcdel;
-    for (const auto& para : paras_) {
-        tcdel.append(folly::stringPrintf("tcdel %s %s; ", device_.c_str(), para.c_str()));
+    utils::AgentRequest req;
+    req.atomic = false;
+    for (const auto& rule : rules_) {
+        req.rules.emplace_back(utils::rollbackOf(rule).value());
     }
     LOG(INFO) << "Recover traffic control of " << picked_->toString();
-    VLOG(1) << tcdel << " on " << picked_->toString();
-    auto ret = utils::SshHelper::run(
-                tcdel,
-                picked_->getHost(),
-                [] (const std::string& outMsg) {
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                picked_->owner());
-    CHECK_EQ(0, ret.exitStatus());
+    if (!applyRules(picked_, req)) {
+        LOG(ERROR) << "Recover traffic control of " << picked_->toString() << " failed";
+        return ResultCode::ERR_FAILED;
+    }
     return ResultCode::OK;
 }
 
@@ -986,9 +1772,10 @@ ResultCode FillDiskAction::disturb() {
     std::mt19937 gen(rd());
     std::shuffle(storages_.begin(), storages_.end(), gen);
 
+    std::vector<utils::RemoteCommand> commands;
     for (int32_t i = 0; i < count_; i++) {
         auto* picked = storages_[i];
-        auto dirs = picked->dataDirs();
+        const auto& dirs = picked->dataDirs();
         if (!dirs.hasValue()) {
             LOG(ERROR) << "Failed to get data_path of " << picked->toString();
             return ResultCode::ERR_FAILED;
@@ -996,17 +1783,16 @@ ResultCode FillDiskAction::disturb() {
         LOG(INFO) << "Begin to fill disk of " << picked->toString();
         // just use the first data path
         auto fill = folly::stringPrintf("cat /dev/zero > %s/full", dirs.value().front().c_str());
-        auto ret = utils::SshHelper::run(
-                    fill,
-                    picked->getHost(),
-                    [] (const std::string& outMsg) {
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    picked->owner());
-        CHECK_EQ(1, ret.exitStatus());
+        commands.emplace_back(utils::RemoteCommand{fill, picked->getHost(), picked->owner()});
+    }
+    std::vector<std::string> filled;
+    for (int32_t i = 0; i < count_; i++) {
+        filled.emplace_back(storages_[i]->toString());
+    }
+    setDetail("filled disks of " + folly::join(", ", filled));
+    auto results = utils::SshHelper::runOnHosts(commands);
+    for (const auto& result : results) {
+        CHECK_EQ(1, result.ret.exitStatus());
     }
     return ResultCode::OK;
 }
@@ -1017,31 +1803,29 @@ ResultCode FillDiskAction::recover() {
     2. all storage may crashed because of disk is full when data path is under same directory,
        so try to reboot all of them
     */
+    std::vector<utils::RemoteCommand> commands;
     for (int32_t i = 0; i < count_; i++) {
         auto* storage = storages_[i];
-        auto dirs = storage->dataDirs();
+        const auto& dirs = storage->dataDirs();
         if (!dirs.hasValue()) {
             LOG(ERROR) << "Failed to get data_path of " << storage->toString();
             return ResultCode::ERR_FAILED;
         }
         LOG(INFO) << "Clean disk on " << storage->toString();
         auto clean = folly::stringPrintf("rm -f %s/full", dirs.value().front().c_str());
-        auto rc = utils::SshHelper::run(
-                    clean,
-                    storage->getHost(),
-                    [] (const std::string& outMsg) {
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    storage->owner());
-        CHECK_EQ(0, rc.exitStatus());
+        commands.emplace_back(utils::RemoteCommand{clean, storage->getHost(), storage->owner()});
+    }
+    auto results = utils::SshHelper::runOnHosts(commands);
+    for (const auto& result : results) {
+        CHECK_EQ(0, result.ret.exitStatus());
     }
 
-    for (auto* storage : storages_) {
-        LOG(INFO) << "Begin to reboot " << storage->toString();
-        auto rc = reboot(storage);
+    std::vector<ResultCode> rebooted(storages_.size(), ResultCode::OK);
+    utils::parallelFor(storages_.size(), FLAGS_ssh_max_in_flight, [&] (size_t i) {
+        LOG(INFO) << "Begin to reboot " << storages_[i]->toString();
+        rebooted[i] = reboot(storages_[i]);
+    });
+    for (auto rc : rebooted) {
         if (rc != ResultCode::OK) {
             return rc;
         }
@@ -1114,7 +1898,12 @@ ResultCode SlowDiskAction::disturb() {
                 },
                 picked_->owner());
     CHECK_EQ(0, ret.exitStatus());
-    return stapPid_.hasValue() ? ResultCode::OK : ResultCode::ERR_FAILED;
+    if (!stapPid_.hasValue()) {
+        return ResultCode::ERR_FAILED;
+    }
+    setDetail(folly::stringPrintf("slowed disk of %s by %d ms, SystemTap pid %d",
+                                  picked_->toString().c_str(), delayMs_, stapPid_.value()));
+    return ResultCode::OK;
 }
 
 ResultCode SlowDiskAction::recover() {
@@ -1146,26 +1935,20 @@ ResultCode SlowDiskAction::recover() {
 
 ResultCode CleanCheckpointAction::doRun() {
     CHECK_NOTNULL(inst_);
-    auto dataPaths = inst_->dataDirs();
+    const auto& dataPaths = inst_->dataDirs();
     if (!dataPaths.hasValue()) {
         LOG(ERROR) << "Can't find data path on " << inst_->toString();
         return ResultCode::ERR_FAILED;
     }
+    std::vector<utils::RemoteCommand> commands;
     for (const auto& dataPath : dataPaths.value()) {
         auto rmCmd = "find %s -type d -name \"checkpoints\" | xargs rm -rf";
         auto cleanCommand = folly::stringPrintf(rmCmd, dataPath.c_str());
         LOG(INFO) << cleanCommand << " on " << inst_->toString() << " as " << inst_->owner();
-        auto ret = utils::SshHelper::run(
-                    cleanCommand,
-                    inst_->getHost(),
-                    [] (const std::string& outMsg) {
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
+        commands.emplace_back(utils::RemoteCommand{cleanCommand, inst_->getHost(), inst_->owner()});
+    }
+    for (const auto& result : utils::SshHelper::runOnHosts(commands)) {
+        CHECK_EQ(0, result.ret.exitStatus());
     }
     return ResultCode::OK;
 }
@@ -1177,66 +1960,41 @@ ResultCode RestoreFromCheckpointAction::doRun() {
                 << " is stil running";
         return ResultCode::OK;
     }
-    auto dataPaths = inst_->dataDirs();
+    const auto& dataPaths = inst_->dataDirs();
     if (!dataPaths.hasValue()) {
         LOG(ERROR) << "Can't find data path on " << inst_->toString();
         return ResultCode::ERR_FAILED;
     }
 
-    std::string returnMsg;
+    std::vector<utils::RemoteCommand> finds;
     for (const auto& dataPath : dataPaths.value()) {
-        auto rmCmd = "find %s -type d -name \"checkpoints\"";
-        auto cleanCommand = folly::stringPrintf(rmCmd, dataPath.c_str());
-        LOG(INFO) << cleanCommand << " on " << inst_->toString() << " as " << inst_->owner();
-        auto ret = utils::SshHelper::run(
-                    cleanCommand,
-                    inst_->getHost(),
-                    [&returnMsg] (const std::string& outMsg) {
-                        returnMsg = outMsg;
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
+        auto findCmd = "find %s -type d -name \"checkpoints\"";
+        auto findCommand = folly::stringPrintf(findCmd, dataPath.c_str());
+        LOG(INFO) << findCommand << " on " << inst_->toString() << " as " << inst_->owner();
+        finds.emplace_back(utils::RemoteCommand{findCommand, inst_->getHost(), inst_->owner()});
     }
-    LOG(INFO) << "check dirs : " << returnMsg;
     std::vector<std::string> checkpoints;
-    folly::split("\n", returnMsg, checkpoints, true);
-    for (const auto& checkpoint : checkpoints) {
-        auto rmCmd = "rm -fr %s/../data %s/../wal";
-        auto cleanCommand = folly::stringPrintf(rmCmd, checkpoint.c_str(), checkpoint.c_str());
-        LOG(INFO) << cleanCommand << " on " << inst_->toString() << " as " << inst_->owner();
-        auto ret = utils::SshHelper::run(
-                    cleanCommand,
-                    inst_->getHost(),
-                    [&returnMsg] (const std::string& outMsg) {
-                        returnMsg = outMsg;
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
+    for (const auto& result : utils::SshHelper::runOnHosts(finds)) {
+        CHECK_EQ(0, result.ret.exitStatus());
+        LOG(INFO) << "check dirs : " << result.out;
+        folly::split("\n", result.out, checkpoints, true);
+    }
 
-        auto cpCmd = "cp -fr %s/`ls -t %s | head -n 1`/* %s/../";
-        auto copyCommand = folly::stringPrintf(cpCmd, checkpoint.c_str(),
-                                               checkpoint.c_str(), checkpoint.c_str());
-        LOG(INFO) << copyCommand << " on " << inst_->toString() << " as " << inst_->owner();
-        ret = utils::SshHelper::run(
-            copyCommand,
-            inst_->getHost(),
-            [&returnMsg] (const std::string& outMsg) {
-                returnMsg = outMsg;
-                VLOG(1) << "The output is " << outMsg;
-            },
-            [] (const std::string& errMsg) {
-                LOG(ERROR) << "The error is " << errMsg;
-            },
-            inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
+    // Restore the checkpoints of all data paths at the same time.
+    std::vector<utils::RemoteCommand> restores;
+    for (const auto& checkpoint : checkpoints) {
+        auto restoreCmd = "rm -fr %s/../data %s/../wal && "
+                          "cp -fr %s/`ls -t %s | head -n 1`/* %s/../";
+        auto restoreCommand = folly::stringPrintf(restoreCmd,
+                                                  checkpoint.c_str(), checkpoint.c_str(),
+                                                  checkpoint.c_str(), checkpoint.c_str(),
+                                                  checkpoint.c_str());
+        LOG(INFO) << restoreCommand << " on " << inst_->toString() << " as " << inst_->owner();
+        restores.emplace_back(
+            utils::RemoteCommand{restoreCommand, inst_->getHost(), inst_->owner()});
+    }
+    for (const auto& result : utils::SshHelper::runOnHosts(restores)) {
+        CHECK_EQ(0, result.ret.exitStatus());
     }
     return ResultCode::OK;
 }
@@ -1248,7 +2006,7 @@ ResultCode RestoreFromDataDirAction::doRun() {
                    << " is stil running";
         return ResultCode::OK;
     }
-    auto dataPaths = inst_->dataDirs();
+    const auto& dataPaths = inst_->dataDirs();
     if (!dataPaths.hasValue()) {
         LOG(ERROR) << "Can't find data path on " << inst_->toString();
         return ResultCode::ERR_FAILED;
@@ -1263,35 +2021,17 @@ ResultCode RestoreFromDataDirAction::doRun() {
         LOG(ERROR) << "Data directory mismatch on " << inst_->toString();
         return ResultCode::ERR_FAILED;
     }
+    std::vector<utils::RemoteCommand> commands;
     for (size_t i = 0; i < srcPaths.size(); i++) {
-        auto cleanCmd = folly::stringPrintf("rm -fr %s ", dataPaths.value()[i].c_str());
-        LOG(INFO) << cleanCmd << " on " << inst_->toString() << " as " << inst_->owner();
-        auto ret = utils::SshHelper::run(
-                    cleanCmd,
-                    inst_->getHost(),
-                    [] (const std::string& outMsg) {
-                        VLOG(1) << "The output is " << outMsg;
-                    },
-                    [] (const std::string& errMsg) {
-                        LOG(ERROR) << "The error is " << errMsg;
-                    },
-                    inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
-        auto cpCmd = folly::stringPrintf("cp -fr %s %s",
-                                        srcPaths[i].c_str(),
-                                        dataPaths.value()[i].c_str());
-        LOG(INFO) << cpCmd << " on " << inst_->toString() << " as " << inst_->owner();
-        ret = utils::SshHelper::run(
-            cpCmd,
-            inst_->getHost(),
-            [] (const std::string& outMsg) {
-                VLOG(1) << "The output is " << outMsg;
-            },
-            [] (const std::string& errMsg) {
-                LOG(ERROR) << "The error is " << errMsg;
-            },
-            inst_->owner());
-        CHECK_EQ(0, ret.exitStatus());
+        auto restoreCmd = folly::stringPrintf("rm -fr %s && cp -fr %s %s",
+                                              dataPaths.value()[i].c_str(),
+                                              srcPaths[i].c_str(),
+                                              dataPaths.value()[i].c_str());
+        LOG(INFO) << restoreCmd << " on " << inst_->toString() << " as " << inst_->owner();
+        commands.emplace_back(utils::RemoteCommand{restoreCmd, inst_->getHost(), inst_->owner()});
+    }
+    for (const auto& result : utils::SshHelper::runOnHosts(commands)) {
+        CHECK_EQ(0, result.ret.exitStatus());
     }
     return ResultCode::OK;
 }
@@ -1309,9 +2049,12 @@ ResultCode TruncateWalAction::doRun() {
     std::mt19937 gen(rd());
     std::shuffle(storages_.begin(), storages_.end(), gen);
 
+    // Find the latest wal of the part in every wal dir of the picked storages at once.
+    std::vector<utils::RemoteCommand> lists;
+    std::vector<std::pair<NebulaInstance*, std::string>> paths;
     for (int32_t i = 0; i < count_; i++) {
         auto* storage = storages_[i];
-        auto wals = storage->walDirs(spaceId);
+        const auto& wals = storage->walDirs(spaceId);
         if (!wals.hasValue()) {
             LOG(ERROR) << "Can't find wals for space " << spaceName_
                        << " on " << storage->toString();
@@ -1322,50 +2065,42 @@ ResultCode TruncateWalAction::doRun() {
             auto path = folly::stringPrintf("%s/%d", walDir.c_str(), partId_);
             auto cmd = folly::stringPrintf(
                 "ls -lt %s/*.wal | head -n 1 | awk '{print $5, $9}'", path.c_str());
-            int32_t size;
-            std::string lastWal;
-            auto ret = utils::SshHelper::run(
-                cmd,
-                storage->getHost(),
-                [&size, &lastWal] (const std::string& outMsg) {
-                    std::vector<std::string> info;
-                    folly::split(" ", outMsg, info);
-                    if (info.size() == 2) {
-                        try {
-                            size = folly::to<int32_t>(info[0]);
-                            lastWal = info[1];
-                        } catch (const folly::ConversionError& e) {
-                            LOG(ERROR) << "Parse wal failed" << e.what();
-                        }
-                    }
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                storage->owner());
-            CHECK_EQ(0, ret.exitStatus());
-
-            if (lastWal.empty()) {
-                LOG(ERROR) << "Failed to get last wal on " << storage->toString()
-                           << " in path " << path;
-                return ResultCode::ERR_FAILED;
+            lists.emplace_back(utils::RemoteCommand{cmd, storage->getHost(), storage->owner()});
+            paths.emplace_back(storage, std::move(path));
+        }
+    }
+    auto results = utils::SshHelper::runOnHosts(lists);
+
+    std::vector<utils::RemoteCommand> truncates;
+    for (size_t i = 0; i < results.size(); i++) {
+        CHECK_EQ(0, results[i].ret.exitStatus());
+        auto* storage = paths[i].first;
+        VLOG(1) << "The output is " << results[i].out;
+        int32_t size = 0;
+        std::string lastWal;
+        std::vector<std::string> info;
+        folly::split(" ", results[i].out, info);
+        if (info.size() == 2) {
+            try {
+                size = folly::to<int32_t>(info[0]);
+                lastWal = folly::trimWhitespace(info[1]).str();
+            } catch (const folly::ConversionError& e) {
+                LOG(ERROR) << "Parse wal failed" << e.what();
             }
-            // truncate latest wal of specified bytes
-            auto truncate = folly::stringPrintf("truncate -s %d %s", size - bytes_,
-                                                lastWal.c_str());
-            ret = utils::SshHelper::run(
-                truncate,
-                storage->getHost(),
-                [] (const std::string& outMsg) {
-                    VLOG(1) << "The output is " << outMsg;
-                },
-                [] (const std::string& errMsg) {
-                    LOG(ERROR) << "The error is " << errMsg;
-                },
-                storage->owner());
-            CHECK_EQ(0, ret.exitStatus());
         }
+        if (lastWal.empty()) {
+            LOG(ERROR) << "Failed to get last wal on " << storage->toString()
+                       << " in path " << paths[i].second;
+            return ResultCode::ERR_FAILED;
+        }
+        // truncate latest wal of specified bytes
+        auto truncate = folly::stringPrintf("truncate -s %d %s", size - bytes_,
+                                            lastWal.c_str());
+        truncates.emplace_back(
+            utils::RemoteCommand{truncate, storage->getHost(), storage->owner()});
+    }
+    for (const auto& result : utils::SshHelper::runOnHosts(truncates)) {
+        CHECK_EQ(0, result.ret.exitStatus());
     }
     return ResultCode::OK;
 }
@@ -1394,59 +2129,153 @@ ResultCode RandomTruncateRestartAction::disturb() {
             return rc;
         }
     }
+    setDetail(folly::stringPrintf("killed %s, truncated wal of space %s, part %d",
+                                  picked_->toString().c_str(), spaceName_.c_str(), partId_));
     return ResultCode::OK;
 }
 
-ResultCode StoragePerfAction::doRun() {
-    if (access(perfPath_.c_str(), F_OK) != 0) {
-        LOG(ERROR) << "File not exists " << perfPath_;
-        return ResultCode::ERR_FAILED;
+// static
+folly::Optional<StoragePerfAction::Method> StoragePerfAction::toMethod(const std::string& name) {
+    for (int32_t method = 0; method < kMethods; method++) {
+        if (name == methodName(static_cast<Method>(method))) {
+            return static_cast<Method>(method);
+        }
+    }
+    return folly::none;
+}
+
+// static
+const char* StoragePerfAction::methodName(Method method) {
+    switch (method) {
+        case kAddVertices:
+            return "addVertices";
+        case kAddEdges:
+            return "addEdges";
+        case kGetVertices:
+            return "getVertices";
+        case kGetNeighbors:
+            return "getNeighbors";
+        default:
+            break;
+    }
+    return "unknown";
+}
+
+void StoragePerfAction::appendVId(uint64_t vid, utils::StatementBuffer& stmt) const {
+    if (stringVid_) {
+        stmt.append('"').appendUint(vid).append('"');
+    } else {
+        stmt.appendUint(vid);
     }
-    std::string randomMsg;
+}
+
+void StoragePerfAction::appendMsg(utils::StatementBuffer& stmt) const {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+    stmt.append(":(\"");
     if (randomMsg_) {
-        randomMsg = "true";
+        auto* data = stmt.grow(10);
+        for (int32_t i = 0; i < 10; i++) {
+            data[i] = charset[folly::Random::rand32(sizeof(charset) - 1)];
+        }
     } else {
-        randomMsg = "false";
-    }
-
-    auto commandStr = folly::stringPrintf("nohup %s --meta_server_addrs=%s --method=%s"
-                                          " --totalReqs=%lu --threads=%u --qps=%u"
-                                          " --batch_num=%u --space_name=%s"
-                                          " --tag_name=%s --edge_name=%s --random_message=%s"
-                                          " >/dev/null 2>&1 &",
-                                          perfPath_.c_str(),
-                                          metaServerAddrs_.c_str(),
-                                          method_.c_str(),
-                                          totalReqs_,
-                                          threads_,
-                                          qps_,
-                                          batchNum_,
-                                          spaceName_.c_str(),
-                                          tagName_.c_str(),
-                                          edgeName_.c_str(),
-                                          randomMsg.c_str());
-    LOG(INFO) << "storage perf command : " << commandStr;
-    std::system(commandStr.c_str());
-    sleep(exeTime_);
-
-    // Note, keep totalReqs_ large enough, after sleep exeTime_,
-    // storage perf process still exists
-    // check storage perf is running
-    FILE* fp = popen("ps -ux|grep storage_perf|grep -v grep|awk '{print $2}'", "r");
-    if (!fp) {
-        LOG(ERROR) << "Failed to exec \"ps -ux|grep storage_perf|grep -v grep|awk '{print $2}'\"";
-        return ResultCode::ERR_FAILED;
+        stmt.append("perf");
     }
-    char buffer[256];
-    auto numChars = fgets(buffer, sizeof(buffer), fp);
-    UNUSED(numChars);
-    pclose(fp);
+    stmt.append("\")");
+}
 
-    if (std::string(buffer).empty()) {
+void StoragePerfAction::buildStmt(Method method, utils::StatementBuffer& stmt) const {
+    stmt.clear();
+    switch (method) {
+        case kAddVertices:
+            stmt.append("INSERT VERTEX ").append(tagName_)
+                .append(" (").append(propName_).append(") VALUES ");
+            break;
+        case kAddEdges:
+            stmt.append("INSERT EDGE ").append(edgeName_)
+                .append(" (").append(propName_).append(") VALUES ");
+            break;
+        case kGetVertices:
+            stmt.append("FETCH PROP ON ").append(tagName_).append(' ');
+            break;
+        case kGetNeighbors:
+            stmt.append("GO FROM ");
+            break;
+        default:
+            LOG(FATAL) << "Unknown method " << static_cast<int32_t>(method);
+    }
+    for (uint32_t i = 0; i < batchNum_; i++) {
+        if (i != 0) {
+            stmt.append(',');
+        }
+        appendVId(folly::Random::rand64(1, keyRange_ + 1), stmt);
+        if (method == kAddVertices) {
+            appendMsg(stmt);
+        } else if (method == kAddEdges) {
+            stmt.append("->");
+            appendVId(folly::Random::rand64(1, keyRange_ + 1), stmt);
+            appendMsg(stmt);
+        }
+    }
+    if (method == kGetVertices) {
+        stmt.append(" YIELD ").append(tagName_).append('.').append(propName_);
+    } else if (method == kGetNeighbors) {
+        stmt.append(" OVER ").append(edgeName_)
+            .append(" YIELD ").append(edgeName_).append('.').append(propName_);
+    }
+}
+
+ResultCode StoragePerfAction::doRun() {
+    CHECK_NOTNULL(client_);
+    std::vector<utils::Histogram*> metrics;
+    for (int32_t method = 0; method < kMethods; method++) {
+        metrics.emplace_back(utils::Metrics::histogram(
+                "chaos_perf_latency_us", {{"method", methodName(static_cast<Method>(method))}}));
+    }
+    LoadLoop load(client_, std::vector<uint32_t>(mix_.begin(), mix_.end()), std::move(metrics));
+    LoadLoop::Options opts;
+    opts.workers = threads_;
+    opts.duration = std::chrono::seconds(exeTime_);
+    opts.maxReqs = totalReqs_;
+    opts.qps = qps_;
+    LOG(INFO) << "Begin storage perf, " << threads_ << " threads, qps " << qps_
+              << ", batch " << batchNum_ << ", at most " << totalReqs_ << " requests in "
+              << exeTime_ << "s";
+    auto ok = load.run(opts,
+                       [this] (size_t method, utils::StatementBuffer& stmt) {
+                           buildStmt(static_cast<Method>(method), stmt);
+                       },
+                       [this] (std::string detail) {
+                           setDetail(std::move(detail));
+                       });
+    if (!ok) {
+        return ResultCode::ERR_BAD_ARGUMENT;
+    }
+
+    auto costMs = load.costMs();
+    auto snapshot = load.total().snapshot();
+    auto errors = load.totalErrors();
+    auto qps = snapshot.count * 1000.0 / costMs;
+    LOG(INFO) << "Storage perf sent " << snapshot.count << " requests in " << costMs << "ms, "
+              << qps << " qps, errors " << errors << ", latency (us) "
+              << snapshot.toString() << ", p999 " << snapshot.percentile(0.999);
+    if (!resultVar_.empty()) {
+        CHECK_NOTNULL(ctx_);
+        auto& exprCtx = ctx_->exprCtx;
+        exprCtx.setVar(resultVar_ + "_qps", qps);
+        exprCtx.setVar(resultVar_ + "_requests", static_cast<int64_t>(snapshot.count));
+        exprCtx.setVar(resultVar_ + "_errors", static_cast<int64_t>(errors));
+        exprCtx.setVar(resultVar_ + "_p50_us", static_cast<int64_t>(snapshot.percentile(0.5)));
+        exprCtx.setVar(resultVar_ + "_p99_us", static_cast<int64_t>(snapshot.percentile(0.99)));
+        exprCtx.setVar(resultVar_ + "_p999_us",
+                       static_cast<int64_t>(snapshot.percentile(0.999)));
+        exprCtx.setVar(resultVar_ + "_max_us", static_cast<int64_t>(snapshot.max));
+    }
+    if (snapshot.count == 0 || errors == snapshot.count) {
+        LOG(ERROR) << "No request of the storage perf succeeded";
         return ResultCode::ERR_FAILED;
-    } else {
-        std::system("ps -ux|grep storage_perf|grep -v grep|awk '{print $2}'|xargs kill -9");
-        usleep(1000);
     }
     return ResultCode::OK;
 }
@@ -10,8 +10,11 @@
 #include "common/base/Base.h"
 #include "common/datatypes/Value.h"
 #include "core/Action.h"
+#include "expression/ExprCompiler.h"
 #include "nebula/NebulaInstance.h"
 #include "nebula/client/GraphClient.h"
+#include "utils/AgentProtocol.h"
+#include "utils/StatementBuffer.h"
 #include <folly/Expected.h>
 
 namespace chaos {
@@ -126,7 +129,10 @@ public:
                       bool     randomVal = false,
                       uint32_t tryNum = 32,
                       uint32_t retryIntervalMs = 500,
-                      bool stringVid = true)
+                      bool stringVid = true,
+                      uint32_t pipelineDepth = 1,
+                      uint32_t sessions = 1,
+                      uint32_t targetQps = 0)
         : client_(client)
         , tag_(tag)
         , col_(col)
@@ -137,7 +143,10 @@ public:
         , randomVal_(randomVal)
         , try_(tryNum)
         , retryIntervalMs_(retryIntervalMs)
-        , stringVid_(stringVid) {}
+        , stringVid_(stringVid)
+        , pipelineDepth_(std::max(1U, pipelineDepth))
+        , sessions_(std::max(1U, sessions))
+        , targetQps_(targetQps) {}
 
     virtual ~WriteCircleAction() = default;
 
@@ -147,14 +156,41 @@ public:
         return folly::stringPrintf("Write data to %s", client_->serverAddress().c_str());
     }
 
+    // The throughput of the current run, e.g. "rows 1000/100000, 500 rows/s, retries 0".
+    std::string detail() const override;
+
 private:
-    ResultCode sendBatch(const std::vector<std::string>& batchCmds);
+    /**
+     * Keep pipelineDepth_ batches in flight over at least sessions_ sessions of the client.
+     * Every row is written exactly once by a single batch, so the circle
+     * is right whatever order the batches finish in.
+     * */
+    ResultCode runPipelined();
+
+    /**
+     * Open loop: batch i is due at start + i / targetQps_, whether the former ones
+     * finished or not, and up to pipelineDepth_ batches are in flight. The latency is
+     * measured from the due time, so a stall of the cluster is counted for every batch
+     * delayed by it, and the time a batch waited for a free worker is recorded as the
+     * queue delay.
+     * */
+    ResultCode runOpenLoop();
+
+    // Build the batch-th batch of the circle into stmt, return the number of rows.
+    uint64_t buildBatch(uint64_t batch, utils::StatementBuffer& stmt);
+
+    // rows is the number of rows in the batch, counted once it's sent.
+    ResultCode sendBatch(const utils::StatementBuffer& stmt, uint64_t rows);
 
-    void buildVIdAndValue(uint64_t vid, std::string val, std::vector<std::string>& cmds);
+    // Start a new INSERT statement in stmt, the memory of stmt is reused.
+    void beginBatch(utils::StatementBuffer& stmt);
 
-    void buildVIdAndValue(uint64_t vid,  uint64_t val, std::vector<std::string>& cmds);
+    // Append a row to the statement, the first row of a batch has no leading comma.
+    void appendVId(uint64_t vid, bool first, utils::StatementBuffer& stmt);
 
-    std::string genData();
+    void buildVIdAndRandomValue(uint64_t vid, bool first, utils::StatementBuffer& stmt);
+
+    void buildVIdAndValue(uint64_t vid, uint64_t val, bool first, utils::StatementBuffer& stmt);
 
 private:
     GraphClient* client_{nullptr};
@@ -172,6 +208,16 @@ private:
 
     // Write string Vid, or int Vid
     bool         stringVid_;
+
+    // Batches in flight and sessions used to send them
+    uint32_t     pipelineDepth_;
+    uint32_t     sessions_;
+    // Batches per second of the open loop mode, 0 for the closed loop.
+    uint32_t     targetQps_;
+
+    // Read by the status server while writing.
+    std::atomic<uint64_t> writtenRows_{0};
+    std::atomic<uint64_t> retries_{0};
 };
 
 class WalkThroughAction : public core::Action {
@@ -182,14 +228,18 @@ public:
                       uint64_t totalRows,
                       uint32_t tryNum = 32,
                       uint32_t retryIntervalMs = 1,
-                      bool stringVid = true)
+                      bool stringVid = true,
+                      uint32_t shards = 1,
+                      uint32_t batchSize = 100)
         : client_(client)
         , tag_(tag)
         , col_(col)
         , totalRows_(totalRows)
         , try_(tryNum)
         , retryIntervalMs_(retryIntervalMs)
-        , stringVid_(stringVid) {
+        , stringVid_(stringVid)
+        , shards_(std::max(1U, shards))
+        , batchSize_(std::max(1U, batchSize)) {
             start_ = folly::Random::rand64(totalRows_);
         }
 
@@ -211,6 +261,18 @@ public:
 private:
     folly::Expected<std::string, ResultCode> sendCommand(const std::string& cmd);
 
+    folly::Expected<DataSet, ResultCode> fetch(const utils::StatementBuffer& stmt);
+
+    /**
+     * Split the vids 1 to totalRows_ into shards_ contiguous ranges, every worker fetches
+     * batchSize_ vids at a time and checks next(i) == i + 1, and next(totalRows_) == 1.
+     * Together with every vid being found exactly once, it proves the circle is closed.
+     * */
+    ResultCode runSharded();
+
+    // Check the fetched rows of vids [first, last].
+    ResultCode checkBatch(const DataSet& resp, uint64_t first, uint64_t last);
+
 private:
     GraphClient* client_ = nullptr;
     std::string  tag_;
@@ -222,6 +284,10 @@ private:
 
     // String Vid, or int Vid
     bool         stringVid_;
+
+    // Workers and vids per FETCH of the sharded mode, only used when shards_ > 1
+    uint32_t     shards_;
+    uint32_t     batchSize_;
 };
 
 class LookUpAction : public core::Action {
@@ -231,13 +297,17 @@ public:
                  const std::string& col,
                  uint64_t totalRows,
                  uint32_t tryNum = 32,
-                 uint32_t retryIntervalMs = 1)
+                 uint32_t retryIntervalMs = 1,
+                 uint32_t batchSize = 1,
+                 uint32_t concurrency = 1)
         : client_(client)
         , tag_(tag)
         , col_(col)
         , totalRows_(totalRows)
         , try_(tryNum)
-        , retryIntervalMs_(retryIntervalMs) {
+        , retryIntervalMs_(retryIntervalMs)
+        , batchSize_(std::max(1U, batchSize))
+        , concurrency_(std::max(1U, concurrency)) {
             start_ = folly::Random::rand64(totalRows_);
         }
 
@@ -251,6 +321,17 @@ public:
         return folly::stringPrintf("LookUp the circle from %ld, total %ld", start_, totalRows_);
     }
 
+private:
+    /**
+     * Look up batchSize_ keys at a time with OR-ed conditions, in concurrency_ workers.
+     * Every key from 1 to totalRows_ must be found on exactly one vertex, the one
+     * pointing to it, otherwise the index misses or duplicates entries.
+     * */
+    ResultCode runBatched();
+
+    // Check the rows looked up by keys [first, last].
+    ResultCode checkBatch(const DataSet& resp, uint64_t first, uint64_t last);
+
 private:
     GraphClient* client_ = nullptr;
     std::string  tag_;
@@ -259,6 +340,90 @@ private:
     uint32_t     try_;
     uint32_t     retryIntervalMs_;
     uint64_t     start_ = 0;
+
+    // Keys per LOOKUP and workers of the batched mode, used when batchSize_ > 1
+    uint32_t     batchSize_;
+    uint32_t     concurrency_;
+};
+
+/**
+ * Measure the latency seen by the clients, usually while a disturbance is running.
+ * concurrency workers send a weighted mix of FETCH, INSERT and LOOKUP on random
+ * vertices of the circle for durationMs, without retrying, and the action fails if
+ * the latency percentiles or the error ratio breach the SLO.
+ *
+ * The INSERT writes the same value as WriteCircleAction, so the circle is kept.
+ * The LOOKUP needs an index on the column.
+ * */
+class LatencyProbeAction : public core::Action {
+public:
+    // The weights of the statements in the mix.
+    struct Mix {
+        uint32_t fetch{8};
+        uint32_t insert{1};
+        uint32_t lookup{0};
+    };
+
+    // The latency is checked on every op in the mix, 0 means not checked.
+    struct Slo {
+        uint64_t p50Us{0};
+        uint64_t p99Us{0};
+        uint64_t p999Us{0};
+        double   maxErrorRatio{1.0};
+    };
+
+    LatencyProbeAction(GraphClient* client,
+                       const std::string& tag,
+                       const std::string& col,
+                       uint64_t totalRows,
+                       uint64_t durationMs,
+                       uint32_t concurrency,
+                       Mix mix,
+                       Slo slo,
+                       bool stringVid = true)
+        : client_(client)
+        , tag_(tag)
+        , col_(col)
+        , totalRows_(std::max<uint64_t>(1, totalRows))
+        , durationMs_(durationMs)
+        , concurrency_(std::max(1U, concurrency))
+        , mix_(mix)
+        , slo_(slo)
+        , stringVid_(stringVid) {}
+
+    ~LatencyProbeAction() = default;
+
+    ResultCode doRun() override;
+
+    std::string toString() override {
+        return folly::stringPrintf("Probe the latency of %s for %lums, mix %u:%u:%u",
+                                   client_->serverAddress().c_str(), durationMs_,
+                                   mix_.fetch, mix_.insert, mix_.lookup);
+    }
+
+private:
+    enum Op {
+        kFetch,
+        kInsert,
+        kLookup,
+        kOps,
+    };
+
+    static const char* opName(Op op);
+
+    // Build the statement of op on the vertex vid into stmt.
+    void buildStmt(Op op, uint64_t vid, utils::StatementBuffer& stmt) const;
+
+private:
+    GraphClient* client_ = nullptr;
+    std::string  tag_;
+    std::string  col_;
+    uint64_t     totalRows_;
+    uint64_t     durationMs_;
+    uint32_t     concurrency_;
+    Mix          mix_;
+    Slo          slo_;
+    bool         stringVid_;
 };
 
 /**
@@ -701,9 +866,7 @@ public:
 class ExecutionExpressionAction : public core::Action {
 public:
     ExecutionExpressionAction(core::ActionContext* ctx,
-                              const std::string& condition)
-        : Action(ctx)
-        , condition_(condition) {}
+                              const std::string& condition);
 
     ~ExecutionExpressionAction() = default;
 
@@ -714,8 +877,13 @@ public:
                                    condition_.c_str());
     }
 
+    bool isBlocking() const override {
+        return false;
+    }
+
 private:
-    std::string             condition_;
+    std::string                     condition_;
+    std::unique_ptr<CompiledExpr>   expr_;
 };
 
 /**
@@ -836,7 +1004,7 @@ private:
     std::vector<NebulaInstance*> metas_;
     std::vector<NebulaInstance*> storages_;
     NebulaInstance* picked_;
-    std::vector<std::string> paras_;
+    std::vector<utils::Rule> rules_;
 };
 
 /**
@@ -881,7 +1049,7 @@ private:
     int32_t loss_;
     int32_t duplicate_;
     NebulaInstance* picked_;
-    std::vector<std::string> paras_;
+    std::vector<utils::Rule> rules_;
 };
 
 class FillDiskAction : public core::DisturbAction {
@@ -1085,56 +1253,98 @@ private:
     int32_t bytes_;                     // how many bytes to truncate wal
 };
 
+/**
+ * A built-in load generator on the storage, the statements are sent through the graph client.
+ * threads workers send requests paced by a token bucket of qps (0 means unlimited),
+ * each request is a batch of batchNum vertices or edges of a method picked by the
+ * weights of the mix. It stops after totalReqs requests or exeTime seconds.
+ *
+ * If resultVar is set, the achieved qps and the latency distribution are stored into
+ * the variables resultVar_qps, _requests, _errors, _p50_us, _p99_us, _p999_us and
+ * _max_us, so the plan could assert on them.
+ * */
 class StoragePerfAction : public core::Action {
 public:
-    StoragePerfAction(const std::string& perfPath,
-                      const std::string& metaServerAddrs,
-                      const std::string& method,
+    enum Method {
+        kAddVertices,
+        kAddEdges,
+        kGetVertices,
+        kGetNeighbors,
+        kMethods,
+    };
+
+    // The weight of each method.
+    using Mix = std::array<uint32_t, kMethods>;
+
+    StoragePerfAction(GraphClient* client,
+                      core::ActionContext* ctx,
+                      const Mix& mix,
                       uint64_t totalReqs,
                       uint32_t threads,
                       uint32_t qps,
                       uint32_t batchNum,
-                      const std::string& spaceName,
                       const std::string& tagName,
                       const std::string& edgeName,
+                      const std::string& propName,
+                      uint64_t keyRange,
                       bool randomMsg,
-                      uint64_t exeTime)
-        : perfPath_(perfPath)
-        , metaServerAddrs_(metaServerAddrs)
-        , method_(method)
+                      uint64_t exeTime,
+                      bool stringVid,
+                      const std::string& resultVar)
+        : core::Action(ctx)
+        , client_(client)
+        , mix_(mix)
         , totalReqs_(totalReqs)
-        , threads_(threads)
+        , threads_(std::max(1U, threads))
         , qps_(qps)
-        , batchNum_(batchNum)
-        , spaceName_(spaceName)
+        , batchNum_(std::max(1U, batchNum))
         , tagName_(tagName)
         , edgeName_(edgeName)
+        , propName_(propName)
+        , keyRange_(std::max<uint64_t>(1, keyRange))
         , randomMsg_(randomMsg)
-        , exeTime_(exeTime) {}
+        , exeTime_(exeTime)
+        , stringVid_(stringVid)
+        , resultVar_(resultVar) {}
 
     ~StoragePerfAction() = default;
 
     ResultCode doRun() override;
 
     std::string toString() override {
-        return folly::stringPrintf("Execute storage perf : %s on host: %s",
-                                    perfPath_.c_str(),
-                                    metaServerAddrs_.c_str());
+        return folly::stringPrintf("Storage perf on %s, qps %u, %u threads, %lus",
+                                   client_->serverAddress().c_str(), qps_, threads_, exeTime_);
     }
 
+    // e.g. "addVertices", the names of the methods of the storage perf tool.
+    static folly::Optional<Method> toMethod(const std::string& name);
+
+    static const char* methodName(Method method);
+
+private:
+    void appendVId(uint64_t vid, utils::StatementBuffer& stmt) const;
+
+    void appendMsg(utils::StatementBuffer& stmt) const;
+
+    // Build a request of batchNum_ random keys into stmt.
+    void buildStmt(Method method, utils::StatementBuffer& stmt) const;
+
 private:
-    std::string     perfPath_;
-    std::string     metaServerAddrs_;
-    std::string     method_;
+    GraphClient*    client_{nullptr};
+    Mix             mix_;
     uint64_t        totalReqs_;
     uint32_t        threads_;
     uint32_t        qps_;
     uint32_t        batchNum_;
-    std::string     spaceName_;
     std::string     tagName_;
     std::string     edgeName_;
+    std::string     propName_;
+    // The vids are picked from [1, keyRange_].
+    uint64_t        keyRange_;
     bool            randomMsg_;
     uint64_t        exeTime_;
+    bool            stringVid_;
+    std::string     resultVar_;
 };
 
 class CreateIndexAction : public MetaAction {
@@ -7,14 +7,73 @@
 #include "nebula/NebulaChaosPlan.h"
 #include "nebula/NebulaUtils.h"
 #include "core/WaitAction.h"
+#include "utils/Metrics.h"
+#include "utils/Parallel.h"
 #include <folly/FileUtil.h>
 #include <folly/json.h>
+#include <future>
 
 DEFINE_string(email_to, "", "mail list");
+DEFINE_int32(instance_init_concurrency, 16,
+             "How many instances fetch their conf at the same time when the plan is loaded");
+DEFINE_int32(instance_init_timeout_ms, 120000,
+             "The timeout to fetch the conf of all instances when the plan is loaded");
 
 namespace chaos {
 namespace nebula_chaos {
 
+// static
+void NebulaChaosPlan::initInstances(const std::vector<NebulaInstance*>& insts) {
+    auto start = std::chrono::steady_clock::now();
+    // Every init costs a ssh round trip, so they are run concurrently. The workers
+    // share the state instead of the stack, so it's fine to give up waiting them.
+    struct State {
+        std::vector<NebulaInstance*>    insts;
+        std::unique_ptr<std::atomic<bool>[]> done;
+        std::promise<void>              finished;
+    };
+    auto state = std::make_shared<State>();
+    state->insts = insts;
+    state->done.reset(new std::atomic<bool>[insts.size()]);
+    for (size_t i = 0; i < insts.size(); i++) {
+        state->done[i] = false;
+    }
+    auto finished = state->finished.get_future();
+    std::thread([state] {
+        utils::parallelFor(state->insts.size(),
+                           FLAGS_instance_init_concurrency,
+                           [&state] (size_t i) {
+            auto* inst = state->insts[i];
+            auto initStart = std::chrono::steady_clock::now();
+            CHECK(inst->init()) << "Init the instance on " << inst->getHost() << " failed";
+            auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - initStart).count();
+            utils::Metrics::histogram("chaos_instance_init_latency_us",
+                                      {{"type", inst->moduleName()}})->record(costUs);
+            state->done[i] = true;
+        });
+        state->finished.set_value();
+    }).detach();
+
+    if (finished.wait_for(std::chrono::milliseconds(FLAGS_instance_init_timeout_ms))
+            != std::future_status::ready) {
+        std::vector<std::string> pending;
+        for (size_t i = 0; i < insts.size(); i++) {
+            if (!state->done[i]) {
+                // The port is unknown before the conf is fetched.
+                pending.emplace_back(folly::stringPrintf("#%zu on %s",
+                                                         i, insts[i]->getHost().c_str()));
+            }
+        }
+        LOG(FATAL) << "Init the instances timeout after " << FLAGS_instance_init_timeout_ms
+                   << "ms, still waiting for " << folly::join(", ", pending);
+    }
+    auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    utils::Metrics::histogram("chaos_bootstrap_latency_us")->record(costUs);
+    LOG(INFO) << "Init " << insts.size() << " instances cost " << costUs / 1000 << "ms";
+}
+
 // static
 std::unique_ptr<PlanContext>
 NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
@@ -31,9 +90,11 @@ NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
         return nullptr;
     }
     auto jsonObj = folly::parseJson(jsonStr);
-    VLOG(1) << folly::toPrettyJson(jsonObj);
+    if (VLOG_IS_ON(1)) {
+        VLOG(1) << folly::toPrettyJson(jsonObj);
+    }
 
-    auto instances = jsonObj.at("instances");
+    const auto& instances = jsonObj.at("instances");
     CHECK(instances.isArray());
     email = jsonObj.getDefault("email", FLAGS_email_to).asString();
     auto ctx = std::make_unique<PlanContext>();
@@ -60,7 +121,6 @@ NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
                                 NebulaInstance::Type::STORAGE,
                                 confPath,
                                 user);
-            CHECK(inst.init());
             ctx->storageds.emplace_back(std::move(inst));
             insts.emplace_back(&ctx->storageds.back());
         } else if (type == "graphd") {
@@ -69,7 +129,6 @@ NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
                                 NebulaInstance::Type::GRAPH,
                                 confPath,
                                 user);
-            CHECK(inst.init());
             ctx->graphd = std::move(inst);
             insts.emplace_back(&ctx->graphd);
         } else if (type == "metad") {
@@ -78,7 +137,6 @@ NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
                                 NebulaInstance::Type::META,
                                 confPath,
                                 user);
-            CHECK(inst.init());
             ctx->metads.emplace_back(std::move(inst));
             insts.emplace_back(&ctx->metads.back());
         } else {
@@ -87,6 +145,7 @@ NebulaChaosPlan::loadInstanceFromFile(const std::string& instanceFilename,
         it++;
     }
 
+    initInstances(insts);
     return ctx;
 }
 
@@ -109,46 +168,26 @@ NebulaChaosPlan::loadActionFromFile(const std::string& actionFilename,
     }
 
     auto jsonObj = folly::parseJson(jsonStr);
-    VLOG(1) << folly::toPrettyJson(jsonObj);
+    // Printing a generated plan may cost more than loading it.
+    if (VLOG_IS_ON(1)) {
+        VLOG(1) << folly::toPrettyJson(jsonObj);
+    }
     auto planName = jsonObj.at("name").asString();
     auto concurrency = jsonObj.at("concurrency").asInt();
     auto rolling = jsonObj.getDefault("rolling_table", true).asBool();
-    auto actionsItem = jsonObj.at("actions");
 
     auto plan = std::make_unique<NebulaChaosPlan>(std::move(ctx), concurrency, emailTo, planName);
-    std::vector<std::unique_ptr<core::Action>> actions;
     LoadContext loadCtx;
-    loadCtx.insts = std::move(insts);
+    loadCtx.insts = insts;
     loadCtx.gClient = plan->getGraphClient();
     loadCtx.rolling = rolling;
     loadCtx.planCtx = plan->getContext();
 
-    {
-        auto actionIt = actionsItem.begin();
-        while (actionIt != actionsItem.end()) {
-            CHECK(actionIt->isObject());
-            auto action = Utils::loadAction(*actionIt, loadCtx);
-            CHECK(action != nullptr);
-            action->setId(actions.size());
-            actions.emplace_back(std::move(action));
-            actionIt++;
-        }
-    }
-    {
-        auto actionIt = actionsItem.begin();
-        int32_t index = 0;
-        while (actionIt != actionsItem.end()) {
-            CHECK(actionIt->isObject());
-            LOG(INFO) << "Load the " << index << " action's dependees!";
-            auto depends = actionIt->at("depends");
-            for (auto& dependeeIndex : depends) {
-                auto i = dependeeIndex.asInt();
-                actions[index]->addDependee(actions[i].get());
-            }
-            actionIt++;
-            index++;
-        }
-    }
+    auto start = std::chrono::steady_clock::now();
+    auto actions = Utils::loadActions(jsonObj.at("actions"), loadCtx);
+    LOG(INFO) << "Load " << actions.size() << " actions cost "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start).count() << "ms";
     plan->addActions(std::move(actions));
     return plan;
 }
@@ -167,5 +206,30 @@ NebulaChaosPlan::loadFromFile(const std::string& instanceFilename,
     return loadActionFromFile(actionFilename, std::move(ctx), insts, emailTo);
 }
 
+void NebulaChaosPlan::prepare() {
+    if (FLAGS_instance_probe_interval_ms <= 0) {
+        return;
+    }
+    std::vector<NebulaInstance*> insts;
+    for (auto& inst : ctx_->storageds) {
+        insts.emplace_back(&inst);
+    }
+    for (auto& inst : ctx_->metads) {
+        insts.emplace_back(&inst);
+    }
+    if (!ctx_->graphd.getHost().empty()) {
+        insts.emplace_back(&ctx_->graphd);
+    }
+    monitor_ = std::make_unique<InstanceMonitor>(std::move(insts));
+    monitor_->start(std::chrono::milliseconds(FLAGS_instance_probe_interval_ms));
+}
+
+void NebulaChaosPlan::finish() {
+    // Stop probing before the ssh masters are closed, otherwise it would reopen them.
+    if (monitor_ != nullptr) {
+        monitor_->stop();
+    }
+}
+
 }   // namespace nebula_chaos
 }   // namespace chaos
@@ -9,6 +9,7 @@
 
 #include "common/base/Base.h"
 #include "nebula/NebulaAction.h"
+#include "nebula/InstanceMonitor.h"
 #include "core/ChaosPlan.h"
 #include "core/Action.h"
 
@@ -50,11 +51,19 @@ public:
                        const std::vector<NebulaInstance*>& insts,
                        const std::string email);
 
+    /**
+     * Init the instances concurrently, at most --instance_init_concurrency at the same time.
+     * It's fatal if they are not finished within --instance_init_timeout_ms.
+     * */
+    static void initInstances(const std::vector<NebulaInstance*>& insts);
+
     static std::unique_ptr<NebulaChaosPlan>
     loadFromFile(const std::string& instanceFilename, const std::string& actionFilename);
 
-    void prepare() override {
-    }
+    // Start revalidating the cached state of the instances, see --instance_probe_interval_ms
+    void prepare() override;
+
+    void finish() override;
 
     GraphClient* getGraphClient() {
         return client_.get();
@@ -67,6 +76,8 @@ public:
 protected:
     std::unique_ptr<PlanContext> ctx_;
     std::unique_ptr<GraphClient> client_;
+    // Declared last, so it's stopped before the instances are released.
+    std::unique_ptr<InstanceMonitor> monitor_;
 };
 
 }   // namespace nebula_chaos
@@ -7,41 +7,192 @@
 #include "nebula/NebulaInstance.h"
 #include "utils/SshHelper.h"
 #include <boost/algorithm/string.hpp>
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+#include <sys/stat.h>
+
+DEFINE_string(conf_cache_dir, "",
+              "The directory to cache the conf of the instances across the runs, "
+              "empty to disable it");
 
 namespace chaos {
 namespace nebula_chaos {
 
+namespace {
+
+// Parse the "--key=value" lines of the conf.
+folly::dynamic parseConfLines(const std::string& content) {
+    auto conf = folly::dynamic::object();
+    int lineNo = 0;
+    folly::gen::lines(content) | [&](folly::StringPiece line) {
+        lineNo++;
+        VLOG(1) << lineNo << ":" << line;
+        if (line.startsWith("--")) {
+            std::vector<folly::StringPiece> kv;
+            folly::split("=", line, kv, true);
+            if (kv.size() == 2) {
+                conf[kv[0]] = kv[1];
+            } else {
+                LOG(ERROR) << "Bad format line, " << line;
+            }
+        }
+    };
+    CHECK_LT(0, lineNo);
+    return conf;
+}
+
+// Whether it's "<mtime> <size>" printed by stat, it's spliced into the remote command.
+bool isStat(folly::StringPiece stat) {
+    auto pos = stat.find(' ');
+    if (pos == folly::StringPiece::npos) {
+        return false;
+    }
+    auto isNumber = [] (folly::StringPiece str) {
+        return !str.empty() && std::all_of(str.begin(), str.end(), isdigit);
+    };
+    return isNumber(stat.subpiece(0, pos)) && isNumber(stat.subpiece(pos + 1));
+}
+
+// Escape the chars other than [0-9A-Za-z.-] as "_xx" in hex, so different names never collide.
+std::string escapeName(folly::StringPiece name) {
+    std::string escaped;
+    for (auto c : name) {
+        if (isalnum(c) || c == '.' || c == '-') {
+            escaped.push_back(c);
+        } else {
+            escaped.append(folly::stringPrintf("_%02x", static_cast<uint8_t>(c)));
+        }
+    }
+    return escaped;
+}
+
+// Make the relative path absolute.
+std::string absolute(const std::string& path, const std::string& installPath) {
+    if (boost::starts_with(path, "/")) {
+        return path;
+    }
+    return folly::stringPrintf("%s/%s", installPath.c_str(), path.c_str());
+}
+
+folly::Optional<std::string> getString(const folly::dynamic& raw, folly::StringPiece key) {
+    auto it = raw.find(key);
+    if (it == raw.items().end() || !it->second.isString()) {
+        VLOG(1) << "Can't find the " << key << " in conf";
+        return folly::none;
+    }
+    return it->second.asString();
+}
+
+folly::Optional<int32_t> getInt(const folly::dynamic& raw, folly::StringPiece key) {
+    auto str = getString(raw, key);
+    if (!str.hasValue()) {
+        return folly::none;
+    }
+    auto val = folly::tryTo<int32_t>(str.value());
+    if (!val.hasValue()) {
+        LOG(ERROR) << "Parse " << key << " failed, the value is " << str.value();
+        return folly::none;
+    }
+    return val.value();
+}
+
+}   // namespace
+
+// static
+NebulaConf NebulaConf::index(folly::dynamic raw, const std::string& installPath) {
+    NebulaConf conf;
+    conf.port = getInt(raw, "--port");
+    conf.httpPort = getInt(raw, "--ws_http_port");
+    auto pidFile = getString(raw, "--pid_file");
+    if (pidFile.hasValue()) {
+        conf.pidFile = absolute(pidFile.value(), installPath);
+    }
+    auto dataPath = getString(raw, "--data_path");
+    if (dataPath.hasValue()) {
+        std::vector<std::string> paths;
+        folly::split(",", dataPath.value(), paths);
+        for (auto& path : paths) {
+            path = absolute(path, installPath);
+        }
+        conf.dataPaths = std::move(paths);
+    }
+    conf.raw = std::move(raw);
+    return conf;
+}
+
+// static
+std::string NebulaInstance::confCacheFile(const std::string& host, const std::string& confFile) {
+    return folly::stringPrintf("%s/%s@%s.json",
+                               FLAGS_conf_cache_dir.c_str(),
+                               escapeName(host).c_str(),
+                               escapeName(confFile).c_str());
+}
+
 bool NebulaInstance::parseConf(const std::string& confFile) {
     LOG(INFO) << "Parse conf file " << confFile
               << " on " << host_;
-    this->conf_ = folly::dynamic::object;
+    // The cached conf is valid if the mtime and the size of the remote file are not changed.
+    std::string cacheFile;
+    folly::dynamic cached = nullptr;
+    std::string cachedStat;
+    if (!FLAGS_conf_cache_dir.empty()) {
+        cacheFile = confCacheFile(host_, confFile);
+        std::string jsonStr;
+        if (folly::readFile(cacheFile.c_str(), jsonStr)) {
+            try {
+                cached = folly::parseJson(jsonStr);
+                cachedStat = cached.at("stat").asString();
+                if (!isStat(cachedStat)) {
+                    throw std::runtime_error("bad stat \"" + cachedStat + "\"");
+                }
+            } catch (const std::exception& e) {
+                LOG(WARNING) << "Bad conf cache " << cacheFile << ", " << e.what();
+                cached = nullptr;
+                cachedStat.clear();
+            }
+        }
+    }
+    // Only one round trip, the first line is the stat, then the content if it's changed.
+    auto command = folly::stringPrintf("s=$(stat -c '%%Y %%s' %s) && echo \"$s\" && "
+                                       "{ [ \"$s\" = \"%s\" ] || cat %s; }",
+                                       confFile.c_str(),
+                                       cachedStat.c_str(),
+                                       confFile.c_str());
+    std::string out;
     auto ret = utils::SshHelper::run(
-                    folly::stringPrintf("cat %s", confFile.c_str()),
+                    command,
                     host_,
-                    [this] (const std::string& outMsg) {
+                    [&out] (const std::string& outMsg) {
                         VLOG(1) << "The output is " << outMsg;
-                        int lineNo = 0;
-                        folly::gen::lines(outMsg) | [&](folly::StringPiece line) {
-                            lineNo++;
-                            VLOG(1) << lineNo << ":" << line;
-                            if (line.startsWith("--")) {
-                                std::vector<folly::StringPiece> kv;
-                                folly::split("=", line, kv, true);
-                                if (kv.size() == 2) {
-                                    this->conf_[kv[0]] = kv[1];
-                                } else {
-                                    LOG(ERROR) << "Bad format line, " << line;
-                                }
-                            }
-                        };
-                        CHECK_LT(0, lineNo);
+                        out = outMsg;
                     },
                     [] (const std::string& errMsg) {
                         LOG(ERROR) << "The error is " << errMsg;
                     },
                     owner_);
     CHECK_EQ(0, ret.exitStatus());
-    LOG(INFO) << "The conf is " << this->conf_;
+    auto pos = out.find('\n');
+    auto stat = folly::trimWhitespace(folly::StringPiece(out).subpiece(0, pos)).str();
+    if (!cachedStat.empty() && stat == cachedStat) {
+        this->conf_ = NebulaConf::index(cached.at("conf"), installPath_);
+        LOG(INFO) << "Reuse the cached conf " << cacheFile;
+    } else {
+        this->conf_ = NebulaConf::index(
+                parseConfLines(pos == std::string::npos ? "" : out.substr(pos + 1)),
+                installPath_);
+        if (!cacheFile.empty()) {
+            folly::dynamic obj = folly::dynamic::object("host", host_)
+                                                       ("path", confFile)
+                                                       ("stat", stat)
+                                                       ("conf", this->conf_.raw);
+            ::mkdir(FLAGS_conf_cache_dir.c_str(), 0755);
+            auto err = folly::writeFileAtomicNoThrow(cacheFile, folly::toPrettyJson(obj));
+            if (err != 0) {
+                LOG(WARNING) << "Write the conf cache " << cacheFile << " failed, errno " << err;
+            }
+        }
+    }
+    LOG(INFO) << "The conf is " << this->conf_.raw;
     return true;
 }
 
@@ -74,27 +225,24 @@ bool NebulaInstance::init() {
 }
 
 folly::Optional<int32_t> NebulaInstance::getPid(bool skipCache) {
-    if (pid_ != -1 && !skipCache) {
-        return pid_;
+    auto cached = cache_->pid.load(std::memory_order_acquire);
+    if (cached != -1 && !skipCache) {
+        return cached;
     }
-    auto it = conf_.find("--pid_file");
-    if (it == conf_.items().end()) {
+    const auto& pidFile = this->pidFile();
+    if (!pidFile.hasValue()) {
         LOG(ERROR) << "Can't find the pid file in conf";
         return folly::none;
     }
-    VLOG(1) << "Found the pid file " << it->second;
-    std::string pidFile = it->second.asString();
-    // It is relative path.
-    if (!boost::starts_with(pidFile, "/")) {
-        pidFile = folly::stringPrintf("%s/%s", installPath_.c_str(), pidFile.c_str());
-    }
+    auto gen = generation();
+    folly::Optional<int32_t> pid;
     auto ret = utils::SshHelper::run(
-                    folly::stringPrintf("cat %s", pidFile.c_str()),
+                    folly::stringPrintf("cat %s", pidFile.value().c_str()),
                     host_,
-                    [this] (const std::string& outMsg) {
+                    [&pid] (const std::string& outMsg) {
                         VLOG(1) << "The output is " << outMsg;
                         try {
-                            this->pid_ = folly::to<int32_t>(outMsg);
+                            pid = folly::to<int32_t>(outMsg);
                         } catch (const folly::ConversionError& e) {
                             LOG(ERROR) << "Parse pid file failed, error " << e.what();
                         }
@@ -103,97 +251,86 @@ folly::Optional<int32_t> NebulaInstance::getPid(bool skipCache) {
                         LOG(ERROR) << "The error is " << errMsg;
                     },
                     owner_);
-    if (ret.exitStatus() != 0) {
+    if (ret.exitStatus() != 0 || !pid.hasValue()) {
         return folly::none;
     }
-    LOG(INFO) << "The pid for current instance is " << pid_;
-    return pid_;
-}
-
-folly::Optional<int32_t> NebulaInstance::getIntFromConf(const std::string& key) const {
-    try {
-        // CHECK(conf_.isObject());
-        auto it = conf_.find(folly::stringPrintf("--%s", key.c_str()));
-        if (it == conf_.items().end()) {
-            LOG(ERROR) << "Can't find the " << key << " in conf";
-            return folly::none;
+    {
+        // Don't cache it if the instance has been restarted meanwhile.
+        std::lock_guard<std::mutex> lk(cache_->lock);
+        if (cache_->gen.load() == gen) {
+            cache_->pid.store(pid.value(), std::memory_order_release);
         }
-        VLOG(1) << "Found the " <<  key << ":" << it->second;
-        return folly::to<int32_t>(it->second.asString());
-    } catch (const folly::ConversionError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
-    } catch (const folly::TypeError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
     }
+    LOG(INFO) << "The pid for current instance is " << pid.value();
+    return pid;
 }
 
-folly::Optional<std::string> NebulaInstance::getStringFromConf(const std::string& key) const {
-    try {
-        // CHECK(conf_.isObject());
-        auto it = conf_.find(folly::stringPrintf("--%s", key.c_str()));
-        if (it == conf_.items().end()) {
-            LOG(ERROR) << "Can't find the " << key << " in conf";
-            return folly::none;
-        }
-        VLOG(1) << "Found the " <<  key << ":" << it->second;
-        return it->second.asString();
-    } catch (const folly::ConversionError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
-    } catch (const folly::TypeError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
-    }
+void NebulaInstance::invalidate() {
+    std::lock_guard<std::mutex> lk(cache_->lock);
+    cache_->pid.store(-1, std::memory_order_release);
+    cache_->gen++;
 }
 
-folly::Optional<int32_t> NebulaInstance::getPort() const {
-    return getIntFromConf("port");
+void NebulaInstance::beginChange() {
+    std::lock_guard<std::mutex> lk(cache_->lock);
+    cache_->changing++;
+    cache_->pid.store(-1, std::memory_order_release);
+    cache_->gen++;
 }
 
-folly::Optional<int32_t> NebulaInstance::getHttpPort() const {
-    return getIntFromConf("ws_http_port");
+void NebulaInstance::endChange() {
+    std::lock_guard<std::mutex> lk(cache_->lock);
+    CHECK_GT(cache_->changing, 0);
+    cache_->changing--;
+    // The probes sent during the change are dropped as well.
+    cache_->gen++;
 }
 
-folly::Optional<std::vector<std::string>>
-NebulaInstance::dataDirs() const {
-    try {
-        // CHECK(conf_.isObject());
-        auto it = conf_.find("--data_path");
-        if (it == conf_.items().end()) {
-            LOG(ERROR) << "Can't find data_path in conf";
-            return folly::none;
-        }
-        auto pathStr = it->second.asString();
-        std::vector<std::string> strArray;
-        folly::split(",", pathStr, strArray);
-        for (auto& dataPath : strArray) {
-            if (!boost::starts_with(dataPath, "/")) {
-                dataPath = folly::stringPrintf("%s/%s", installPath_.c_str(), dataPath.c_str());
+void NebulaInstance::onProbed(uint64_t gen, bool alive, int32_t pid) {
+    std::lock_guard<std::mutex> lk(cache_->lock);
+    if (cache_->changing > 0 || cache_->gen.load() != gen) {
+        VLOG(1) << "Drop the stale probe of " << toString();
+        return;
+    }
+    auto state = cache_->state.load();
+    if (alive) {
+        cache_->pid.store(pid, std::memory_order_release);
+        if (state != State::RUNNING) {
+            if (state == State::STOPPED) {
+                LOG(WARNING) << toString() << " has been started outside the plan, pid " << pid;
+            } else {
+                LOG(INFO) << toString() << " is running, pid " << pid;
             }
+            cache_->state.store(State::RUNNING, std::memory_order_release);
+            cache_->gen++;
+        }
+    } else {
+        cache_->pid.store(-1, std::memory_order_release);
+        if (state == State::RUNNING) {
+            LOG(WARNING) << toString() << " has exited unexpectedly";
+            cache_->state.store(State::STOPPED, std::memory_order_release);
+            cache_->gen++;
         }
-        return strArray;
-    } catch (const folly::ConversionError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
-    } catch (const folly::TypeError& e) {
-        LOG(ERROR) << "Parse failed, error " << e.what();
-        return folly::none;
     }
 }
 
-folly::Optional<std::vector<std::string>>
+const folly::Optional<std::vector<std::string>>&
 NebulaInstance::walDirs(int64_t spaceId) const {
-    auto data = dataDirs();
-    if (!data.hasValue()) {
+    std::lock_guard<std::mutex> lk(cache_->walLock);
+    auto it = cache_->walDirs.find(spaceId);
+    if (it != cache_->walDirs.end()) {
+        return it->second;
+    }
+    auto& walPaths = cache_->walDirs[spaceId];
+    if (!conf_.dataPaths.hasValue()) {
         LOG(ERROR) << "Get data path failed!";
-        return folly::none;
+        return walPaths;
     }
-    std::vector<std::string> walPaths;
-    walPaths.reserve(8);
-    for (auto& dataPath : data.value()) {
-        walPaths.emplace_back(folly::stringPrintf("%s/nebula/%ld/wal", dataPath.c_str(), spaceId));
+    walPaths.emplace();
+    walPaths->reserve(conf_.dataPaths->size());
+    for (auto& dataPath : conf_.dataPaths.value()) {
+        walPaths->emplace_back(folly::stringPrintf("%s/nebula/%ld/wal",
+                                                   dataPath.c_str(), spaceId));
     }
     return walPaths;
 }
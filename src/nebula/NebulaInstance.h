@@ -8,11 +8,31 @@
 #define NEBULA_NEBULAINSTANCE_H_
 
 #include "common/base/Base.h"
+#include <atomic>
+#include <mutex>
 #include <folly/dynamic.h>
 
+DECLARE_string(conf_cache_dir);
+
 namespace chaos {
 namespace nebula_chaos {
 
+/**
+ * The conf of an instance, it's indexed once fetched, so reading it costs neither
+ * lookups by the "--key" nor parsing.
+ * */
+struct NebulaConf {
+    folly::Optional<int32_t>                    port;
+    folly::Optional<int32_t>                    httpPort;
+    // The paths are absolute.
+    folly::Optional<std::string>                pidFile;
+    folly::Optional<std::vector<std::string>>   dataPaths;
+    // All "--key" to value
+    folly::dynamic                              raw = folly::dynamic::object();
+
+    static NebulaConf index(folly::dynamic raw, const std::string& installPath);
+};
+
 class NebulaInstance {
 public:
     enum class Type {
@@ -42,20 +62,63 @@ public:
 
     bool init();
 
+    // e.g. ${conf_cache_dir}/192.168.8.5@_2fhome_2fnebula_2fetc_2fnebula-storaged.conf.json
+    static std::string confCacheFile(const std::string& host, const std::string& confFile);
+
     /**
      * Read the pid inside PID file, so if the instance not started,
      * it will get the last pid.
+     * The pid is cached until invalidate() or a failed probe, see InstanceMonitor.
      * */
-    folly::Optional<int32_t> getPid(bool skipCache = true);
+    folly::Optional<int32_t> getPid(bool skipCache = false);
 
-    folly::Optional<int32_t> getPort() const;
+    // The absolute path of the pid file.
+    const folly::Optional<std::string>& pidFile() const {
+        return conf_.pidFile;
+    }
+
+    // Drop the cached pid, called once the instance is started, stopped or killed by us.
+    void invalidate();
 
-    folly::Optional<int32_t> getHttpPort() const;
+    /**
+     * Called before the instance is started, stopped or killed by us, until endChange()
+     * the probes are dropped, since they may see the process in the middle of the change.
+     * */
+    void beginChange();
+
+    void endChange();
+
+    /**
+     * Apply the result of a liveness probe sent at generation gen, it's dropped if the
+     * state has been changed since then, or it's being changed. The pid is cached if the
+     * instance is alive.
+     * */
+    void onProbed(uint64_t gen, bool alive, int32_t pid);
+
+    // It's bumped whenever the cached state is changed by us.
+    uint64_t generation() const {
+        return cache_->gen.load(std::memory_order_acquire);
+    }
+
+    const NebulaConf& conf() const {
+        return conf_;
+    }
+
+    folly::Optional<int32_t> getPort() const {
+        return conf_.port;
+    }
+
+    folly::Optional<int32_t> getHttpPort() const {
+        return conf_.httpPort;
+    }
 
     // Return the data_path in conf file.
-    folly::Optional<std::vector<std::string>> dataDirs() const;
+    const folly::Optional<std::vector<std::string>>& dataDirs() const {
+        return conf_.dataPaths;
+    }
 
-    folly::Optional<std::vector<std::string>> walDirs(int64_t spaceId) const;
+    // The wal dirs of the space in every data path, they are built once per space.
+    const folly::Optional<std::vector<std::string>>& walDirs(int64_t spaceId) const;
 
     std::string startCommand(const std::string& parameters = "") const;
 
@@ -83,30 +146,51 @@ public:
         return type_;
     }
 
+    // e.g. "storaged", it's set by init()
+    const std::string& moduleName() const {
+        return moduleName_;
+    }
+
     State getState() const {
-        return state_;
+        return cache_->state.load(std::memory_order_acquire);
     }
 
     void setState(State state) {
-        state_ = state;
+        std::lock_guard<std::mutex> lk(cache_->lock);
+        cache_->state.store(state, std::memory_order_release);
+        cache_->gen++;
     }
 
 private:
-    folly::Optional<int32_t> getIntFromConf(const std::string& key) const;
-
-    folly::Optional<std::string> getStringFromConf(const std::string& key) const;
-
+    /**
+     * Fetch and parse the conf file. With --conf_cache_dir, the parsed conf is cached
+     * locally, and it's reused if the mtime and the size of the remote file are unchanged.
+     * */
     bool parseConf(const std::string& confFile);
 
     std::string command(const std::string& cmd) const;
 
 private:
-    folly::dynamic conf_;
+    // The state could be read and changed by the actions and the monitor concurrently.
+    struct Cache {
+        // Serialize the changes, the reads are lock free.
+        std::mutex              lock;
+        std::atomic<State>      state{State::UNUSED};
+        std::atomic<int32_t>    pid{-1};
+        std::atomic<uint64_t>   gen{0};
+        // How many changes are in flight, see beginChange().
+        int32_t                 changing{0};
+        // The nodes are never erased, so it's fine to return the reference of them.
+        std::mutex              walLock;
+        std::unordered_map<int64_t, folly::Optional<std::vector<std::string>>> walDirs;
+    };
+
+    NebulaConf conf_;
     std::string host_;
     std::string installPath_;
     Type type_;
-    State state_ = State::UNUSED;
-    int32_t     pid_ = -1;
+    // Kept behind a pointer so the instance could be moved.
+    std::unique_ptr<Cache> cache_{std::make_unique<Cache>()};
     std::string moduleName_;
     std::string confPath_;
     std::string owner_;
@@ -0,0 +1,747 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "nebula/NebulaUtils.h"
+#include <folly/json.h>
+#include "nebula/ActionRegistry.h"
+
+namespace chaos {
+namespace nebula_chaos {
+
+namespace {
+
+ActionPtr loadStartAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    auto parameters = obj.getDefault("parameters", "").asString();
+    return std::make_unique<StartAction>(ctx.insts[instIndex], parameters);
+}
+CHAOS_REGISTER_ACTION(StartAction, loadStartAction, {"inst_index"}, {"parameters"});
+
+ActionPtr loadStopAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    return std::make_unique<StopAction>(ctx.insts[instIndex]);
+}
+CHAOS_REGISTER_ACTION(StopAction, loadStopAction, {"inst_index"}, {});
+
+ActionPtr loadWaitAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto waitTimeMs = obj.at("wait_time_ms").asInt();
+    CHECK_GT(waitTimeMs, 0);
+    return std::make_unique<core::WaitAction>(waitTimeMs);
+}
+CHAOS_REGISTER_ACTION(WaitAction, loadWaitAction, {"wait_time_ms"}, {});
+
+ActionPtr loadCrashAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    return std::make_unique<CrashAction>(ctx.insts[instIndex]);
+}
+CHAOS_REGISTER_ACTION(CrashAction, loadCrashAction, {"inst_index"}, {});
+
+ActionPtr loadClientConnectAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    return std::make_unique<ClientConnectAction>(ctx.gClient);
+}
+CHAOS_REGISTER_ACTION(ClientConnectAction, loadClientConnectAction, {}, {});
+
+ActionPtr loadWriteCircleAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto tag = obj.at("tag").asString();
+    if (ctx.rolling) {
+        tag = Utils::getOperatingTable(tag);
+    }
+    auto col = obj.at("col").asString();
+    auto totalRows = obj.getDefault("total_rows", 100000).asInt();
+    auto batchNum = obj.getDefault("batch_num", 1).asInt();
+    auto rowSize = obj.getDefault("row_size", 10).asInt();
+    auto startId = obj.getDefault("start_id", 1).asInt();
+    auto randomVal = obj.getDefault("random_value", false).asBool();
+    auto tryNum = obj.getDefault("try_num", 32).asInt();
+    auto retryInterval = obj.getDefault("retry_interval_ms", 500).asInt();
+    auto stringVid = obj.getDefault("string_vid", true).asBool();
+    auto pipelineDepth = obj.getDefault("pipeline_depth", 1).asInt();
+    auto sessions = obj.getDefault("sessions", 1).asInt();
+    // Batches per second, the writer runs in the open loop if it's set.
+    auto targetQps = obj.getDefault("target_qps", 0).asInt();
+    return std::make_unique<WriteCircleAction>(ctx.gClient,
+                                               tag,
+                                               col,
+                                               totalRows,
+                                               batchNum,
+                                               rowSize,
+                                               startId,
+                                               randomVal,
+                                               tryNum,
+                                               retryInterval,
+                                               stringVid,
+                                               pipelineDepth,
+                                               sessions,
+                                               targetQps);
+}
+CHAOS_REGISTER_ACTION(WriteCircleAction, loadWriteCircleAction,
+                      {"tag", "col"},
+                      {"total_rows", "batch_num", "row_size", "start_id", "random_value",
+                       "try_num", "retry_interval_ms", "string_vid", "pipeline_depth", "sessions",
+                       "target_qps"});
+
+ActionPtr loadWalkThroughAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto tag = obj.at("tag").asString();
+    if (ctx.rolling) {
+        tag = Utils::getOperatingTable(tag);
+    }
+    auto col = obj.at("col").asString();
+    auto totalRows = obj.getDefault("total_rows", 100000).asInt();
+    auto tryNum = obj.getDefault("try_num", 32).asInt();
+    auto retryInterval = obj.getDefault("retry_interval_ms", 100).asInt();
+    auto stringVid = obj.getDefault("string_vid", true).asBool();
+    auto shards = obj.getDefault("shards", 1).asInt();
+    auto batchSize = obj.getDefault("batch_size", 100).asInt();
+    return std::make_unique<WalkThroughAction>(ctx.gClient,
+                                               tag,
+                                               col,
+                                               totalRows,
+                                               tryNum,
+                                               retryInterval,
+                                               stringVid,
+                                               shards,
+                                               batchSize);
+}
+CHAOS_REGISTER_ACTION(WalkThroughAction, loadWalkThroughAction,
+                      {"tag", "col"},
+                      {"total_rows", "try_num", "retry_interval_ms", "string_vid", "shards",
+                       "batch_size"});
+
+ActionPtr loadCreateSpaceAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto spaceName = obj.at("space_name").asString();
+    auto replica = obj.getDefault("replica", 3).asInt();
+    auto parts = obj.getDefault("parts", 100).asInt();
+    auto vidType = obj.getDefault("vid_type", "fixed_string").asString();
+    auto vidLen = obj.getDefault("vid_len", 8).asInt();
+    auto groupName = obj.getDefault("group_name", "").asString();
+    return std::make_unique<CreateSpaceAction>(ctx.gClient,
+                                               spaceName,
+                                               replica,
+                                               parts,
+                                               vidType,
+                                               vidLen,
+                                               groupName);
+}
+CHAOS_REGISTER_ACTION(CreateSpaceAction, loadCreateSpaceAction,
+                      {"space_name"},
+                      {"replica", "parts", "vid_type", "vid_len", "group_name"});
+
+ActionPtr loadUseSpaceAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto spaceName = obj.at("space_name").asString();
+    return std::make_unique<UseSpaceAction>(ctx.gClient,
+                                            spaceName);
+}
+CHAOS_REGISTER_ACTION(UseSpaceAction, loadUseSpaceAction, {"space_name"}, {});
+
+ActionPtr loadDropSpaceAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto spaceName = obj.at("space_name").asString();
+    return std::make_unique<DropSpaceAction>(ctx.gClient,
+                                             spaceName);
+}
+CHAOS_REGISTER_ACTION(DropSpaceAction, loadDropSpaceAction, {"space_name"}, {});
+
+ActionPtr loadCreateSchemaAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto name = obj.at("name").asString();
+    if (ctx.rolling) {
+        name = Utils::getOperatingTable(name);
+    }
+    auto edgeOrTag = obj.at("edge_or_tag").asBool();
+    const auto& propsArray = obj.at("props");
+    std::vector<NameType> props;
+    auto it = propsArray.begin();
+    while (it != propsArray.end()) {
+        auto propName = it->at("name").asString();
+        auto propType = it->at("type").asString();
+        props.emplace_back(std::move(propName), std::move(propType));
+        it++;
+    }
+    return std::make_unique<CreateSchemaAction>(ctx.gClient,
+                                                name,
+                                                props,
+                                                edgeOrTag);
+}
+CHAOS_REGISTER_ACTION(CreateSchemaAction, loadCreateSchemaAction,
+                      {"name", "edge_or_tag", "props"},
+                      {});
+
+ActionPtr loadAddGroupAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto groupName = obj.at("group_name").asString();
+    auto zoneNames = obj.at("zone_names").asString();
+    return std::make_unique<AddGroupAction>(ctx.gClient,
+                                            groupName,
+                                            zoneNames);
+}
+CHAOS_REGISTER_ACTION(AddGroupAction, loadAddGroupAction, {"group_name", "zone_names"}, {});
+
+ActionPtr loadExpandGroupAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto groupName = obj.at("group_name").asString();
+    auto zoneName = obj.at("zone_name").asString();
+    return std::make_unique<ExpandGroupAction>(ctx.gClient,
+                                               groupName,
+                                               zoneName);
+}
+CHAOS_REGISTER_ACTION(ExpandGroupAction, loadExpandGroupAction, {"group_name", "zone_name"}, {});
+
+ActionPtr loadShrinkGroupAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto groupName = obj.at("group_name").asString();
+    auto zoneName = obj.at("zone_name").asString();
+    return std::make_unique<ShrinkGroupAction>(ctx.gClient,
+                                               groupName,
+                                               zoneName);
+}
+CHAOS_REGISTER_ACTION(ShrinkGroupAction, loadShrinkGroupAction, {"group_name", "zone_name"}, {});
+
+ActionPtr loadAddZoneAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto zoneName = obj.at("zone_name").asString();
+    auto hostList = obj.at("host_list").asString();
+    return std::make_unique<AddZoneAction>(ctx.gClient,
+                                           zoneName,
+                                           hostList);
+}
+CHAOS_REGISTER_ACTION(AddZoneAction, loadAddZoneAction, {"zone_name", "host_list"}, {});
+
+ActionPtr loadExpandZoneAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto zoneName = obj.at("zone_name").asString();
+    auto host = obj.at("host").asString();
+    return std::make_unique<ExpandZoneAction>(ctx.gClient,
+                                              zoneName,
+                                              host);
+}
+CHAOS_REGISTER_ACTION(ExpandZoneAction, loadExpandZoneAction, {"zone_name", "host"}, {});
+
+ActionPtr loadShrinkZoneAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto zoneName = obj.at("zone_name").asString();
+    auto host = obj.at("host").asString();
+    return std::make_unique<ShrinkZoneAction>(ctx.gClient,
+                                              zoneName,
+                                              host);
+}
+CHAOS_REGISTER_ACTION(ShrinkZoneAction, loadShrinkZoneAction, {"zone_name", "host"}, {});
+
+ActionPtr loadCreateIndexAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto schemaName = obj.at("schema_name").asString();
+    if (ctx.rolling) {
+        schemaName = Utils::getOperatingTable(schemaName);
+    }
+
+    auto indexName = obj.at("index_name").asString();
+    if (ctx.rolling) {
+        indexName = Utils::getOperatingTable(indexName);
+    }
+
+    auto field = obj.at("field").asString();
+    auto edgeOrTag = obj.at("edge_or_tag").asBool();
+    auto stringField = obj.getDefault("string_field", false).asBool();
+    auto indexLen = obj.getDefault("index_len", 255).asInt();
+    return std::make_unique<CreateIndexAction>(ctx.gClient,
+                                               schemaName,
+                                               indexName,
+                                               field,
+                                               edgeOrTag,
+                                               stringField,
+                                               indexLen);
+}
+CHAOS_REGISTER_ACTION(CreateIndexAction, loadCreateIndexAction,
+                      {"schema_name", "index_name", "field", "edge_or_tag"},
+                      {"string_field", "index_len"});
+
+ActionPtr loadRebuildIndexAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto index = obj.at("index_name").asString();
+    if (ctx.rolling) {
+        index = Utils::getOperatingTable(index);
+    }
+    auto isEdge = obj.getDefault("edge_or_tag", false).asBool();
+
+    // The value of result_job_id is a variable name,
+    // the variable name is used to store the rebuild index job id.
+    // If the value of result_job_id is empty, the jobId variable is not stored.
+    auto jobIdVarName = obj.getDefault("result_job_id", "").asString();
+    return std::make_unique<RebuildIndexAction>(ctx.gClient,
+                                                &ctx.planCtx->actionCtx,
+                                                index,
+                                                isEdge,
+                                                jobIdVarName);
+}
+CHAOS_REGISTER_ACTION(RebuildIndexAction, loadRebuildIndexAction,
+                      {"index_name"},
+                      {"edge_or_tag", "result_job_id"});
+
+ActionPtr loadCheckJobStatusAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto jobIdVarName = obj.at("job_id").asString();
+    return std::make_unique<CheckJobStatusAction>(ctx.gClient,
+                                                  &ctx.planCtx->actionCtx,
+                                                  jobIdVarName);
+}
+CHAOS_REGISTER_ACTION(CheckJobStatusAction, loadCheckJobStatusAction, {"job_id"}, {});
+
+ActionPtr loadLookUpAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto tag = obj.at("tag").asString();
+    if (ctx.rolling) {
+        tag = Utils::getOperatingTable(tag);
+    }
+    auto field = obj.at("col").asString();
+    auto totalRows = obj.at("total_rows").asInt();
+    auto tryNum = obj.getDefault("try_num", 32).asInt();
+    auto retryInterval = obj.getDefault("retry_interval_ms", 1).asInt();
+    auto batchSize = obj.getDefault("batch_size", 1).asInt();
+    auto concurrency = obj.getDefault("concurrency", 1).asInt();
+    return std::make_unique<LookUpAction>(ctx.gClient,
+                                          tag,
+                                          field,
+                                          totalRows,
+                                          tryNum,
+                                          retryInterval,
+                                          batchSize,
+                                          concurrency);
+}
+CHAOS_REGISTER_ACTION(LookUpAction, loadLookUpAction,
+                      {"tag", "col", "total_rows"},
+                      {"try_num", "retry_interval_ms", "batch_size", "concurrency"});
+
+ActionPtr loadLatencyProbeAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto tag = obj.at("tag").asString();
+    if (ctx.rolling) {
+        tag = Utils::getOperatingTable(tag);
+    }
+    auto col = obj.at("col").asString();
+    auto totalRows = obj.getDefault("total_rows", 100000).asInt();
+    auto durationMs = obj.getDefault("duration_ms", 60000).asInt();
+    auto concurrency = obj.getDefault("concurrency", 4).asInt();
+    auto stringVid = obj.getDefault("string_vid", true).asBool();
+    LatencyProbeAction::Mix mix;
+    mix.fetch = obj.getDefault("fetch_weight", 8).asInt();
+    mix.insert = obj.getDefault("insert_weight", 1).asInt();
+    mix.lookup = obj.getDefault("lookup_weight", 0).asInt();
+    // e.g. "slo": {"p99_ms": 500, "max_error_ratio": 0.01}
+    LatencyProbeAction::Slo slo;
+    auto sloObj = obj.getDefault("slo", folly::dynamic::object);
+    CHECK(sloObj.isObject()) << "The slo of LatencyProbeAction should be an object";
+    slo.p50Us = sloObj.getDefault("p50_ms", 0).asDouble() * 1000;
+    slo.p99Us = sloObj.getDefault("p99_ms", 0).asDouble() * 1000;
+    slo.p999Us = sloObj.getDefault("p999_ms", 0).asDouble() * 1000;
+    slo.maxErrorRatio = sloObj.getDefault("max_error_ratio", 1.0).asDouble();
+    return std::make_unique<LatencyProbeAction>(ctx.gClient,
+                                                tag,
+                                                col,
+                                                totalRows,
+                                                durationMs,
+                                                concurrency,
+                                                mix,
+                                                slo,
+                                                stringVid);
+}
+CHAOS_REGISTER_ACTION(LatencyProbeAction, loadLatencyProbeAction,
+                      {"tag", "col"},
+                      {"total_rows", "duration_ms", "concurrency", "string_vid", "fetch_weight",
+                       "insert_weight", "lookup_weight", "slo"});
+
+ActionPtr loadBalanceLeaderAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    return std::make_unique<BalanceLeaderAction>(ctx.gClient);
+}
+CHAOS_REGISTER_ACTION(BalanceLeaderAction, loadBalanceLeaderAction, {}, {});
+
+ActionPtr loadBalanceDataAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto retry = obj.getDefault("retry", 64).asInt();
+    return std::make_unique<BalanceDataAction>(ctx.gClient, retry);
+}
+CHAOS_REGISTER_ACTION(BalanceDataAction, loadBalanceDataAction, {}, {"retry"});
+
+ActionPtr loadCheckLeadersAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto expectedNum = obj.at("expected_num").asInt();
+    auto spaceName = obj.at("space_name").asString();
+    // If result_var_name is specified, it is used to store the result
+    // of the leader distribution. If not specified, do not check leader distribution.
+    auto resultVarName = obj.getDefault("result_var_name", "").asString();
+    return std::make_unique<CheckLeadersAction>(ctx.gClient,
+                                                &ctx.planCtx->actionCtx,
+                                                expectedNum,
+                                                spaceName,
+                                                resultVarName);
+}
+CHAOS_REGISTER_ACTION(CheckLeadersAction, loadCheckLeadersAction,
+                      {"expected_num", "space_name"},
+                      {"result_var_name"});
+
+ActionPtr loadRandomRestartAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& insts = obj.at("insts");
+    std::vector<NebulaInstance*> targetInsts;
+    auto it = insts.begin();
+    while (it != insts.end()) {
+        auto index = it->asInt();
+        targetInsts.emplace_back(ctx.insts[index]);
+        it++;
+    }
+    auto loopTimes = obj.getDefault("loop_times", 20).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    auto graceful = obj.getDefault("graceful", false).asBool();
+    auto cleanData = obj.getDefault("clean_data", false).asBool();
+    return std::make_unique<RandomRestartAction>(targetInsts,
+                                                 loopTimes,
+                                                 nextDistubInterval,
+                                                 recoverInterval,
+                                                 graceful,
+                                                 cleanData);
+}
+CHAOS_REGISTER_ACTION(RandomRestartAction, loadRandomRestartAction,
+                      {"insts"},
+                      {"loop_times", "next_loop_interval", "restart_interval", "graceful",
+                       "clean_data"});
+
+ActionPtr loadEmptyAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto name = obj.at("name").asString();
+    return std::make_unique<core::EmptyAction>(name);
+}
+CHAOS_REGISTER_ACTION(EmptyAction, loadEmptyAction, {"name"}, {});
+
+ActionPtr loadCleanWalAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    auto spaceName = obj.at("space_name").asString();
+    return std::make_unique<CleanWalAction>(ctx.insts[instIndex], ctx.gClient, spaceName);
+}
+CHAOS_REGISTER_ACTION(CleanWalAction, loadCleanWalAction, {"inst_index", "space_name"}, {});
+
+ActionPtr loadCleanDataAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    // If space_name is specified, only data of specified space is deleted,
+    // otherwise, the whole data path is deleted.
+    auto spaceName = obj.getDefault("space_name", "").asString();
+    return std::make_unique<CleanDataAction>(ctx.insts[instIndex], ctx.gClient, spaceName);
+}
+CHAOS_REGISTER_ACTION(CleanDataAction, loadCleanDataAction, {"inst_index"}, {"space_name"});
+
+ActionPtr loadLoopAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto condition = obj.at("condition").asString();
+    auto concurrency = obj.at("concurrency").asInt();
+    auto actions = Utils::loadActions(obj.at("sub_plan"), ctx);
+    return std::make_unique<core::LoopAction>(&ctx.planCtx->actionCtx,
+                                              condition,
+                                              std::move(actions),
+                                              concurrency);
+}
+CHAOS_REGISTER_ACTION(LoopAction, loadLoopAction, {"condition", "concurrency", "sub_plan"}, {});
+
+ActionPtr loadRandomPartitionAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto graphIdx = obj.at("graph").asInt();
+    NebulaInstance* graph = ctx.insts[graphIdx];
+    const auto& metaIdxs = obj.at("metas");
+    std::vector<NebulaInstance*> metas;
+    for (auto iter = metaIdxs.begin(); iter != metaIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        metas.emplace_back(ctx.insts[index]);
+    }
+    const auto& storageIdxs = obj.at("storages");
+    std::vector<NebulaInstance*> storages;
+    for (auto iter = storageIdxs.begin(); iter != storageIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        storages.emplace_back(ctx.insts[index]);
+    }
+    auto loopTimes = obj.getDefault("loop_times", 20).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    return std::make_unique<RandomPartitionAction>(graph,
+                                                   metas,
+                                                   storages,
+                                                   loopTimes,
+                                                   nextDistubInterval,
+                                                   recoverInterval);
+}
+CHAOS_REGISTER_ACTION(RandomPartitionAction, loadRandomPartitionAction,
+                      {"graph", "metas", "storages"},
+                      {"loop_times", "next_loop_interval", "restart_interval"});
+
+ActionPtr loadRandomTrafficControlAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& storageIdxs = obj.at("storages");
+    std::vector<NebulaInstance*> storages;
+    for (auto iter = storageIdxs.begin(); iter != storageIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        storages.emplace_back(ctx.insts[index]);
+    }
+    auto loopTimes = obj.getDefault("loop_times", 20).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    auto device = obj.getDefault("device", "eth0").asString();
+    auto delay = obj.getDefault("delay", "100ms").asString();
+    auto dist = obj.getDefault("delay-distro", "20ms").asString();
+    auto loss = obj.getDefault("loss", 0).asInt();
+    auto duplicate = obj.getDefault("duplicate", 0).asInt();
+    return std::make_unique<RandomTrafficControlAction>(storages,
+                                                        loopTimes,
+                                                        nextDistubInterval,
+                                                        recoverInterval,
+                                                        device,
+                                                        delay,
+                                                        dist,
+                                                        loss,
+                                                        duplicate);
+}
+CHAOS_REGISTER_ACTION(RandomTrafficControlAction, loadRandomTrafficControlAction,
+                      {"storages"},
+                      {"loop_times", "next_loop_interval", "restart_interval", "device", "delay",
+                       "delay-distro", "loss", "duplicate"});
+
+ActionPtr loadFillDiskAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& storageIdxs = obj.at("storages");
+    std::vector<NebulaInstance*> storages;
+    for (auto iter = storageIdxs.begin(); iter != storageIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        storages.emplace_back(ctx.insts[index]);
+    }
+    auto loopTimes = obj.getDefault("loop_times", 1).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    auto count = obj.getDefault("count", 1).asInt();
+    return std::make_unique<FillDiskAction>(storages,
+                                            loopTimes,
+                                            nextDistubInterval,
+                                            recoverInterval,
+                                            count);
+}
+CHAOS_REGISTER_ACTION(FillDiskAction, loadFillDiskAction,
+                      {"storages"},
+                      {"loop_times", "next_loop_interval", "restart_interval", "count"});
+
+ActionPtr loadSlowDiskAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& storageIdxs = obj.at("storages");
+    std::vector<NebulaInstance*> storages;
+    for (auto iter = storageIdxs.begin(); iter != storageIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        storages.emplace_back(ctx.insts[index]);
+    }
+    auto loopTimes = obj.getDefault("loop_times", 1).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    auto major = obj.at("major").asInt();
+    auto minor = obj.at("minor").asInt();
+    auto delayMs = obj.at("delay_ms").asInt();
+    return std::make_unique<SlowDiskAction>(storages,
+                                            loopTimes,
+                                            nextDistubInterval,
+                                            recoverInterval,
+                                            major,
+                                            minor,
+                                            delayMs);
+}
+CHAOS_REGISTER_ACTION(SlowDiskAction, loadSlowDiskAction,
+                      {"storages", "major", "minor", "delay_ms"},
+                      {"loop_times", "next_loop_interval", "restart_interval"});
+
+ActionPtr loadCreateCheckpointAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    return std::make_unique<CreateCheckpointAction>(ctx.gClient);
+}
+CHAOS_REGISTER_ACTION(CreateCheckpointAction, loadCreateCheckpointAction, {}, {});
+
+ActionPtr loadCleanCheckpointAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    return std::make_unique<CleanCheckpointAction>(ctx.insts[instIndex]);
+}
+CHAOS_REGISTER_ACTION(CleanCheckpointAction, loadCleanCheckpointAction, {"inst_index"}, {});
+
+ActionPtr loadRestoreFromCheckpointAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    return std::make_unique<RestoreFromCheckpointAction>(ctx.insts[instIndex]);
+}
+CHAOS_REGISTER_ACTION(RestoreFromCheckpointAction, loadRestoreFromCheckpointAction,
+                      {"inst_index"},
+                      {});
+
+ActionPtr loadRestoreFromDataDirAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto sourceDataPaths = obj.getDefault("sourceDataPaths", "").asString();
+    auto instIndex = obj.at("inst_index").asInt();
+    CHECK_GE(instIndex, 0);
+    CHECK_LT(instIndex, ctx.insts.size());
+    return std::make_unique<RestoreFromDataDirAction>(ctx.insts[instIndex],
+                                                      sourceDataPaths);
+}
+CHAOS_REGISTER_ACTION(RestoreFromDataDirAction, loadRestoreFromDataDirAction,
+                      {"inst_index"},
+                      {"sourceDataPaths"});
+
+ActionPtr loadAssignAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto varName = obj.at("var_name").asString();
+    auto valExpr = obj.at("value_expr").asString();
+    return std::make_unique<core::AssignAction>(&ctx.planCtx->actionCtx,
+                                                varName,
+                                                valExpr);
+}
+CHAOS_REGISTER_ACTION(AssignAction, loadAssignAction, {"var_name", "value_expr"}, {});
+
+ActionPtr loadUpdateConfigsAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto layer = obj.at("layer").asString();
+    auto name = obj.at("name").asString();
+    auto value = obj.at("value").asString();
+    return std::make_unique<UpdateConfigsAction>(ctx.gClient,
+                                                 layer,
+                                                 name,
+                                                 value);
+}
+CHAOS_REGISTER_ACTION(UpdateConfigsAction, loadUpdateConfigsAction, {"layer", "name", "value"}, {});
+
+ActionPtr loadExecutionExpressionAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto condition = obj.at("condition").asString();
+    return std::make_unique<ExecutionExpressionAction>(&ctx.planCtx->actionCtx, condition);
+}
+CHAOS_REGISTER_ACTION(ExecutionExpressionAction, loadExecutionExpressionAction, {"condition"}, {});
+
+ActionPtr loadCompactionAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    return std::make_unique<CompactionAction>(ctx.gClient);
+}
+CHAOS_REGISTER_ACTION(CompactionAction, loadCompactionAction, {}, {});
+
+ActionPtr loadRandomTruncateRestartAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& insts = obj.at("insts");
+    std::vector<NebulaInstance*> targetInsts;
+    auto it = insts.begin();
+    while (it != insts.end()) {
+        auto index = it->asInt();
+        targetInsts.emplace_back(ctx.insts[index]);
+        it++;
+    }
+    auto loopTimes = obj.getDefault("loop_times", 20).asInt();
+    auto nextDistubInterval = obj.getDefault("next_loop_interval", 30).asInt();
+    auto recoverInterval = obj.getDefault("restart_interval", 30).asInt();
+    auto spaceName = obj.at("space_name").asString();
+    auto partId = obj.at("part_id").asInt();
+    auto bytes = obj.getDefault("bytes", 10).asInt();
+    return std::make_unique<RandomTruncateRestartAction>(targetInsts,
+                                                         loopTimes,
+                                                         nextDistubInterval,
+                                                         recoverInterval,
+                                                         ctx.gClient,
+                                                         spaceName,
+                                                         partId,
+                                                         bytes);
+}
+CHAOS_REGISTER_ACTION(RandomTruncateRestartAction, loadRandomTruncateRestartAction,
+                      {"insts", "space_name", "part_id"},
+                      {"loop_times", "next_loop_interval", "restart_interval", "bytes"});
+
+ActionPtr loadTruncateWalAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    const auto& storageIdxs = obj.at("storages");
+    std::vector<NebulaInstance*> storages;
+    for (auto iter = storageIdxs.begin(); iter != storageIdxs.end(); iter++) {
+        auto index = iter->asInt();
+        storages.emplace_back(ctx.insts[index]);
+    }
+    auto spaceName = obj.at("space_name").asString();
+    auto partId = obj.at("part_id").asInt();
+    auto count = obj.getDefault("count", 1).asInt();
+    auto bytes = obj.getDefault("bytes", 10).asInt();
+    return std::make_unique<TruncateWalAction>(storages, ctx.gClient,
+                                               spaceName, partId, count, bytes);
+}
+CHAOS_REGISTER_ACTION(TruncateWalAction, loadTruncateWalAction,
+                      {"storages", "space_name", "part_id"},
+                      {"count", "bytes"});
+
+ActionPtr loadStoragePerfAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    // Either a single method, or the weights of the methods, e.g. {"addVertices": 1}
+    StoragePerfAction::Mix mix{};
+    if (obj.count("mix")) {
+        for (const auto& weight : obj.at("mix").items()) {
+            auto method = StoragePerfAction::toMethod(weight.first.asString());
+            CHECK(method.hasValue()) << "Unknown method " << weight.first.asString();
+            mix[method.value()] = weight.second.asInt();
+        }
+    } else {
+        auto name = obj.getDefault("method", "addVertices").asString();
+        auto method = StoragePerfAction::toMethod(name);
+        CHECK(method.hasValue()) << "Unknown method " << name;
+        mix[method.value()] = 1;
+    }
+    auto totalReqs = obj.getDefault("totalReqs", 10000).asInt();
+    auto threads = obj.getDefault("threads", 1).asInt();
+    auto qps = obj.getDefault("qps", 10000).asInt();
+    auto batchNum = obj.getDefault("batch_num", 1).asInt();
+    auto tagName = obj.getDefault("tag_name", "t").asString();
+    auto edgeName = obj.getDefault("edge_name", "e").asString();
+    auto propName = obj.getDefault("prop_name", "name").asString();
+    auto keyRange = obj.getDefault("key_range", 1000000).asInt();
+    auto randomMsg = obj.getDefault("random_message", true).asBool();
+    auto exeTime = obj.getDefault("exe_time_s", 600).asInt();
+    auto stringVid = obj.getDefault("string_vid", true).asBool();
+    auto resultVar = obj.getDefault("result_var", "").asString();
+    return std::make_unique<StoragePerfAction>(ctx.gClient,
+                                               &ctx.planCtx->actionCtx,
+                                               mix,
+                                               totalReqs,
+                                               threads,
+                                               qps,
+                                               batchNum,
+                                               tagName,
+                                               edgeName,
+                                               propName,
+                                               keyRange,
+                                               randomMsg,
+                                               exeTime,
+                                               stringVid,
+                                               resultVar);
+}
+CHAOS_REGISTER_ACTION(StoragePerfAction, loadStoragePerfAction,
+                      {},
+                      {"method", "mix", "totalReqs", "threads", "qps", "batch_num", "tag_name",
+                       "edge_name", "prop_name", "key_range", "random_message", "exe_time_s",
+                       "string_vid", "result_var"});
+
+}   // namespace
+
+// static
+ActionPtr Utils::loadAction(const folly::dynamic& obj, const LoadContext& ctx) {
+    auto& registry = ActionRegistry::instance();
+    registry.loadPlugins();
+    const auto& type = obj.at("type").getString();
+    VLOG(1) << "Load action " << type;
+    auto id = registry.typeId(type);
+    if (id == ActionRegistry::kUnknownType) {
+        LOG(FATAL) << "Unknown type " << type;
+        return nullptr;
+    }
+    CHECK(registry.validate(id, obj)) << "Illegal action " << folly::toJson(obj);
+    return registry.create(id, obj, ctx);
+}
+
+// static
+std::vector<ActionPtr> Utils::loadActions(const folly::dynamic& items, const LoadContext& ctx) {
+    CHECK(items.isArray());
+    std::vector<ActionPtr> actions;
+    actions.reserve(items.size());
+    // The dependees may come after the dependers, so only their indexes are kept here.
+    std::vector<std::pair<size_t, int64_t>> depends;
+    for (const auto& item : items) {
+        CHECK(item.isObject());
+        auto action = loadAction(item, ctx);
+        CHECK(action != nullptr);
+        action->setId(actions.size());
+        for (const auto& dependeeIndex : item.at("depends")) {
+            depends.emplace_back(actions.size(), dependeeIndex.asInt());
+        }
+        actions.emplace_back(std::move(action));
+    }
+    for (const auto& depend : depends) {
+        CHECK_GE(depend.second, 0);
+        CHECK_LT(static_cast<size_t>(depend.second), actions.size());
+        actions[depend.first]->addDependee(actions[depend.second].get());
+    }
+    VLOG(1) << "Load " << actions.size() << " actions with " << depends.size() << " dependencies";
+    return actions;
+}
+
+}  // namespace nebula_chaos
+}  // namespace chaos
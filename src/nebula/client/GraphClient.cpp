@@ -5,15 +5,104 @@
  */
 
 #include "nebula/client/GraphClient.h"
+#include <folly/ScopeGuard.h>
+#include "utils/Metrics.h"
+
+DEFINE_int32(graph_client_sessions, 8, "The number of sessions of a graph client");
+DEFINE_int32(graph_client_max_sessions, 128, "The max number of sessions of a graph client");
+DEFINE_int32(graph_client_checkout_timeout_ms, 60000,
+             "How long a statement waits for a free session of a graph client");
 
 namespace chaos {
 namespace nebula_chaos {
 
 const int32_t kRetryTimes = 10;
 
+// The max number of free slots looked at for one in the space of the client.
+const size_t kMaxSlotsScanned = 8;
+
+namespace {
+
+// The kinds the latency is recorded by, the statements of the other kinds are UNKNOWN.
+enum class StmtKind : uint8_t {
+    INSERT = 0,
+    FETCH,
+    LOOKUP,
+    GO,
+    MATCH,
+    UPDATE,
+    DELETE,
+    USE,
+    CREATE,
+    DROP,
+    SHOW,
+    UNKNOWN,
+};
+
+constexpr size_t kStmtKindsNum = static_cast<size_t>(StmtKind::UNKNOWN) + 1;
+
+const char* kStmtKindNames[kStmtKindsNum] = {
+    "INSERT", "FETCH", "LOOKUP", "GO", "MATCH", "UPDATE", "DELETE",
+    "USE", "CREATE", "DROP", "SHOW", "UNKNOWN",
+};
+
+// The kind by the first keyword of the statement, it doesn't allocate.
+StmtKind stmtKind(folly::StringPiece stmt) {
+    stmt = folly::ltrimWhitespace(stmt);
+    size_t len = 0;
+    while (len < stmt.size() && isalpha(stmt[len])) {
+        len++;
+    }
+    auto keyword = stmt.subpiece(0, len);
+    for (size_t i = 0; i + 1 < kStmtKindsNum; i++) {
+        if (keyword.equals(kStmtKindNames[i], folly::AsciiCaseInsensitive())) {
+            return static_cast<StmtKind>(i);
+        }
+    }
+    return StmtKind::UNKNOWN;
+}
+
+// The latency histogram of the kind, looked up once for all.
+utils::Histogram* latencyOf(StmtKind kind) {
+    static const auto histograms = [] {
+        std::array<utils::Histogram*, kStmtKindsNum> hs;
+        for (size_t i = 0; i < kStmtKindsNum; i++) {
+            hs[i] = utils::Metrics::histogram("chaos_graph_execute_latency_us",
+                                              {{"kind", kStmtKindNames[i]}});
+        }
+        return hs;
+    }();
+    return histograms[static_cast<size_t>(kind)];
+}
+
+// The space dropped by the statement, e.g. "DROP SPACE IF EXISTS test", none if it's not.
+folly::Optional<std::string> droppedSpace(folly::StringPiece stmt) {
+    stmt = folly::trimWhitespace(stmt);
+    std::vector<folly::StringPiece> words;
+    folly::splitTo<folly::StringPiece>(' ', stmt, std::back_inserter(words), true);
+    auto is = [&words] (size_t i, folly::StringPiece word) {
+        return i < words.size() && words[i].equals(word, folly::AsciiCaseInsensitive());
+    };
+    if (!is(0, "DROP") || !is(1, "SPACE")) {
+        return folly::none;
+    }
+    size_t i = is(2, "IF") && is(3, "EXISTS") ? 4 : 2;
+    if (i >= words.size()) {
+        return folly::none;
+    }
+    auto name = words[i];
+    name.removeSuffix(";");
+    name.removePrefix("`");
+    name.removeSuffix("`");
+    return name.str();
+}
+
+}   // namespace
+
 GraphClient::GraphClient(const std::string& addr, uint16_t port)
         : addr_(addr)
-        , port_(port) {
+        , port_(port)
+        , freeSlots_(FLAGS_graph_client_max_sessions) {
     conPool_ = std::make_unique<nebula::ConnectionPool>();
     auto address = folly::stringPrintf("%s:%u", addr.c_str(), port);
     conPool_->init({address}, nebula::Config{});
@@ -25,44 +114,243 @@ GraphClient::~GraphClient() {
 
 ErrorCode GraphClient::connect(const std::string& username,
                                const std::string& password) {
-    std::lock_guard<std::mutex> lk(sessionLk_);
+    if (conPool_ == nullptr) {
+        return nebula::ErrorCode::E_DISCONNECTED;
+    }
     auto session = conPool_->getSession(username, password);
-    if (session.valid()) {
-        session_.reset(new nebula::Session(std::move(session)));
-        return nebula::ErrorCode::SUCCEEDED;
+    if (!session.valid()) {
+        return nebula::ErrorCode::E_RPC_FAILURE;
     }
-    return nebula::ErrorCode::E_RPC_FAILURE;
+    uint64_t connGen;
+    {
+        std::lock_guard<std::mutex> lk(stateLk_);
+        username_ = username;
+        password_ = password;
+        connGen = ++connGen_;
+        // A new connection starts without a space, like a new session does, the
+        // former space may have been dropped meanwhile.
+        spaceName_.clear();
+        spaceGen_++;
+    }
+    ensureSessions(FLAGS_graph_client_sessions);
+    // Hand the new session to a free slot if any, the others reopen theirs lazily.
+    // Never wait for a slot here, all of them may be held by the running statements.
+    SessionSlot* slot = nullptr;
+    if (freeSlots_.read(slot)) {
+        slot->session = std::make_unique<nebula::Session>(std::move(session));
+        slot->connGen = connGen;
+        slot->spaceName.clear();
+        slot->spaceGen = 0;
+        // It's not counted in inUse_, put it back directly.
+        freeSlots_.blockingWrite(slot);
+    }
+    return nebula::ErrorCode::SUCCEEDED;
 }
 
 void GraphClient::disconnect() {
-    std::lock_guard<std::mutex> lk(sessionLk_);
-    if (session_ != nullptr) {
-        session_ = nullptr;
+    // No more checkout, then wait for the checked out slots to be given back.
+    slotsNum_.store(0, std::memory_order_seq_cst);
+    while (inUse_.load(std::memory_order_seq_cst) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
+    std::lock_guard<std::mutex> lk(stateLk_);
+    SessionSlot* slot;
+    while (freeSlots_.read(slot)) {
+    }
+    slots_.clear();
     conPool_ = nullptr;
 }
 
-ErrorCode GraphClient::execute(folly::StringPiece stmt,
-                               nebula::DataSet& resp,
-                               std::string* errMSg) {
-    std::lock_guard<std::mutex> lk(sessionLk_);
-    if (!session_->valid()) {
-        auto ret = session_->retryConnect();
+size_t GraphClient::ensureSessions(size_t num) {
+    std::lock_guard<std::mutex> lk(stateLk_);
+    num = std::min(num, static_cast<size_t>(FLAGS_graph_client_max_sessions));
+    while (slots_.size() < num) {
+        slots_.emplace_back(std::make_unique<SessionSlot>());
+        freeSlots_.blockingWrite(slots_.back().get());
+    }
+    slotsNum_.store(slots_.size(), std::memory_order_release);
+    return slots_.size();
+}
+
+std::string GraphClient::currentSpace() {
+    std::lock_guard<std::mutex> lk(stateLk_);
+    return spaceName_;
+}
+
+ErrorCode GraphClient::checkout(SessionSlot*& slot) {
+    // Count it before the check, so disconnect either sees it or it sees disconnect.
+    inUse_.fetch_add(1, std::memory_order_seq_cst);
+    if (slotsNum_.load(std::memory_order_seq_cst) == 0) {
+        inUse_.fetch_sub(1, std::memory_order_seq_cst);
+        LOG(ERROR) << "The client to " << serverAddress() << " is not connected";
+        return nebula::ErrorCode::E_DISCONNECTED;
+    }
+    auto deadline = std::chrono::steady_clock::now()
+                  + std::chrono::milliseconds(FLAGS_graph_client_checkout_timeout_ms);
+    if (!freeSlots_.tryReadUntil(deadline, slot)) {
+        inUse_.fetch_sub(1, std::memory_order_seq_cst);
+        LOG(ERROR) << "No session of the client to " << serverAddress() << " is freed in "
+                   << FLAGS_graph_client_checkout_timeout_ms << "ms";
+        return nebula::ErrorCode::E_EXECUTION_ERROR;
+    }
+    // Look at a few more free slots for one in the space, so it needn't switch.
+    // The slots read are owned by this thread, the ones skipped are put back.
+    auto spaceGen = spaceGen_.load(std::memory_order_acquire);
+    auto inSpace = [spaceGen] (const SessionSlot* s) {
+        return s->session != nullptr && s->spaceGen == spaceGen;
+    };
+    std::vector<SessionSlot*> skipped;
+    SessionSlot* other = nullptr;
+    while (!inSpace(slot) && skipped.size() < kMaxSlotsScanned && freeSlots_.read(other)) {
+        skipped.emplace_back(slot);
+        slot = other;
+    }
+    for (auto* s : skipped) {
+        freeSlots_.blockingWrite(s);
+    }
+    return nebula::ErrorCode::SUCCEEDED;
+}
+
+void GraphClient::giveBack(SessionSlot* slot) {
+    freeSlots_.blockingWrite(slot);
+    inUse_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+ErrorCode GraphClient::prepare(SessionSlot* slot) {
+    if (slot->session == nullptr
+            || slot->connGen != connGen_.load(std::memory_order_acquire)) {
+        std::string username;
+        std::string password;
+        uint64_t connGen;
+        {
+            std::lock_guard<std::mutex> lk(stateLk_);
+            username = username_;
+            password = password_;
+            connGen = connGen_.load(std::memory_order_acquire);
+        }
+        if (slot->session != nullptr) {
+            utils::Metrics::counter("chaos_graph_reconnects")->add();
+        }
+        auto session = conPool_->getSession(username, password);
+        if (!session.valid()) {
+            return nebula::ErrorCode::E_DISCONNECTED;
+        }
+        slot->session = std::make_unique<nebula::Session>(std::move(session));
+        slot->connGen = connGen;
+        slot->spaceName.clear();
+        slot->spaceGen = 0;
+    }
+    if (!slot->session->valid()) {
+        utils::Metrics::counter("chaos_graph_reconnects")->add();
+        auto ret = slot->session->retryConnect();
         if (ret != nebula::ErrorCode::SUCCEEDED ||
-            !session_->valid()) {
+            !slot->session->valid()) {
             return nebula::ErrorCode::E_DISCONNECTED;
         }
+        slot->spaceName.clear();
+        slot->spaceGen = 0;
+    }
+    if (slot->spaceGen != spaceGen_.load(std::memory_order_acquire)
+            && useSpace(slot) != nebula::ErrorCode::SUCCEEDED) {
+        // e.g. the space has been dropped, the statement may not need it at all.
+        LOG(WARNING) << "Send the statement without switching the space";
+    }
+    return nebula::ErrorCode::SUCCEEDED;
+}
+
+ErrorCode GraphClient::useSpace(SessionSlot* slot) {
+    std::string spaceName;
+    uint64_t spaceGen;
+    uint64_t dropGen;
+    {
+        std::lock_guard<std::mutex> lk(stateLk_);
+        spaceName = spaceName_;
+        spaceGen = spaceGen_.load(std::memory_order_acquire);
+        dropGen = dropGen_.load(std::memory_order_acquire);
+    }
+    if (slot->dropGen != dropGen) {
+        // The space of the session may have been dropped and recreated, USE it again.
+        slot->spaceName.clear();
+        slot->dropGen = dropGen;
+    }
+    if (!spaceName.empty() && spaceName != slot->spaceName) {
+        auto useSpace = folly::stringPrintf("USE %s", spaceName.c_str());
+        auto exeRet = slot->session->execute(useSpace);
+        if (exeRet.errorCode != nebula::ErrorCode::SUCCEEDED) {
+            LOG(ERROR) << "Switch the session to space " << spaceName << " failed!";
+            return exeRet.errorCode;
+        }
+        slot->spaceName = spaceName;
+    }
+    slot->spaceGen = spaceGen;
+    return nebula::ErrorCode::SUCCEEDED;
+}
+
+void GraphClient::onSpaceDropped(const std::string& spaceName) {
+    std::lock_guard<std::mutex> lk(stateLk_);
+    if (spaceName_ == spaceName) {
+        spaceName_.clear();
+    }
+    // Every session is checked against the client once, only the ones in the space use it again.
+    dropGen_++;
+    spaceGen_++;
+}
+
+void GraphClient::onSpaceChanged(SessionSlot* slot, const std::string& spaceName) {
+    std::lock_guard<std::mutex> lk(stateLk_);
+    if (spaceName_ != spaceName) {
+        spaceName_ = spaceName;
+        spaceGen_++;
+    }
+    slot->spaceName = spaceName;
+    slot->spaceGen = spaceGen_.load(std::memory_order_acquire);
+    slot->dropGen = dropGen_.load(std::memory_order_acquire);
+}
+
+ErrorCode GraphClient::execute(folly::StringPiece stmt,
+                               nebula::DataSet& resp,
+                               std::string* errMSg) {
+    auto start = std::chrono::steady_clock::now();
+    auto code = doExecute(stmt, resp, errMSg);
+    auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    auto kind = stmtKind(stmt);
+    latencyOf(kind)->record(costUs);
+    if (code != nebula::ErrorCode::SUCCEEDED) {
+        // Only the failed ones look the counter up, by the kind and the code.
+        utils::Metrics::counter("chaos_graph_execute_errors",
+                                {{"kind", kStmtKindNames[static_cast<size_t>(kind)]},
+                                 {"code", folly::to<std::string>(static_cast<int>(code))}})->add();
+    }
+    return code;
+}
+
+ErrorCode GraphClient::doExecute(folly::StringPiece stmt,
+                                 nebula::DataSet& resp,
+                                 std::string* errMSg) {
+    SessionSlot* slot = nullptr;
+    auto code = checkout(slot);
+    if (code != nebula::ErrorCode::SUCCEEDED) {
+        return code;
+    }
+    SCOPE_EXIT {
+        giveBack(slot);
+    };
+    code = prepare(slot);
+    if (code != nebula::ErrorCode::SUCCEEDED) {
+        return nebula::ErrorCode::E_DISCONNECTED;
     }
 
     // If an exception is thrown in Connection::execute,
     // the error E_RPC_FAILURE will be returned and need to retry
     int32_t retry = 0;
     while (++retry <= kRetryTimes) {
-        auto exeRet = session_->execute(stmt.str());
+        auto exeRet = slot->session->execute(stmt.str());
         auto errCode = exeRet.errorCode;
 
         if (errCode == nebula::ErrorCode::E_RPC_FAILURE) {
             LOG(ERROR) << "Thrift rpc call failed, retry times " << retry;
+            utils::Metrics::counter("chaos_graph_rpc_retries")->add();
             if (retry + 1 <= kRetryTimes) {
                 sleep(retry);
             }
@@ -85,10 +373,18 @@ ErrorCode GraphClient::execute(folly::StringPiece stmt,
                 resp = *(const_cast<nebula::DataSet*>(dataSet));
             }
 
+            if (stmtKind(stmt) == StmtKind::DROP) {
+                auto dropped = droppedSpace(stmt);
+                if (dropped.hasValue()) {
+                    onSpaceDropped(dropped.value());
+                }
+            }
             // Save the current spacename when the execution is successful
             auto* spaceName = exeRet.spaceName.get();
-            if (spaceName != nullptr) {
-                spaceName_ = *spaceName;
+            if (spaceName != nullptr
+                    && !spaceName->empty()
+                    && *spaceName != slot->spaceName) {
+                onSpaceChanged(slot, *spaceName);
             }
             return nebula::ErrorCode::SUCCEEDED;
         }
@@ -96,22 +392,19 @@ ErrorCode GraphClient::execute(folly::StringPiece stmt,
 
     // Reconnect to server, then restore space
     {
-        auto ret = session_->retryConnect();
-        if (ret != nebula::ErrorCode::SUCCEEDED || !session_->valid()) {
+        utils::Metrics::counter("chaos_graph_reconnects")->add();
+        auto ret = slot->session->retryConnect();
+        if (ret != nebula::ErrorCode::SUCCEEDED || !slot->session->valid()) {
             return nebula::ErrorCode::E_DISCONNECTED;
         }
 
         // Restore to the current space
-        if (!spaceName_.empty()) {
-            auto restoreSpace = folly::stringPrintf("USE %s", spaceName_.c_str());
-            auto exeRet = session_->execute(restoreSpace);
-            auto errCode = exeRet.errorCode;
-
-            if (errCode != nebula::ErrorCode::SUCCEEDED) {
-                LOG(ERROR) << "Restore space failed when thrift rpc call failed!";
-            } else {
-                LOG(INFO) << "Restore space successed when thrift rpc call failed!";
-            }
+        slot->spaceName.clear();
+        slot->spaceGen = 0;
+        if (useSpace(slot) != nebula::ErrorCode::SUCCEEDED) {
+            LOG(ERROR) << "Restore space failed when thrift rpc call failed!";
+        } else {
+            LOG(INFO) << "Restore space successed when thrift rpc call failed!";
         }
     }
     return nebula::ErrorCode::E_RPC_FAILURE;
@@ -9,17 +9,29 @@
 
 #include "common/base/Base.h"
 #include "common/graph/Response.h"
+#include <folly/MPMCQueue.h>
 #include <folly/String.h>
 #include "nebula/client/Config.h"
 #include "nebula/client/ConnectionPool.h"
 #include "nebula/client/Session.h"
 
+DECLARE_int32(graph_client_sessions);
+
 namespace chaos {
 namespace nebula_chaos {
 
 using ErrorCode = nebula::ErrorCode;
 using DataSet = nebula::DataSet;
 
+/**
+ * The client keeps a pool of sessions, every statement checks out a free one
+ * from a lock-free queue and returns it when done, so concurrent actions run
+ * their statements in parallel.
+ *
+ * Every session keeps its own space. The statements run in the space switched
+ * to last, a statement prefers a free session already in it, and only the one
+ * it gets is switched to it, if it's not yet.
+ * */
 class GraphClient {
 public:
     GraphClient(const std::string& addr, uint16_t port);
@@ -30,25 +42,82 @@ public:
     ErrorCode connect(const std::string& username,
                       const std::string& password);
 
+    // It waits for the running statements to finish.
     void disconnect();
 
+    // The latency is recorded by the statement kind, see chaos_graph_execute_latency_us.
     ErrorCode execute(folly::StringPiece stmt,
                       nebula::DataSet& resp,
                       std::string* errMSg = nullptr);
 
+    // Grow the pool to at least num sessions, return the number of sessions.
+    size_t ensureSessions(size_t num);
+
+    size_t sessions() const {
+        return slotsNum_.load(std::memory_order_acquire);
+    }
+
+    // The space used by the client, empty if none.
+    std::string currentSpace();
+
     std::string serverAddress() const {
         return folly::stringPrintf("%s:%d", addr_.c_str(), port_);
     }
 
+private:
+    ErrorCode doExecute(folly::StringPiece stmt,
+                        nebula::DataSet& resp,
+                        std::string* errMSg);
+
+    struct SessionSlot {
+        // Opened lazily, reopened if the client has been connected again.
+        std::unique_ptr<nebula::Session>    session{nullptr};
+        uint64_t                            connGen{0};
+        // The space of the session, it's in the space of the client if spaceGen equals.
+        std::string                         spaceName;
+        uint64_t                            spaceGen{0};
+        // The space may have been dropped if dropGen differs.
+        uint64_t                            dropGen{0};
+    };
+
+    // Check out a free slot, preferring the ones in the space of the client.
+    // Fail if the client is not connected, or no slot is freed in time.
+    ErrorCode checkout(SessionSlot*& slot);
+
+    void giveBack(SessionSlot* slot);
+
+    // Open the session if needed, and switch it to the space of the client.
+    ErrorCode prepare(SessionSlot* slot);
+
+    ErrorCode useSpace(SessionSlot* slot);
+
+    // Called when a statement dropped a space, the client leaves it if it's the current one,
+    // and the sessions in it must use it again even if it's recreated with the same name.
+    void onSpaceDropped(const std::string& spaceName);
+
+    // Called when a statement switched the space of its session, the next statements run in it.
+    void onSpaceChanged(SessionSlot* slot, const std::string& spaceName);
+
 private:
     std::unique_ptr<nebula::ConnectionPool> conPool_{nullptr};
     const std::string                       addr_;
     const uint16_t                          port_;
-    std::unique_ptr<nebula::Session>        session_{nullptr};
-    std::mutex                              sessionLk_;
 
-    // Save the current space name to use when reconnecting
+    folly::MPMCQueue<SessionSlot*>          freeSlots_;
+    std::atomic<size_t>                     slotsNum_{0};
+    // The slots checked out, and the ones being checked out.
+    std::atomic<size_t>                     inUse_{0};
+    std::atomic<uint64_t>                   connGen_{0};
+    std::atomic<uint64_t>                   spaceGen_{0};
+    std::atomic<uint64_t>                   dropGen_{0};
+
+    // Protect the members below, only taken when a session is behind the client.
+    std::mutex                              stateLk_;
+    std::vector<std::unique_ptr<SessionSlot>> slots_;
+    // The space the statements run in, the one switched to last.
     std::string                             spaceName_;
+    std::string                             username_;
+    std::string                             password_;
 };
 
 }  // namespace nebula_chaos
@@ -0,0 +1,87 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include "nebula/ActionRegistry.h"
+#include "nebula/NebulaUtils.h"
+
+namespace chaos {
+namespace nebula_chaos {
+
+// Registered as a plugin would do.
+class InHouseAction : public core::Action {
+public:
+    explicit InHouseAction(int64_t level)
+        : level_(level) {}
+
+    ResultCode doRun() override {
+        return ResultCode::OK;
+    }
+
+    std::string toString() override {
+        return folly::stringPrintf("In house fault, level %ld", level_);
+    }
+
+private:
+    int64_t level_;
+};
+
+ActionPtr loadInHouseAction(const folly::dynamic& obj, const LoadContext&) {
+    return std::make_unique<InHouseAction>(obj.at("level").asInt());
+}
+CHAOS_REGISTER_ACTION(InHouseAction, loadInHouseAction, {"level"}, {});
+
+TEST(ActionRegistryTest, RegistryTest) {
+    auto& registry = ActionRegistry::instance();
+    EXPECT_NE(ActionRegistry::kUnknownType, registry.typeId("LoopAction"));
+    EXPECT_NE(ActionRegistry::kUnknownType, registry.typeId("InHouseAction"));
+    EXPECT_EQ(ActionRegistry::kUnknownType, registry.typeId("NoSuchAction"));
+    EXPECT_FALSE(registry.add("InHouseAction", {}, loadInHouseAction));
+
+    auto id = registry.typeId("InHouseAction");
+    EXPECT_TRUE(registry.validate(id, folly::parseJson(R"({"type": "InHouseAction",
+                                                           "level": 3,
+                                                           "depends": []})")));
+    // Unknown keys are allowed.
+    EXPECT_TRUE(registry.validate(id, folly::parseJson(R"({"type": "InHouseAction",
+                                                           "level": 3,
+                                                           "levl": 4})")));
+    EXPECT_FALSE(registry.validate(id, folly::parseJson(R"({"type": "InHouseAction"})")));
+
+    EXPECT_FALSE(registry.loadPlugin("/no/such/plugin.so"));
+}
+
+TEST(ActionRegistryTest, LoadActionsTest) {
+    PlanContext planCtx;
+    LoadContext ctx;
+    ctx.rolling = false;
+    ctx.planCtx = &planCtx;
+    // The second action depends on a later one.
+    auto items = folly::parseJson(R"([
+        {"type": "InHouseAction", "level": 1, "depends": []},
+        {"type": "AssignAction", "var_name": "i", "value_expr": "1 + 1", "depends": [2]},
+        {"type": "EmptyAction", "name": "empty", "depends": [0]}
+    ])");
+    auto actions = Utils::loadActions(items, ctx);
+    ASSERT_EQ(3UL, actions.size());
+    EXPECT_EQ("In house fault, level 1", actions[0]->toString());
+    EXPECT_EQ(ResultCode::OK, actions[1]->doRun());
+    EXPECT_EQ(2, ExprUtils::asInt(planCtx.actionCtx.exprCtx.getVar("i").value()));
+}
+
+}  // namespace nebula_chaos
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
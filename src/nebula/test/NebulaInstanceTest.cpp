@@ -8,7 +8,10 @@
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <folly/init/Init.h>
+#include <folly/FileUtil.h>
+#include <folly/json.h>
 #include "nebula/NebulaInstance.h"
+#include "nebula/InstanceMonitor.h"
 
 namespace chaos {
 namespace nebula_chaos {
@@ -33,6 +36,168 @@ TEST(NebulaInstanceTest, DateTest) {
     }
 }
 
+TEST(NebulaInstanceTest, ConfIndexTest) {
+    folly::dynamic raw = folly::dynamic::object("--port", "9779")
+                                               ("--ws_http_port", "bad")
+                                               ("--pid_file", "/var/run/storaged.pid")
+                                               ("--data_path", "data1,/disk/data2");
+    auto conf = NebulaConf::index(raw, "/nebula");
+    EXPECT_EQ(9779, conf.port.value());
+    EXPECT_FALSE(conf.httpPort.hasValue());
+    EXPECT_EQ("/var/run/storaged.pid", conf.pidFile.value());
+    std::vector<std::string> expected = {"/nebula/data1", "/disk/data2"};
+    EXPECT_EQ(expected, conf.dataPaths.value());
+    EXPECT_EQ(raw, conf.raw);
+
+    auto empty = NebulaConf::index(folly::dynamic::object(), "/nebula");
+    EXPECT_FALSE(empty.port.hasValue());
+    EXPECT_FALSE(empty.pidFile.hasValue());
+    EXPECT_FALSE(empty.dataPaths.hasValue());
+}
+
+TEST(NebulaInstanceTest, WalDirsTest) {
+    auto installPath = folly::stringPrintf("%s/mock/nebula",
+                                           NEBULA_STRINGIFY(NEBULA_CHAOS_HOME));
+    NebulaInstance instance("127.0.0.1",
+                            installPath,
+                            NebulaInstance::Type::STORAGE);
+    CHECK(instance.init());
+    const auto& wals = instance.walDirs(1);
+    ASSERT_TRUE(wals.hasValue());
+    ASSERT_EQ(3UL, wals->size());
+    EXPECT_EQ(folly::stringPrintf("%s/data1/nebula/1/wal", installPath.c_str()), wals->front());
+    // Built once per space
+    EXPECT_EQ(&wals, &instance.walDirs(1));
+    EXPECT_NE(&wals, &instance.walDirs(2));
+    EXPECT_EQ(folly::stringPrintf("%s/data3/nebula/2/wal", installPath.c_str()),
+              instance.walDirs(2)->back());
+}
+
+TEST(NebulaInstanceTest, ConfCacheTest) {
+    char cacheDir[] = "/tmp/chaos_conf_cache.XXXXXX";
+    CHECK_NOTNULL(::mkdtemp(cacheDir));
+    FLAGS_conf_cache_dir = cacheDir;
+    auto installPath = folly::stringPrintf("%s/mock/nebula",
+                                           NEBULA_STRINGIFY(NEBULA_CHAOS_HOME));
+    auto cacheFile = NebulaInstance::confCacheFile(
+            "127.0.0.1", folly::stringPrintf("%s/etc/nebula-storaged.conf", installPath.c_str()));
+    EXPECT_EQ(folly::stringPrintf("%s/127.0.0.1@", cacheDir),
+              cacheFile.substr(0, strlen(cacheDir) + 11));
+    // The paths mapped to the same name by replacing '/' with '_' are kept apart.
+    EXPECT_NE(NebulaInstance::confCacheFile("h", "/a/b_c"),
+              NebulaInstance::confCacheFile("h", "/a_b/c"));
+    {
+        NebulaInstance instance("127.0.0.1", installPath, NebulaInstance::Type::STORAGE);
+        CHECK(instance.init());
+        EXPECT_EQ(9779, instance.getPort().value());
+    }
+    std::string jsonStr;
+    ASSERT_TRUE(folly::readFile(cacheFile.c_str(), jsonStr));
+    auto cached = folly::parseJson(jsonStr);
+    EXPECT_EQ("127.0.0.1", cached["host"].asString());
+    EXPECT_EQ("9779", cached["conf"]["--port"].asString());
+
+    // The cache is reused as long as the remote stat is unchanged, so the changed
+    // port shows it's not parsed from the remote again.
+    cached["conf"]["--port"] = "9780";
+    ASSERT_TRUE(folly::writeFile(folly::toJson(cached), cacheFile.c_str()));
+    {
+        NebulaInstance instance("127.0.0.1", installPath, NebulaInstance::Type::STORAGE);
+        CHECK(instance.init());
+        EXPECT_EQ(9780, instance.getPort().value());
+    }
+
+    // Stale once the stat is changed.
+    cached["stat"] = "0 0";
+    ASSERT_TRUE(folly::writeFile(folly::toJson(cached), cacheFile.c_str()));
+    {
+        NebulaInstance instance("127.0.0.1", installPath, NebulaInstance::Type::STORAGE);
+        CHECK(instance.init());
+        EXPECT_EQ(9779, instance.getPort().value());
+    }
+
+    // A bad stat is never spliced into the remote command.
+    cached["conf"]["--port"] = "9780";
+    cached["stat"] = "0 0\" ]; touch /tmp/injected; [ \"";
+    ASSERT_TRUE(folly::writeFile(folly::toJson(cached), cacheFile.c_str()));
+    {
+        NebulaInstance instance("127.0.0.1", installPath, NebulaInstance::Type::STORAGE);
+        CHECK(instance.init());
+        EXPECT_EQ(9779, instance.getPort().value());
+    }
+    FLAGS_conf_cache_dir = "";
+    ::unlink(cacheFile.c_str());
+    ::rmdir(cacheDir);
+}
+
+TEST(NebulaInstanceTest, CacheTest) {
+    auto installPath = folly::stringPrintf("%s/mock/nebula",
+                                           NEBULA_STRINGIFY(NEBULA_CHAOS_HOME));
+    NebulaInstance instance("127.0.0.1",
+                            installPath,
+                            NebulaInstance::Type::STORAGE);
+    CHECK(instance.init());
+    EXPECT_EQ(folly::stringPrintf("%s/pids/nebula-storaged.pid", installPath.c_str()),
+              instance.pidFile().value());
+    EXPECT_EQ(10086, instance.getPid().value());
+    // Served from the cache now.
+    EXPECT_EQ(10086, instance.getPid().value());
+
+    auto gen = instance.generation();
+    instance.setState(NebulaInstance::State::RUNNING);
+    EXPECT_EQ(gen + 1, instance.generation());
+    gen = instance.generation();
+    instance.invalidate();
+    EXPECT_EQ(gen + 1, instance.generation());
+
+    // The probe sent before the change is dropped.
+    instance.onProbed(gen, false, -1);
+    EXPECT_EQ(NebulaInstance::State::RUNNING, instance.getState());
+
+    gen = instance.generation();
+    instance.onProbed(gen, true, 10086);
+    EXPECT_EQ(NebulaInstance::State::RUNNING, instance.getState());
+    EXPECT_EQ(gen, instance.generation());
+    EXPECT_EQ(10086, instance.getPid().value());
+
+    // Exited unexpectedly
+    instance.onProbed(gen, false, -1);
+    EXPECT_EQ(NebulaInstance::State::STOPPED, instance.getState());
+    EXPECT_EQ(gen + 1, instance.generation());
+
+    // Started outside the plan
+    gen = instance.generation();
+    instance.onProbed(gen, true, 10087);
+    EXPECT_EQ(NebulaInstance::State::RUNNING, instance.getState());
+    EXPECT_EQ(10087, instance.getPid().value());
+
+    // Being stopped by us, the probes sent before or during the change are dropped.
+    gen = instance.generation();
+    instance.beginChange();
+    auto genInChange = instance.generation();
+    instance.onProbed(genInChange, false, -1);
+    EXPECT_EQ(NebulaInstance::State::RUNNING, instance.getState());
+    instance.endChange();
+    instance.onProbed(gen, false, -1);
+    instance.onProbed(genInChange, false, -1);
+    EXPECT_EQ(NebulaInstance::State::RUNNING, instance.getState());
+}
+
+TEST(NebulaInstanceTest, ProbeTest) {
+    auto command = InstanceMonitor::probeCommand({"/a.pid", "/b.pid"});
+    EXPECT_EQ("p=$(cat /a.pid 2>/dev/null) && kill -0 $p 2>/dev/null && echo \"0 $p\"; "
+              "p=$(cat /b.pid 2>/dev/null) && kill -0 $p 2>/dev/null && echo \"1 $p\"; "
+              "true",
+              command);
+
+    auto alive = InstanceMonitor::parseProbe("0 10086\n2 10088\n\nbad\n");
+    EXPECT_EQ(2UL, alive.size());
+    EXPECT_EQ(10086, alive[0]);
+    EXPECT_EQ(10088, alive[2]);
+    EXPECT_EQ(0UL, alive.count(1));
+    EXPECT_TRUE(InstanceMonitor::parseProbe("").empty());
+}
+
 }  // namespace nebula_chaos
 }  // namespace chaos
 
@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include "nebula/NebulaUtils.h"
+
+namespace chaos {
+namespace nebula_chaos {
+
+// A generated plan of n actions, each depends on the last two ones.
+std::string genPlan(size_t n) {
+    folly::dynamic actions = folly::dynamic::array;
+    for (size_t i = 0; i < n; i++) {
+        folly::dynamic action = folly::dynamic::object;
+        switch (i % 3) {
+            case 0:
+                action["type"] = "EmptyAction";
+                action["name"] = folly::to<std::string>("action_", i);
+                break;
+            case 1:
+                action["type"] = "AssignAction";
+                action["var_name"] = "i";
+                action["value_expr"] = "$i + 1";
+                break;
+            default:
+                action["type"] = "WaitAction";
+                action["wait_time_ms"] = 10;
+                break;
+        }
+        folly::dynamic depends = folly::dynamic::array;
+        for (size_t d = std::max<size_t>(i, 2) - 2; d < i; d++) {
+            depends.push_back(d);
+        }
+        action["depends"] = std::move(depends);
+        actions.push_back(std::move(action));
+    }
+    folly::dynamic plan = folly::dynamic::object("name", "bm")("concurrency", 10)
+                                                ("actions", std::move(actions));
+    return folly::toJson(plan);
+}
+
+void loadPlan(size_t iters, size_t n) {
+    std::string json;
+    BENCHMARK_SUSPEND {
+        json = genPlan(n);
+    }
+    for (size_t i = 0; i < iters; i++) {
+        std::unique_ptr<PlanContext> planCtx;
+        BENCHMARK_SUSPEND {
+            planCtx = std::make_unique<PlanContext>();
+        }
+        LoadContext ctx;
+        ctx.rolling = false;
+        ctx.planCtx = planCtx.get();
+        auto jsonObj = folly::parseJson(json);
+        auto actions = Utils::loadActions(jsonObj.at("actions"), ctx);
+        folly::doNotOptimizeAway(actions.size());
+        BENCHMARK_SUSPEND {
+            actions.clear();
+            planCtx.reset();
+        }
+    }
+}
+
+BENCHMARK_PARAM(loadPlan, 1000)
+BENCHMARK_PARAM(loadPlan, 10000)
+BENCHMARK_PARAM(loadPlan, 100000)
+
+}  // namespace nebula_chaos
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    folly::runBenchmarks();
+    return 0;
+}
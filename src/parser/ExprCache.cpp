@@ -0,0 +1,64 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "parser/ExprCache.h"
+#include <folly/SharedMutex.h>
+#include "parser/ParserHelper.h"
+
+namespace chaos {
+
+namespace {
+
+folly::SharedMutex gCacheLock;
+std::unordered_map<std::string, std::shared_ptr<const Expression>> gCache;
+std::atomic<int64_t> gHits{0};
+std::atomic<int64_t> gMisses{0};
+
+}   // namespace
+
+std::string ExprCache::Stats::toString() const {
+    return folly::stringPrintf("%ld hits, %ld misses, %ld expressions cached",
+                               hits, misses, size);
+}
+
+// static
+std::shared_ptr<const Expression> ExprCache::get(const std::string& query) {
+    {
+        folly::SharedMutex::ReadHolder rh(gCacheLock);
+        auto it = gCache.find(query);
+        if (it != gCache.end()) {
+            gHits++;
+            return it->second;
+        }
+    }
+    gMisses++;
+    // Parse out of the lock, a concurrent miss on the same query parses it again,
+    // and the first one inserted wins.
+    std::shared_ptr<const Expression> expr = ParserHelper::parse(query);
+    if (expr == nullptr) {
+        return nullptr;
+    }
+    folly::SharedMutex::WriteHolder wh(gCacheLock);
+    return gCache.emplace(query, std::move(expr)).first->second;
+}
+
+// static
+ExprCache::Stats ExprCache::stats() {
+    Stats stats;
+    stats.hits = gHits.load();
+    stats.misses = gMisses.load();
+    folly::SharedMutex::ReadHolder rh(gCacheLock);
+    stats.size = gCache.size();
+    return stats;
+}
+
+// static
+void ExprCache::clear() {
+    folly::SharedMutex::WriteHolder wh(gCacheLock);
+    gCache.clear();
+}
+
+}   // namespace chaos
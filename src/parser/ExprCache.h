@@ -0,0 +1,44 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef PARSER_EXPRCACHE_H_
+#define PARSER_EXPRCACHE_H_
+
+#include "common/base/Base.h"
+#include "expression/Expressions.h"
+
+namespace chaos {
+
+/**
+ * The parsed expressions interned by their source text.
+ *
+ * A tree is never changed once parsed, so one copy is shared by all actions and
+ * threads, and the same condition is parsed only once per process.
+ * */
+class ExprCache final {
+public:
+    struct Stats {
+        int64_t hits{0};
+        int64_t misses{0};
+        // Number of expressions cached.
+        int64_t size{0};
+
+        std::string toString() const;
+    };
+
+    // Return nullptr if the query is illegal, the failures are not cached.
+    static std::shared_ptr<const Expression> get(const std::string& query);
+
+    static Stats stats();
+
+    static void clear();
+
+private:
+    ExprCache() = default;
+};
+
+}   // namespace chaos
+#endif  // PARSER_EXPRCACHE_H_
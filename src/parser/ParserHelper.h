@@ -10,6 +10,8 @@
 #include <glog/logging.h>
 #include "ExprParser.hpp"
 #include "ExprScanner.h"
+#include "expression/ExprCompiler.h"
+#include "parser/ExprCache.h"
 
 namespace chaos {
 
@@ -23,12 +25,23 @@ public:
         ExprParser parser(scanner, errMsg, &expr);
         auto ret = parser.parse();
         if (ret == 0) {
-            LOG(INFO) << "Parse " << query << " succeeded!";
+            VLOG(1) << "Parse " << query << " succeeded!";
             return std::unique_ptr<Expression>(expr);
         }
         return nullptr;
     }
 
+    // Parse the query and compile it for ctx, return nullptr if it is illegal.
+    // The parsed tree is shared through ExprCache.
+    static std::unique_ptr<CompiledExpr> compile(const std::string& query, ExprContext* ctx) {
+        auto expr = ExprCache::get(query);
+        if (expr == nullptr) {
+            LOG(ERROR) << "Parse " << query << " failed!";
+            return nullptr;
+        }
+        return ExprCompiler::compile(expr.get(), ctx);
+    }
+
 private:
     ParserHelper() = default;
 };
@@ -34,6 +34,76 @@ TEST(ParserTest, ExpressionTest) {
     }
 }
 
+TEST(ParserTest, CompileTest) {
+    ExprContext ctx;
+    ctx.setVar("a", 1L);
+    ctx.setVar("b", 2.5);
+    ctx.setVar("s", std::string("chaos"));
+
+    std::vector<std::string> queries = {
+        "1 + 2 * 3",
+        "-$a + 3",
+        "$a * 10 % 3 - $b",
+        "$a < 10 && $b >= 2.5",
+        "$a == 1 || !($b != 2.5)",
+        "($a > 3) ^ ($b < 3)",
+        "$s + \"_test\"",
+        "$s == \"chaos\"",
+    };
+    for (const auto& query : queries) {
+        auto expr = ParserHelper::parse(query);
+        ASSERT_TRUE(expr != nullptr) << query;
+        auto compiled = ParserHelper::compile(query, &ctx);
+        ASSERT_TRUE(compiled != nullptr) << query;
+        auto expected = expr->eval(&ctx);
+        auto valOrErr = compiled->eval(&ctx);
+        ASSERT_TRUE(expected);
+        ASSERT_TRUE(valOrErr) << query;
+        EXPECT_EQ(expected.value(), valOrErr.value()) << query;
+    }
+    {
+        // The slots are bound once, the new values are seen by the compiled expression.
+        auto compiled = ParserHelper::compile("$i < 3", &ctx);
+        ASSERT_TRUE(compiled != nullptr);
+        EXPECT_FALSE(compiled->eval(&ctx));
+        auto slot = ctx.slot("i");
+        int64_t loops = 0;
+        for (ctx.setVar(slot, 0L);
+             ExprUtils::asBool(compiled->eval(&ctx).value());
+             ctx.setVar("i", ExprUtils::asInt(ctx.getVar(slot).value()) + 1)) {
+            loops++;
+        }
+        EXPECT_EQ(3, loops);
+    }
+    {
+        EXPECT_TRUE(ParserHelper::compile("1 +", &ctx) == nullptr);
+    }
+}
+
+TEST(ParserTest, ExprCacheTest) {
+    ExprCache::clear();
+    auto before = ExprCache::stats();
+    auto expr1 = ExprCache::get("$loop < 100");
+    ASSERT_TRUE(expr1 != nullptr);
+    auto expr2 = ExprCache::get("$loop < 100");
+    EXPECT_EQ(expr1.get(), expr2.get());
+    EXPECT_TRUE(ExprCache::get("$loop <") == nullptr);
+
+    auto after = ExprCache::stats();
+    EXPECT_EQ(1, after.hits - before.hits);
+    EXPECT_EQ(2, after.misses - before.misses);
+    EXPECT_EQ(1, after.size);
+
+    // Actions compiling the same condition share one tree.
+    ExprContext ctx;
+    ctx.setVar("loop", 1L);
+    auto compiled1 = ParserHelper::compile("$loop < 100", &ctx);
+    auto compiled2 = ParserHelper::compile("$loop < 100", &ctx);
+    ASSERT_TRUE(compiled1 != nullptr && compiled2 != nullptr);
+    EXPECT_TRUE(ExprUtils::asBool(compiled1->eval(&ctx).value()));
+    EXPECT_EQ(3, ExprCache::stats().hits - before.hits);
+}
+
 }  // namespace chaos
 
 int main(int argc, char** argv) {
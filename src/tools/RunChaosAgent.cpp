@@ -0,0 +1,53 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+#include <folly/init/Init.h>
+#include <signal.h>
+#include "utils/AgentClient.h"
+#include "utils/ChaosAgent.h"
+
+DEFINE_string(agent_address, "127.0.0.1", "The address the chaos agent listens on, "
+                                          "set it to the address of the host to serve the plan "
+                                          "on another host");
+
+namespace chaos {
+namespace utils {
+
+int run() {
+    // Block the signals before any thread is started, so they are only taken by sigwait.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto token = readAgentToken();
+    if (!token.hasValue()) {
+        LOG(ERROR) << "The token is required, see --chaos_agent_token_file";
+        return -1;
+    }
+    ChaosAgent agent(FLAGS_agent_address, FLAGS_chaos_agent_port, token.value());
+    if (!agent.start()) {
+        return -1;
+    }
+    int sig = 0;
+    sigwait(&signals, &sig);
+    LOG(INFO) << "Got signal " << sig << ", stop the chaos agent";
+    agent.stop();
+    return 0;
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return chaos::utils::run();
+}
@@ -10,6 +10,10 @@
 #include <folly/init/Init.h>
 #include "nebula/NebulaChaosPlan.h"
 #include "nebula/NebulaUtils.h"
+#include "utils/Metrics.h"
+#include "utils/SshHelper.h"
+#include "utils/StatusServer.h"
+#include "parser/ExprCache.h"
 
 DEFINE_string(instance_conf_file, "", "The json path of the instance conf file");
 DEFINE_string(action_conf_file, "", "The json path of the action conf file");
@@ -38,10 +42,35 @@ int run() {
             return 0;
         }
         plan->setAttachment(flowChart);
+        std::unique_ptr<utils::StatusServer> statusServer;
+        if (FLAGS_status_port != 0) {
+            statusServer = std::make_unique<utils::StatusServer>(FLAGS_status_address,
+                                                                 FLAGS_status_port);
+            auto* p = plan.get();
+            statusServer->addHandler("/status", "application/json", [p] {
+                return p->statusJson();
+            });
+            statusServer->addHandler("/metrics", "text/plain; version=0.0.4", [] {
+                return utils::Metrics::toPrometheus();
+            });
+            statusServer->addHandler("/metrics.json", "application/json", [] {
+                return utils::Metrics::toJson();
+            });
+            if (!statusServer->start()) {
+                LOG(ERROR) << "Start the status server failed, run the plan without it";
+            }
+        }
         LOG(INFO) << "\n============= run the plan =================\n";
         plan->schedule();
+        if (statusServer != nullptr) {
+            statusServer->stop();
+        }
         LOG(INFO) << "\n" << plan->toString();
         plan->getGraphClient()->disconnect();
+        LOG(INFO) << "Ssh: " << utils::SshHelper::stats().toString();
+        LOG(INFO) << "Expression cache: " << ExprCache::stats().toString();
+        utils::SshHelper::closeAll();
+        utils::Metrics::dump();
         return 0;
     } catch (const std::out_of_range& e) {
         LOG(ERROR) << "Load plan failed, err " << e.what();
@@ -0,0 +1,152 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/AgentClient.h"
+#include "utils/Metrics.h"
+#include <folly/ScopeGuard.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+DEFINE_bool(use_chaos_agent, false, "Apply the disturbances by the chaos agent on the hosts, "
+                                    "fall back to ssh if it's not reachable");
+DEFINE_int32(chaos_agent_port, 11200, "The port of the chaos agent");
+DEFINE_int32(chaos_agent_timeout_ms, 30000,
+             "The timeout to connect the chaos agent, and to wait a rule applied by it");
+
+namespace chaos {
+namespace utils {
+
+bool AgentClient::connect() {
+    if (token_.empty()) {
+        LOG(ERROR) << "No token of the chaos agent, see --chaos_agent_token_file";
+        return false;
+    }
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addrs = nullptr;
+    auto port = folly::to<std::string>(port_);
+    auto ret = ::getaddrinfo(host_.c_str(), port.c_str(), &hints, &addrs);
+    if (ret != 0) {
+        LOG(ERROR) << "Resolve " << host_ << " failed, " << gai_strerror(ret);
+        return false;
+    }
+    SCOPE_EXIT {
+        ::freeaddrinfo(addrs);
+    };
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG(ERROR) << "Create the socket failed, errno " << errno;
+        return false;
+    }
+    // The connect is bounded by the send timeout.
+    timeval timeout{FLAGS_chaos_agent_timeout_ms / 1000,
+                    FLAGS_chaos_agent_timeout_ms % 1000 * 1000};
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if (::connect(fd, addrs->ai_addr, addrs->ai_addrlen) != 0) {
+        LOG(WARNING) << "Connect the chaos agent on " << host_ << ":" << port_
+                     << " failed, errno " << errno;
+        ::close(fd);
+        return false;
+    }
+    // Authenticate before any request, the agent closes the connection on a bad token.
+    std::string body;
+    std::string empty;
+    if (!writeFrame(fd, encodeHello(token_))
+            || !readFrame(fd, body, FLAGS_chaos_agent_timeout_ms)
+            || !decodeHello(body, empty)) {
+        LOG(WARNING) << "The chaos agent on " << host_ << ":" << port_
+                     << " refused the token";
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    return true;
+}
+
+void AgentClient::disconnect() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+AgentClient::Status AgentClient::apply(const AgentRequest& req,
+                                       AgentResponse& resp,
+                                       ResultCallback onResult) {
+    std::lock_guard<std::mutex> lk(lock_);
+    auto start = std::chrono::steady_clock::now();
+    if (fd_ < 0 && !connect()) {
+        return Status::kUnreachable;
+    }
+    if (!writeFrame(fd_, encodeRequest(req))) {
+        // The agent may have been restarted, reconnect once since a request never written
+        // wholly is never decoded by the agent.
+        disconnect();
+        if (!connect() || !writeFrame(fd_, encodeRequest(req))) {
+            LOG(ERROR) << "Send the request to the chaos agent on " << host_ << " failed";
+            disconnect();
+            return Status::kUnreachable;
+        }
+    }
+    // From now on the rules may have been applied whatever happens.
+    resp = AgentResponse();
+    std::string body;
+    while (true) {
+        if (!readFrame(fd_, body, FLAGS_chaos_agent_timeout_ms)) {
+            LOG(ERROR) << "Read the response from the chaos agent on " << host_ << " failed";
+            disconnect();
+            return Status::kUnknown;
+        }
+        auto type = frameType(body);
+        if (type == FrameType::kResult) {
+            AgentResult result;
+            if (decodeResult(body, result)) {
+                if (onResult) {
+                    onResult(result);
+                }
+                resp.results.emplace_back(std::move(result));
+                continue;
+            }
+        } else if (type == FrameType::kDone) {
+            if (decodeDone(body, resp.done)) {
+                break;
+            }
+        }
+        LOG(ERROR) << "Bad response from the chaos agent on " << host_;
+        disconnect();
+        return Status::kUnknown;
+    }
+    auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    Metrics::histogram("chaos_agent_apply_latency_us", {{"host", host_}})->record(costUs);
+    VLOG(1) << "Applied " << req.rules.size() << " rules on " << host_
+            << ", cost " << costUs << "us, " << resp.done.costUs << "us on the agent";
+    return Status::kApplied;
+}
+
+// static
+std::shared_ptr<AgentClient> AgentClient::of(const std::string& host) {
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::shared_ptr<AgentClient>> clients;
+    static const auto token = readAgentToken();
+    std::lock_guard<std::mutex> lk(lock);
+    auto& client = clients[host];
+    if (client == nullptr) {
+        client = std::make_shared<AgentClient>(host,
+                                               FLAGS_chaos_agent_port,
+                                               token.hasValue() ? token.value() : "");
+    }
+    return client;
+}
+
+}   // namespace utils
+}   // namespace chaos
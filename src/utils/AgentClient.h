@@ -0,0 +1,74 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_AGENTCLIENT_H_
+#define UTILS_AGENTCLIENT_H_
+
+#include "common/base/Base.h"
+#include "utils/AgentProtocol.h"
+
+DECLARE_bool(use_chaos_agent);
+DECLARE_int32(chaos_agent_port);
+DECLARE_int32(chaos_agent_timeout_ms);
+
+namespace chaos {
+namespace utils {
+
+/**
+ * The client of the chaos agent on a host, the connection is kept and reused
+ * by the later requests. It's thread safe, the requests are sent one by one.
+ * */
+class AgentClient final {
+public:
+    using ResultCallback = std::function<void(const AgentResult&)>;
+
+    // Every connection is authenticated by the token first.
+    AgentClient(const std::string& host, uint16_t port, const std::string& token)
+        : host_(host)
+        , port_(port)
+        , token_(token) {}
+
+    ~AgentClient() {
+        disconnect();
+    }
+
+    enum class Status {
+        // resp is the response of the agent.
+        kApplied,
+        // Nothing has been sent, so nothing is applied.
+        kUnreachable,
+        // The request has been sent, but no response, it may have been applied or not.
+        kUnknown,
+    };
+
+    /**
+     * Apply the request on the host, onResult is called once a rule is applied.
+     * */
+    Status apply(const AgentRequest& req,
+                 AgentResponse& resp,
+                 ResultCallback onResult = nullptr);
+
+    // The shared client of the agent on the host, listening on --chaos_agent_port,
+    // with the token in --chaos_agent_token_file.
+    static std::shared_ptr<AgentClient> of(const std::string& host);
+
+private:
+    bool connect();
+
+    void disconnect();
+
+private:
+    std::string host_;
+    uint16_t    port_;
+    std::string token_;
+    std::mutex  lock_;
+    int         fd_{-1};
+};
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_AGENTCLIENT_H_
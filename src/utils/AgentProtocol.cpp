@@ -0,0 +1,469 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/AgentProtocol.h"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <endian.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+
+DEFINE_string(chaos_agent_token_file, "",
+              "The file of the token shared by the plan and the chaos agents, "
+              "the agent refuses the clients without it");
+
+namespace chaos {
+namespace utils {
+
+namespace {
+
+class Writer {
+public:
+    explicit Writer(FrameType type) {
+        buf_.push_back(static_cast<char>(type));
+    }
+
+    Writer& b(bool v) {
+        return u8(v ? 1 : 0);
+    }
+
+    Writer& u8(uint8_t v) {
+        buf_.push_back(static_cast<char>(v));
+        return *this;
+    }
+
+    Writer& u32(uint32_t v) {
+        v = htonl(v);
+        buf_.append(reinterpret_cast<const char*>(&v), sizeof(v));
+        return *this;
+    }
+
+    Writer& i64(int64_t v) {
+        auto u = htobe64(static_cast<uint64_t>(v));
+        buf_.append(reinterpret_cast<const char*>(&u), sizeof(u));
+        return *this;
+    }
+
+    Writer& str(const std::string& s) {
+        u32(s.size());
+        buf_.append(s);
+        return *this;
+    }
+
+    std::string done() {
+        return std::move(buf_);
+    }
+
+private:
+    std::string buf_;
+};
+
+// Every read fails once the body is exhausted, so it's enough to check the last one.
+class Reader {
+public:
+    Reader(folly::StringPiece body, FrameType type) : body_(body), ok_(true) {
+        uint8_t t = 0;
+        ok_ = u8(t) && t == static_cast<uint8_t>(type);
+    }
+
+    bool u8(uint8_t& v) {
+        if (!ok_ || body_.size() < 1) {
+            return ok_ = false;
+        }
+        v = static_cast<uint8_t>(body_[0]);
+        body_.advance(1);
+        return true;
+    }
+
+    bool u32(uint32_t& v) {
+        if (!ok_ || body_.size() < sizeof(v)) {
+            return ok_ = false;
+        }
+        memcpy(&v, body_.data(), sizeof(v));
+        v = ntohl(v);
+        body_.advance(sizeof(v));
+        return true;
+    }
+
+    bool i32(int32_t& v) {
+        uint32_t u = 0;
+        if (!u32(u)) {
+            return false;
+        }
+        v = static_cast<int32_t>(u);
+        return true;
+    }
+
+    bool i64(int64_t& v) {
+        uint64_t u = 0;
+        if (!ok_ || body_.size() < sizeof(u)) {
+            return ok_ = false;
+        }
+        memcpy(&u, body_.data(), sizeof(u));
+        v = static_cast<int64_t>(be64toh(u));
+        body_.advance(sizeof(u));
+        return true;
+    }
+
+    bool str(std::string& s) {
+        uint32_t len = 0;
+        if (!u32(len) || body_.size() < len) {
+            return ok_ = false;
+        }
+        s.assign(body_.data(), len);
+        body_.advance(len);
+        return true;
+    }
+
+    // All fields are read, and nothing left.
+    bool finished() const {
+        return ok_ && body_.empty();
+    }
+
+private:
+    folly::StringPiece  body_;
+    bool                ok_;
+};
+
+// Wait the fd to be ready for the events, return false on timeout or error.
+bool waitFor(int fd, int16_t events, int32_t timeoutMs) {
+    pollfd pfd{fd, events, 0};
+    int ret;
+    do {
+        ret = ::poll(&pfd, 1, timeoutMs);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0 && !(pfd.revents & (POLLERR | POLLNVAL));
+}
+
+bool readFully(int fd, char* buf, size_t len, int32_t timeoutMs) {
+    size_t read = 0;
+    while (read < len) {
+        if (!waitFor(fd, POLLIN, timeoutMs)) {
+            return false;
+        }
+        auto n = ::recv(fd, buf + read, len - read, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        read += n;
+    }
+    return true;
+}
+
+// [0-9A-Za-z] first, then [0-9A-Za-z] or the extra chars, at most maxLen.
+bool isName(folly::StringPiece name, folly::StringPiece extra, size_t maxLen) {
+    if (name.empty() || name.size() > maxLen || !isalnum(name.front())) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [extra] (char c) {
+        return isalnum(c) || extra.find(c) != folly::StringPiece::npos;
+    });
+}
+
+// e.g. "100", "100ms", "1.5s"
+bool isTime(folly::StringPiece time) {
+    size_t i = 0;
+    auto digits = [&time, &i] {
+        auto begin = i;
+        while (i < time.size() && isdigit(time[i])) {
+            i++;
+        }
+        return i > begin;
+    };
+    if (!digits()) {
+        return false;
+    }
+    if (i < time.size() && time[i] == '.') {
+        i++;
+        if (!digits()) {
+            return false;
+        }
+    }
+    auto unit = time.subpiece(i);
+    return unit.size() <= 4 && std::all_of(unit.begin(), unit.end(), islower);
+}
+
+bool isIptables(RuleOp op) {
+    return op == RuleOp::kIptablesInsert || op == RuleOp::kIptablesDelete;
+}
+
+}   // namespace
+
+bool validateRule(const Rule& rule, std::string& reason) {
+    if (rule.op < RuleOp::kIptablesInsert || rule.op > RuleOp::kTcDel) {
+        reason = folly::stringPrintf("unknown op %d", static_cast<int32_t>(rule.op));
+        return false;
+    }
+    if (!isName(rule.peer, ".-", 253)) {
+        reason = "bad peer \"" + rule.peer + "\"";
+        return false;
+    }
+    if (isIptables(rule.op)) {
+        if ((rule.portMin == 0 && rule.portMax != 0)
+                || (rule.portMax != 0 && rule.portMax < rule.portMin)) {
+            reason = folly::stringPrintf("bad port range %d:%d", rule.portMin, rule.portMax);
+            return false;
+        }
+        return true;
+    }
+    if (rule.portMin == 0) {
+        reason = "no port";
+        return false;
+    }
+    if (!isName(rule.device, "_.-", 15)) {
+        reason = "bad device \"" + rule.device + "\"";
+        return false;
+    }
+    if (rule.op == RuleOp::kTcAdd) {
+        if (!isTime(rule.delay) || (!rule.distro.empty() && !isTime(rule.distro))) {
+            reason = "bad delay \"" + rule.delay + "\" or distro \"" + rule.distro + "\"";
+            return false;
+        }
+        if (rule.loss < 0 || rule.loss > 100 || rule.duplicate < 0 || rule.duplicate > 100) {
+            reason = folly::stringPrintf("bad loss %d or duplicate %d",
+                                         rule.loss, rule.duplicate);
+            return false;
+        }
+    }
+    return true;
+}
+
+folly::Optional<Rule> rollbackOf(const Rule& rule) {
+    auto rollback = rule;
+    switch (rule.op) {
+        case RuleOp::kIptablesInsert:
+            rollback.op = RuleOp::kIptablesDelete;
+            return rollback;
+        case RuleOp::kTcAdd:
+            rollback.op = RuleOp::kTcDel;
+            return rollback;
+        default:
+            break;
+    }
+    return folly::none;
+}
+
+std::vector<std::string> ruleArgs(const Rule& rule) {
+    std::vector<std::string> args;
+    if (isIptables(rule.op)) {
+        args = {rule.op == RuleOp::kIptablesInsert ? "-I" : "-D",
+                rule.incoming ? "INPUT" : "OUTPUT",
+                "-p", "tcp", "-m", "tcp",
+                rule.incoming ? "-s" : "-d", rule.peer};
+        if (rule.portMin != 0) {
+            args.emplace_back("--dport");
+            args.emplace_back(rule.portMax > rule.portMin
+                    ? folly::stringPrintf("%d:%d", rule.portMin, rule.portMax)
+                    : folly::to<std::string>(rule.portMin));
+        }
+        args.insert(args.end(), {"-j", "DROP"});
+        return args;
+    }
+    args = {rule.device,
+            "--direction", rule.incoming ? "incoming" : "outgoing",
+            rule.incoming ? "--src-network" : "--dst-network", rule.peer,
+            "--dst-port", folly::to<std::string>(rule.portMin)};
+    if (rule.op == RuleOp::kTcAdd) {
+        args.insert(args.end(), {"--delay", rule.delay});
+        if (!rule.distro.empty()) {
+            args.insert(args.end(), {"--delay-distro", rule.distro});
+        }
+        args.insert(args.end(), {"--loss", folly::to<std::string>(rule.loss),
+                                 "--duplicate", folly::to<std::string>(rule.duplicate),
+                                 "--add"});
+    }
+    return args;
+}
+
+std::string toString(const Rule& rule) {
+    const char* binary = isIptables(rule.op) ? "iptables"
+                                             : (rule.op == RuleOp::kTcAdd ? "tcset" : "tcdel");
+    return folly::stringPrintf("%s %s", binary, folly::join(" ", ruleArgs(rule)).c_str());
+}
+
+std::string encodeHello(const std::string& token) {
+    return Writer(FrameType::kHello).str(token).done();
+}
+
+std::string encodeRequest(const AgentRequest& req) {
+    Writer w(FrameType::kRequest);
+    w.b(req.atomic).u32(req.rules.size());
+    for (const auto& rule : req.rules) {
+        w.u8(static_cast<uint8_t>(rule.op))
+         .b(rule.incoming)
+         .str(rule.peer)
+         .u32(rule.portMin)
+         .u32(rule.portMax)
+         .str(rule.device)
+         .str(rule.delay)
+         .str(rule.distro)
+         .u32(static_cast<uint32_t>(rule.loss))
+         .u32(static_cast<uint32_t>(rule.duplicate));
+    }
+    return w.done();
+}
+
+std::string encodeResult(const AgentResult& result) {
+    return Writer(FrameType::kResult).u32(result.index)
+                                     .u32(static_cast<uint32_t>(result.exitStatus))
+                                     .i64(result.costUs)
+                                     .str(result.out)
+                                     .str(result.err)
+                                     .done();
+}
+
+std::string encodeDone(const AgentDone& done) {
+    return Writer(FrameType::kDone).b(done.ok)
+                                   .b(done.rolledBack)
+                                   .i64(done.costUs)
+                                   .done();
+}
+
+folly::Optional<FrameType> frameType(folly::StringPiece body) {
+    if (body.empty()) {
+        return folly::none;
+    }
+    auto type = static_cast<uint8_t>(body[0]);
+    if (type < static_cast<uint8_t>(FrameType::kRequest)
+            || type > static_cast<uint8_t>(FrameType::kHello)) {
+        return folly::none;
+    }
+    return static_cast<FrameType>(type);
+}
+
+bool decodeHello(folly::StringPiece body, std::string& token) {
+    Reader r(body, FrameType::kHello);
+    r.str(token);
+    return r.finished();
+}
+
+bool decodeRequest(folly::StringPiece body, AgentRequest& req) {
+    Reader r(body, FrameType::kRequest);
+    uint8_t atomic = 0;
+    uint32_t num = 0;
+    if (!r.u8(atomic) || !r.u32(num)) {
+        return false;
+    }
+    req.atomic = atomic != 0;
+    req.rules.clear();
+    for (uint32_t i = 0; i < num; i++) {
+        Rule rule;
+        uint8_t op = 0;
+        uint8_t incoming = 0;
+        uint32_t portMin = 0;
+        uint32_t portMax = 0;
+        r.u8(op);
+        r.u8(incoming);
+        r.str(rule.peer);
+        r.u32(portMin);
+        r.u32(portMax);
+        r.str(rule.device);
+        r.str(rule.delay);
+        r.str(rule.distro);
+        r.i32(rule.loss);
+        if (!r.i32(rule.duplicate) || portMin > UINT16_MAX || portMax > UINT16_MAX) {
+            return false;
+        }
+        rule.op = static_cast<RuleOp>(op);
+        rule.incoming = incoming != 0;
+        rule.portMin = portMin;
+        rule.portMax = portMax;
+        req.rules.emplace_back(std::move(rule));
+    }
+    return r.finished();
+}
+
+bool decodeResult(folly::StringPiece body, AgentResult& result) {
+    Reader r(body, FrameType::kResult);
+    r.u32(result.index);
+    r.i32(result.exitStatus);
+    r.i64(result.costUs);
+    r.str(result.out);
+    r.str(result.err);
+    return r.finished();
+}
+
+bool decodeDone(folly::StringPiece body, AgentDone& done) {
+    Reader r(body, FrameType::kDone);
+    uint8_t ok = 0;
+    uint8_t rolledBack = 0;
+    r.u8(ok);
+    r.u8(rolledBack);
+    r.i64(done.costUs);
+    done.ok = ok != 0;
+    done.rolledBack = rolledBack != 0;
+    return r.finished();
+}
+
+bool writeFrame(int fd, const std::string& body) {
+    if (body.size() > kMaxFrameSize) {
+        LOG(ERROR) << "The frame is too large, " << body.size() << " bytes";
+        return false;
+    }
+    uint32_t len = htonl(body.size());
+    std::string frame(reinterpret_cast<const char*>(&len), sizeof(len));
+    frame.append(body);
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        auto n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool readFrame(int fd, std::string& body, int32_t timeoutMs) {
+    uint32_t len = 0;
+    if (!readFully(fd, reinterpret_cast<char*>(&len), sizeof(len), timeoutMs)) {
+        return false;
+    }
+    len = ntohl(len);
+    if (len > kMaxFrameSize) {
+        LOG(ERROR) << "Bad frame size " << len;
+        return false;
+    }
+    body.resize(len);
+    return readFully(fd, &body[0], len, timeoutMs);
+}
+
+folly::Optional<std::string> readAgentToken() {
+    if (FLAGS_chaos_agent_token_file.empty()) {
+        return folly::none;
+    }
+    std::string token;
+    if (!folly::readFile(FLAGS_chaos_agent_token_file.c_str(), token)) {
+        LOG(ERROR) << "Read the token file " << FLAGS_chaos_agent_token_file << " failed";
+        return folly::none;
+    }
+    token = folly::trimWhitespace(token).str();
+    if (token.empty()) {
+        return folly::none;
+    }
+    return token;
+}
+
+bool tokenEquals(folly::StringPiece a, folly::StringPiece b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+}   // namespace utils
+}   // namespace chaos
@@ -0,0 +1,145 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_AGENTPROTOCOL_H_
+#define UTILS_AGENTPROTOCOL_H_
+
+#include "common/base/Base.h"
+
+// The token file shared by the plan and the chaos agents.
+DECLARE_string(chaos_agent_token_file);
+
+namespace chaos {
+namespace utils {
+
+/**
+ * The protocol between the plan and the chaos agent on every host.
+ *
+ * Every message is a frame: the length of the body (uint32, network order),
+ * then the body, whose first byte is the frame type. The integers in the body
+ * are fixed size in network order, and the strings are prefixed by their length.
+ *
+ * The client sends a kHello frame with the shared token first, the agent answers
+ * it with an empty kHello, or closes the connection if the token doesn't match.
+ * Then the client sends a kRequest frame, the agent streams a kResult frame once
+ * a rule is applied, and a kDone frame at last.
+ * */
+enum class FrameType : uint8_t {
+    kRequest    = 1,
+    kResult     = 2,
+    kDone       = 3,
+    kHello      = 4,
+};
+
+enum class RuleOp : uint8_t {
+    kIptablesInsert = 1,
+    // Delete all copies of the rule, it succeeds if the rule doesn't exist.
+    kIptablesDelete = 2,
+    kTcAdd          = 3,
+    kTcDel          = 4,
+};
+
+/**
+ * The rules are all the agent could apply, it never runs a shell. They are
+ * validated by validateRule, then passed to a fixed binary as the arguments.
+ *
+ * iptables drops the tcp packets from the peer (incoming, the INPUT chain) or to
+ * the peer (outgoing, the OUTPUT chain) with the destination port in
+ * [portMin, portMax], port 0 means any port.
+ * tc (tcset of tcconfig) delays the packets of the device in the same way, on
+ * the destination port portMin.
+ * */
+struct Rule {
+    RuleOp      op{RuleOp::kIptablesInsert};
+    bool        incoming{true};
+    // An IPv4 address or a host name.
+    std::string peer;
+    uint16_t    portMin{0};
+    uint16_t    portMax{0};
+    // Only for tc, e.g. device "eth0", delay "100ms", distro "10ms".
+    std::string device;
+    std::string delay;
+    std::string distro;
+    int32_t     loss{0};
+    int32_t     duplicate{0};
+};
+
+struct AgentRequest {
+    std::vector<Rule> rules;
+    // Stop at the first failed rule and roll the applied ones back in reverse order.
+    // Otherwise all rules are applied whatever the result is.
+    bool atomic{true};
+};
+
+struct AgentResult {
+    uint32_t    index{0};
+    int32_t     exitStatus{-1};
+    int64_t     costUs{0};
+    std::string out;
+    std::string err;
+};
+
+struct AgentDone {
+    bool        ok{false};
+    bool        rolledBack{false};
+    int64_t     costUs{0};
+};
+
+struct AgentResponse {
+    AgentDone                   done;
+    std::vector<AgentResult>    results;
+};
+
+// The max size of a frame body, the larger one is treated as a broken stream.
+constexpr uint32_t kMaxFrameSize = 16 << 20;
+
+// Return false with the reason if any field of the rule is malformed.
+bool validateRule(const Rule& rule, std::string& reason);
+
+// The rule undoing the insert or the add one, none for the delete ones.
+folly::Optional<Rule> rollbackOf(const Rule& rule);
+
+/**
+ * The arguments of the binary of the rule (iptables, tcset or tcdel), the rule
+ * must be valid. e.g. {"-I", "INPUT", "-p", "tcp", "-s", "192.168.8.5", ...}
+ * */
+std::vector<std::string> ruleArgs(const Rule& rule);
+
+// e.g. "iptables -I INPUT -p tcp ...", to show the rule.
+std::string toString(const Rule& rule);
+
+std::string encodeHello(const std::string& token);
+std::string encodeRequest(const AgentRequest& req);
+std::string encodeResult(const AgentResult& result);
+std::string encodeDone(const AgentDone& done);
+
+// Return the type of the frame body, or none if it's malformed.
+folly::Optional<FrameType> frameType(folly::StringPiece body);
+
+bool decodeHello(folly::StringPiece body, std::string& token);
+bool decodeRequest(folly::StringPiece body, AgentRequest& req);
+bool decodeResult(folly::StringPiece body, AgentResult& result);
+bool decodeDone(folly::StringPiece body, AgentDone& done);
+
+// Write the whole frame of the body, return false on any error.
+bool writeFrame(int fd, const std::string& body);
+
+/**
+ * Read a frame into body. It waits at most timeoutMs for every piece of the frame,
+ * -1 to wait forever. Return false if the peer is closed, timeout or on any error.
+ * */
+bool readFrame(int fd, std::string& body, int32_t timeoutMs);
+
+// Read the token in --chaos_agent_token_file, none if it's not set or empty.
+folly::Optional<std::string> readAgentToken();
+
+// Compare the tokens in constant time.
+bool tokenEquals(folly::StringPiece a, folly::StringPiece b);
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_AGENTPROTOCOL_H_
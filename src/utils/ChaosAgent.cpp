@@ -0,0 +1,248 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/ChaosAgent.h"
+#include <poll.h>
+#include <folly/Subprocess.h>
+#include "utils/NetUtils.h"
+
+DEFINE_string(chaos_agent_iptables, "/usr/sbin/iptables", "The iptables binary run by the agent");
+DEFINE_string(chaos_agent_tcset, "/usr/local/bin/tcset", "The tcset binary run by the agent");
+DEFINE_string(chaos_agent_tcdel, "/usr/local/bin/tcdel", "The tcdel binary run by the agent");
+
+namespace chaos {
+namespace utils {
+
+namespace {
+
+// How long the serving threads wait before checking whether it's stopped.
+constexpr int kPollIntervalMs = 200;
+// How long a client has to send its token.
+constexpr int kHelloTimeoutMs = 5000;
+// The max copies of an iptables rule removed by a delete.
+constexpr int32_t kMaxDuplicates = 16;
+
+int64_t sinceUs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+// Run the binary with the arguments, there is no shell in between.
+AgentResult runBinary(uint32_t index, const std::string& binary, std::vector<std::string> args) {
+    AgentResult result;
+    result.index = index;
+    auto start = std::chrono::steady_clock::now();
+    args.insert(args.begin(), binary);
+    try {
+        folly::Subprocess proc(args,
+                               folly::Subprocess::Options()
+                                    .stdinFd(folly::Subprocess::DEV_NULL)
+                                    .pipeStdout()
+                                    .pipeStderr());
+        auto p = proc.communicate();
+        auto ret = proc.wait();
+        result.exitStatus = ret.exited() ? ret.exitStatus() : -1;
+        result.out = std::move(p.first);
+        result.err = std::move(p.second);
+    } catch (const std::exception& e) {
+        result.err = e.what();
+    }
+    result.costUs = sinceUs(start);
+    VLOG(1) << "Run " << folly::join(" ", args) << ", exit " << result.exitStatus
+            << ", cost " << result.costUs << "us";
+    return result;
+}
+
+// The rule must be valid.
+AgentResult applyRule(uint32_t index, const Rule& rule) {
+    auto args = ruleArgs(rule);
+    switch (rule.op) {
+        case RuleOp::kIptablesInsert:
+            return runBinary(index, FLAGS_chaos_agent_iptables, std::move(args));
+        case RuleOp::kIptablesDelete: {
+            // The rule may have been inserted more than once, remove them until it's gone.
+            auto check = args;
+            check[0] = "-C";
+            auto start = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < kMaxDuplicates; i++) {
+                auto result = runBinary(index, FLAGS_chaos_agent_iptables, check);
+                if (result.exitStatus != 0) {
+                    result.exitStatus = 0;
+                    result.costUs = sinceUs(start);
+                    return result;
+                }
+                result = runBinary(index, FLAGS_chaos_agent_iptables, args);
+                if (result.exitStatus != 0) {
+                    return result;
+                }
+            }
+            AgentResult result;
+            result.index = index;
+            result.err = folly::stringPrintf("Still there after deleted %d times", kMaxDuplicates);
+            result.costUs = sinceUs(start);
+            return result;
+        }
+        case RuleOp::kTcAdd:
+            return runBinary(index, FLAGS_chaos_agent_tcset, std::move(args));
+        case RuleOp::kTcDel:
+            return runBinary(index, FLAGS_chaos_agent_tcdel, std::move(args));
+    }
+    LOG(FATAL) << "Unknown op " << static_cast<int32_t>(rule.op);
+    return AgentResult();
+}
+
+}   // namespace
+
+// static
+AgentDone ChaosAgent::apply(const AgentRequest& req, ResultCallback onResult) {
+    auto start = std::chrono::steady_clock::now();
+    AgentDone done;
+    // Nothing is applied if any rule is malformed.
+    for (uint32_t i = 0; i < req.rules.size(); i++) {
+        std::string reason;
+        if (!validateRule(req.rules[i], reason)) {
+            AgentResult result;
+            result.index = i;
+            result.err = "Bad rule, " + reason;
+            onResult(result);
+            done.costUs = sinceUs(start);
+            return done;
+        }
+    }
+    done.ok = true;
+    size_t applied = 0;
+    for (; applied < req.rules.size(); applied++) {
+        auto result = applyRule(applied, req.rules[applied]);
+        auto failed = result.exitStatus != 0;
+        onResult(result);
+        if (failed) {
+            done.ok = false;
+            if (req.atomic) {
+                break;
+            }
+        }
+    }
+    if (!done.ok && req.atomic) {
+        // The failed one is not applied, roll back the former ones in reverse order.
+        // The index of a rollback is after all rules, to tell it from the apply.
+        while (applied-- > 0) {
+            auto rollback = rollbackOf(req.rules[applied]);
+            if (!rollback.hasValue()) {
+                continue;
+            }
+            auto result = applyRule(req.rules.size() + applied, rollback.value());
+            if (result.exitStatus != 0) {
+                LOG(ERROR) << "Rollback " << toString(rollback.value()) << " failed, "
+                           << result.err;
+            }
+            onResult(result);
+        }
+        done.rolledBack = true;
+    }
+    done.costUs = sinceUs(start);
+    return done;
+}
+
+bool ChaosAgent::start() {
+    CHECK(stopped_.load());
+    if (token_.empty()) {
+        LOG(ERROR) << "The chaos agent must not start without a token";
+        return false;
+    }
+    listenFd_ = NetUtils::listenOn(address_, port_);
+    if (listenFd_ < 0) {
+        return false;
+    }
+    stopped_ = false;
+    thread_ = std::make_unique<std::thread>([this] { serve(); });
+    LOG(INFO) << "The chaos agent is listening on " << address_ << ":" << port_;
+    return true;
+}
+
+void ChaosAgent::stop() {
+    if (stopped_.exchange(true)) {
+        return;
+    }
+    thread_->join();
+    thread_.reset();
+    ::close(listenFd_);
+    listenFd_ = -1;
+    // The connection threads exit soon after stopped_ is set.
+    std::unique_lock<std::mutex> lk(connsLock_);
+    connsCv_.wait(lk, [this] { return conns_ == 0; });
+}
+
+void ChaosAgent::serve() {
+    while (!stopped_.load()) {
+        int fd = NetUtils::acceptOne(listenFd_, kPollIntervalMs);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lk(connsLock_);
+            conns_++;
+        }
+        // Detached, so the finished ones are never kept, stop() waits by the counter.
+        std::thread([this, fd] {
+            handle(fd);
+            ::close(fd);
+            std::lock_guard<std::mutex> lk(connsLock_);
+            conns_--;
+            connsCv_.notify_all();
+        }).detach();
+    }
+}
+
+bool ChaosAgent::authenticate(int fd) {
+    std::string body;
+    std::string token;
+    if (!readFrame(fd, body, kHelloTimeoutMs) || !decodeHello(body, token)) {
+        LOG(ERROR) << "No hello from the client, close the connection";
+        return false;
+    }
+    if (!tokenEquals(token, token_)) {
+        LOG(ERROR) << "Bad token from the client, close the connection";
+        return false;
+    }
+    return writeFrame(fd, encodeHello(""));
+}
+
+void ChaosAgent::handle(int fd) {
+    // Nothing else is decoded before the client is authenticated.
+    if (!authenticate(fd)) {
+        return;
+    }
+    std::string body;
+    while (!stopped_.load()) {
+        pollfd pfd{fd, POLLIN, 0};
+        auto ret = ::poll(&pfd, 1, kPollIntervalMs);
+        if (ret == 0) {
+            continue;
+        }
+        // The rest of the frame should follow soon.
+        if (ret < 0 || !readFrame(fd, body, 5000)) {
+            return;
+        }
+        AgentRequest req;
+        if (!decodeRequest(body, req)) {
+            LOG(ERROR) << "Bad request of " << body.size() << " bytes, close the connection";
+            return;
+        }
+        bool sent = true;
+        auto done = apply(req, [fd, &sent] (const AgentResult& result) {
+            // Keep applying even if the client is gone, so the rollback is not skipped.
+            sent = sent && writeFrame(fd, encodeResult(result));
+        });
+        LOG(INFO) << "Applied " << req.rules.size() << " rules, ok " << done.ok
+                  << ", rolled back " << done.rolledBack << ", cost " << done.costUs << "us";
+        if (!sent || !writeFrame(fd, encodeDone(done))) {
+            return;
+        }
+    }
+}
+
+}   // namespace utils
+}   // namespace chaos
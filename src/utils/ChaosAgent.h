@@ -0,0 +1,84 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_CHAOSAGENT_H_
+#define UTILS_CHAOSAGENT_H_
+
+#include "common/base/Base.h"
+#include <condition_variable>
+#include <thread>
+#include "utils/AgentProtocol.h"
+
+DECLARE_string(chaos_agent_iptables);
+DECLARE_string(chaos_agent_tcset);
+DECLARE_string(chaos_agent_tcdel);
+
+namespace chaos {
+namespace utils {
+
+/**
+ * The resident agent on every host to apply the disturbances, i.e. the iptables
+ * and tc rules, so they cost neither a ssh session nor a login shell.
+ *
+ * Only the clients with the shared token are served. The agent applies nothing
+ * but the typed rules, by running the fixed binaries without a shell.
+ * Every connection is served by its own thread, the requests of a connection are
+ * applied one by one, and the result of every rule is sent back once it's applied.
+ * See AgentProtocol.h for the protocol, and AgentClient for the client.
+ * */
+class ChaosAgent final {
+public:
+    using ResultCallback = std::function<void(const AgentResult&)>;
+
+    // port 0 picks a free port, see port(). It refuses to start without a token.
+    ChaosAgent(const std::string& address, uint16_t port, const std::string& token)
+        : address_(address)
+        , port_(port)
+        , token_(token) {}
+
+    ~ChaosAgent() {
+        stop();
+    }
+
+    bool start();
+
+    void stop();
+
+    uint16_t port() const {
+        return port_;
+    }
+
+    /**
+     * Apply the rules on the local host, onResult is called once a rule (including
+     * a rollback) is applied. Nothing is applied if any rule is malformed.
+     * */
+    static AgentDone apply(const AgentRequest& req, ResultCallback onResult);
+
+private:
+    void serve();
+
+    // Read the hello of the client, return false if its token doesn't match.
+    bool authenticate(int fd);
+
+    void handle(int fd);
+
+private:
+    std::string                     address_;
+    uint16_t                        port_;
+    std::string                     token_;
+    int                             listenFd_{-1};
+    std::atomic<bool>               stopped_{true};
+    std::unique_ptr<std::thread>    thread_;
+    // The number of the connections being served.
+    std::mutex                      connsLock_;
+    std::condition_variable         connsCv_;
+    int32_t                         conns_{0};
+};
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_CHAOSAGENT_H_
@@ -0,0 +1,272 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/Metrics.h"
+#include <folly/Bits.h>
+#include <folly/FileUtil.h>
+#include <folly/SharedMutex.h>
+#include <folly/json.h>
+
+DEFINE_string(metrics_prometheus_file, "",
+              "Export the metrics in the Prometheus text format to the file when the plan ends");
+DEFINE_string(metrics_json_file, "", "Export the metrics in json to the file when the plan ends");
+
+namespace chaos {
+namespace utils {
+
+namespace {
+
+struct Metric {
+    std::string                 name;
+    Metrics::Labels             labels;
+    std::unique_ptr<Histogram>  histogram;
+    std::unique_ptr<Counter>    counter;
+};
+
+folly::SharedMutex gMetricsLock;
+// Ordered by the name, so the series of one metric are exported together.
+std::map<std::pair<std::string, Metrics::Labels>, std::unique_ptr<Metric>> gMetrics;
+
+Metric* getOrAdd(const std::string& name, const Metrics::Labels& labels, bool isHistogram) {
+    auto key = std::make_pair(name, labels);
+    {
+        folly::SharedMutex::ReadHolder rh(gMetricsLock);
+        auto it = gMetrics.find(key);
+        if (it != gMetrics.end()) {
+            return it->second.get();
+        }
+    }
+    folly::SharedMutex::WriteHolder wh(gMetricsLock);
+    auto& metric = gMetrics[key];
+    if (metric == nullptr) {
+        metric = std::make_unique<Metric>();
+        metric->name = name;
+        metric->labels = labels;
+        if (isHistogram) {
+            metric->histogram = std::make_unique<Histogram>();
+        } else {
+            metric->counter = std::make_unique<Counter>();
+        }
+    }
+    return metric.get();
+}
+
+std::string labelsStr(const Metrics::Labels& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) {
+        return "";
+    }
+    std::string str = "{";
+    for (const auto& label : labels) {
+        if (str.size() > 1) {
+            str += ',';
+        }
+        str += label.first;
+        str += "=\"";
+        // Escape as the Prometheus text format requires.
+        for (auto c : label.second) {
+            if (c == '\\' || c == '"') {
+                str += '\\';
+                str += c;
+            } else if (c == '\n') {
+                str += "\\n";
+            } else {
+                str += c;
+            }
+        }
+        str += '"';
+    }
+    if (!extra.empty()) {
+        if (str.size() > 1) {
+            str += ',';
+        }
+        str += extra;
+    }
+    str += '}';
+    return str;
+}
+
+}   // namespace
+
+// static
+size_t Histogram::bucketIndex(uint64_t value) {
+    if (value < kSubBuckets) {
+        return value;
+    }
+    uint32_t exp = folly::findLastSet(value) - 1;
+    auto sub = (value >> (exp - kSubBits)) & (kSubBuckets - 1);
+    return kSubBuckets + (exp - kSubBits) * kSubBuckets + sub;
+}
+
+// static
+uint64_t Histogram::bucketUpperBound(size_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    uint32_t shift = (index - kSubBuckets) / kSubBuckets;
+    uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+    uint64_t lower = (kSubBuckets + sub) << shift;
+    return lower + ((1UL << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    auto min = min_.load(std::memory_order_relaxed);
+    while (value < min && !min_.compare_exchange_weak(min, value, std::memory_order_relaxed)) {
+    }
+    auto max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < kBuckets; i++) {
+        auto count = buckets_[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            snapshot.buckets.emplace_back(bucketUpperBound(i), count);
+            snapshot.count += count;
+        }
+    }
+    // The buckets are the source of truth, a concurrent record may be half done.
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    snapshot.min = snapshot.count == 0 ? 0 : min_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count)));
+    uint64_t seen = 0;
+    for (const auto& bucket : buckets) {
+        seen += bucket.second;
+        if (seen >= rank) {
+            return std::min(bucket.first, max);
+        }
+    }
+    return max;
+}
+
+std::string Histogram::Snapshot::toString() const {
+    return folly::stringPrintf("count %lu, avg %lu, p50 %lu, p99 %lu, max %lu",
+                               count, count == 0 ? 0 : sum / count,
+                               percentile(0.5), percentile(0.99), max);
+}
+
+// static
+Histogram* Metrics::histogram(const std::string& name, const Labels& labels) {
+    auto* metric = getOrAdd(name, labels, true);
+    CHECK(metric->histogram != nullptr) << name << " is not a histogram";
+    return metric->histogram.get();
+}
+
+// static
+Counter* Metrics::counter(const std::string& name, const Labels& labels) {
+    auto* metric = getOrAdd(name, labels, false);
+    CHECK(metric->counter != nullptr) << name << " is not a counter";
+    return metric->counter.get();
+}
+
+// static
+std::vector<std::pair<Metrics::Labels, Histogram::Snapshot>>
+Metrics::snapshots(const std::string& name) {
+    std::vector<std::pair<Labels, Histogram::Snapshot>> snapshots;
+    folly::SharedMutex::ReadHolder rh(gMetricsLock);
+    auto it = gMetrics.lower_bound(std::make_pair(name, Labels()));
+    for (; it != gMetrics.end() && it->second->name == name; it++) {
+        if (it->second->histogram != nullptr) {
+            snapshots.emplace_back(it->second->labels, it->second->histogram->snapshot());
+        }
+    }
+    return snapshots;
+}
+
+// static
+std::string Metrics::toPrometheus() {
+    std::string text;
+    std::string lastName;
+    folly::SharedMutex::ReadHolder rh(gMetricsLock);
+    for (const auto& entry : gMetrics) {
+        const auto& metric = *entry.second;
+        if (metric.name != lastName) {
+            text += folly::stringPrintf("# TYPE %s %s\n", metric.name.c_str(),
+                                        metric.histogram != nullptr ? "histogram" : "counter");
+            lastName = metric.name;
+        }
+        if (metric.counter != nullptr) {
+            text += folly::stringPrintf("%s%s %ld\n", metric.name.c_str(),
+                                        labelsStr(metric.labels).c_str(),
+                                        metric.counter->value());
+            continue;
+        }
+        auto snapshot = metric.histogram->snapshot();
+        uint64_t cumulative = 0;
+        for (const auto& bucket : snapshot.buckets) {
+            cumulative += bucket.second;
+            auto le = folly::stringPrintf("le=\"%lu\"", bucket.first);
+            text += folly::stringPrintf("%s_bucket%s %lu\n", metric.name.c_str(),
+                                        labelsStr(metric.labels, le).c_str(), cumulative);
+        }
+        text += folly::stringPrintf("%s_bucket%s %lu\n", metric.name.c_str(),
+                                    labelsStr(metric.labels, "le=\"+Inf\"").c_str(),
+                                    snapshot.count);
+        text += folly::stringPrintf("%s_sum%s %lu\n", metric.name.c_str(),
+                                    labelsStr(metric.labels).c_str(), snapshot.sum);
+        text += folly::stringPrintf("%s_count%s %lu\n", metric.name.c_str(),
+                                    labelsStr(metric.labels).c_str(), snapshot.count);
+    }
+    return text;
+}
+
+// static
+std::string Metrics::toJson() {
+    folly::dynamic metrics = folly::dynamic::array;
+    folly::SharedMutex::ReadHolder rh(gMetricsLock);
+    for (const auto& entry : gMetrics) {
+        const auto& metric = *entry.second;
+        folly::dynamic labels = folly::dynamic::object;
+        for (const auto& label : metric.labels) {
+            labels[label.first] = label.second;
+        }
+        folly::dynamic obj = folly::dynamic::object("name", metric.name)("labels", labels);
+        if (metric.counter != nullptr) {
+            obj["value"] = metric.counter->value();
+        } else {
+            auto snapshot = metric.histogram->snapshot();
+            obj["count"] = static_cast<int64_t>(snapshot.count);
+            obj["sum"] = static_cast<int64_t>(snapshot.sum);
+            obj["min"] = static_cast<int64_t>(snapshot.min);
+            obj["max"] = static_cast<int64_t>(snapshot.max);
+            obj["p50"] = static_cast<int64_t>(snapshot.percentile(0.5));
+            obj["p90"] = static_cast<int64_t>(snapshot.percentile(0.9));
+            obj["p99"] = static_cast<int64_t>(snapshot.percentile(0.99));
+            obj["p999"] = static_cast<int64_t>(snapshot.percentile(0.999));
+        }
+        metrics.push_back(std::move(obj));
+    }
+    return folly::toPrettyJson(metrics);
+}
+
+// static
+void Metrics::dump() {
+    if (!FLAGS_metrics_prometheus_file.empty()) {
+        if (!folly::writeFile(toPrometheus(), FLAGS_metrics_prometheus_file.c_str())) {
+            LOG(ERROR) << "Write the metrics to " << FLAGS_metrics_prometheus_file << " failed";
+        }
+    }
+    if (!FLAGS_metrics_json_file.empty()) {
+        if (!folly::writeFile(toJson(), FLAGS_metrics_json_file.c_str())) {
+            LOG(ERROR) << "Write the metrics to " << FLAGS_metrics_json_file << " failed";
+        }
+    }
+}
+
+}   // namespace utils
+}   // namespace chaos
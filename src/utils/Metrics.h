@@ -0,0 +1,111 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_METRICS_H_
+#define UTILS_METRICS_H_
+
+#include "common/base/Base.h"
+
+DECLARE_string(metrics_prometheus_file);
+DECLARE_string(metrics_json_file);
+
+namespace chaos {
+namespace utils {
+
+/**
+ * A log-linear histogram in the style of HdrHistogram: every power of two range
+ * is split into kSubBuckets linear buckets, so the relative error of a value is
+ * within 1/kSubBuckets at any magnitude. Recording is lock free.
+ * */
+class Histogram final {
+public:
+    static constexpr uint32_t kSubBits = 4;
+    static constexpr uint64_t kSubBuckets = 1UL << kSubBits;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+    struct Snapshot {
+        uint64_t count{0};
+        uint64_t sum{0};
+        uint64_t min{0};
+        uint64_t max{0};
+        // The upper bound and the count of the non-empty buckets, in order.
+        std::vector<std::pair<uint64_t, uint64_t>> buckets;
+
+        // p in [0, 1], the value is the upper bound of its bucket.
+        uint64_t percentile(double p) const;
+
+        // e.g. "count 10, avg 3, p50 2, p99 9, max 9"
+        std::string toString() const;
+    };
+
+    void record(uint64_t value);
+
+    Snapshot snapshot() const;
+
+    uint64_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    static size_t bucketIndex(uint64_t value);
+
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> max_{0};
+};
+
+class Counter final {
+public:
+    void add(int64_t delta = 1) {
+        value_.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    int64_t value() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+/**
+ * The metrics of the whole process, e.g. the latency of every action type, of
+ * the graph statements and of the ssh commands. They are exported in the
+ * Prometheus text format and in json when the plan finishes.
+ *
+ * A metric is identified by its name and labels, the returned pointer stays
+ * valid for the life of the process, so the hot paths look it up only once.
+ * */
+class Metrics final {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    static Histogram* histogram(const std::string& name, const Labels& labels = {});
+
+    static Counter* counter(const std::string& name, const Labels& labels = {});
+
+    // The snapshots of all series of the histogram named "name".
+    static std::vector<std::pair<Labels, Histogram::Snapshot>> snapshots(const std::string& name);
+
+    static std::string toPrometheus();
+
+    static std::string toJson();
+
+    // Write the exports to --metrics_prometheus_file and --metrics_json_file if set.
+    static void dump();
+
+private:
+    Metrics() = default;
+};
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_METRICS_H_
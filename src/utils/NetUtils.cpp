@@ -0,0 +1,56 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/NetUtils.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace chaos {
+namespace utils {
+
+// static
+int NetUtils::listenOn(const std::string& address, uint16_t& port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG(ERROR) << "Create the socket failed, errno " << errno;
+        return -1;
+    }
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        LOG(ERROR) << "Bad address " << address;
+        ::close(fd);
+        return -1;
+    }
+    socklen_t len = sizeof(addr);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0
+            || ::listen(fd, 16) != 0
+            || ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        LOG(ERROR) << "Listen on " << address << ":" << port << " failed, errno " << errno;
+        ::close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+// static
+int NetUtils::acceptOne(int listenFd, int32_t timeoutMs) {
+    pollfd pfd{listenFd, POLLIN, 0};
+    if (::poll(&pfd, 1, timeoutMs) <= 0) {
+        return -1;
+    }
+    return ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+}
+
+}   // namespace utils
+}   // namespace chaos
@@ -0,0 +1,33 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_NETUTILS_H_
+#define UTILS_NETUTILS_H_
+
+#include "common/base/Base.h"
+
+namespace chaos {
+namespace utils {
+
+class NetUtils final {
+public:
+    /**
+     * Listen on the IPv4 address and the port, port 0 picks a free one and the
+     * picked one is set back. Return the fd, or -1 on any error.
+     * */
+    static int listenOn(const std::string& address, uint16_t& port);
+
+    /**
+     * Accept a connection within timeoutMs, so the caller could check whether it's
+     * stopped in between. Return the fd, or -1 if there is none.
+     * */
+    static int acceptOne(int listenFd, int32_t timeoutMs);
+};
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_NETUTILS_H_
@@ -0,0 +1,54 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_PARALLEL_H_
+#define UTILS_PARALLEL_H_
+
+#include "common/base/Base.h"
+#include <thread>
+
+namespace chaos {
+namespace utils {
+
+/**
+ * Call fn(i) for every i in [0, n), at most maxInFlight of them at the same time.
+ * It returns once all calls finished. fn is run on the calling thread if only
+ * one call is allowed in flight.
+ * */
+template <typename Fn>
+void parallelFor(size_t n, size_t maxInFlight, Fn&& fn) {
+    if (n == 0) {
+        return;
+    }
+    auto threadsNum = std::min(n, std::max<size_t>(1, maxInFlight));
+    if (threadsNum == 1) {
+        for (size_t i = 0; i < n; i++) {
+            fn(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        size_t i;
+        while ((i = next.fetch_add(1, std::memory_order_relaxed)) < n) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadsNum - 1);
+    for (size_t t = 1; t < threadsNum; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+#endif  // UTILS_PARALLEL_H_
@@ -5,11 +5,175 @@
  */
 
 #include "utils/SshHelper.h"
+#include "utils/Metrics.h"
+#include "utils/Parallel.h"
 #include <folly/String.h>
 
+DEFINE_bool(ssh_mux, true, "Multiplex the ssh commands to the same host on one connection");
+DEFINE_string(ssh_control_dir, "/tmp", "The directory of the ssh control sockets");
+DEFINE_int32(ssh_control_persist, 600,
+             "How long the idle master connection stays open, in seconds");
+DEFINE_int32(ssh_max_in_flight, 16, "The max number of ssh commands run at the same time "
+                                    "when fanning out to many hosts");
+
 namespace chaos {
 namespace utils {
 
+namespace {
+
+// How long to run the commands to a remote without multiplexing once its master failed,
+// doubled on every failure in a row.
+constexpr std::chrono::seconds kMinMasterBackoff{1};
+constexpr std::chrono::seconds kMaxMasterBackoff{60};
+
+struct Master {
+    std::mutex  lock;
+    bool        established{false};
+    // When the master was used last time, it exits once idle for --ssh_control_persist.
+    std::chrono::steady_clock::time_point lastUsed;
+    // Don't try to establish the master again until then.
+    std::chrono::steady_clock::time_point retryAfter;
+    std::chrono::seconds backoff{0};
+};
+
+std::mutex                                              gMastersLock;
+std::unordered_map<std::string, std::shared_ptr<Master>> gMasters;
+
+// The metrics of a remote, looked up once since they are recorded by every command.
+struct HostMetrics {
+    Histogram*  handshakeLatency;
+    Histogram*  commandLatency;
+    Counter*    commandFailures;
+};
+
+std::mutex                                      gHostMetricsLock;
+std::unordered_map<std::string, HostMetrics>    gHostMetrics;
+
+const HostMetrics& metricsOf(const std::string& remote) {
+    std::lock_guard<std::mutex> lk(gHostMetricsLock);
+    auto it = gHostMetrics.find(remote);
+    if (it == gHostMetrics.end()) {
+        Metrics::Labels labels{{"host", remote}};
+        HostMetrics m{Metrics::histogram("chaos_ssh_handshake_latency_us", labels),
+                      Metrics::histogram("chaos_ssh_command_latency_us", labels),
+                      Metrics::counter("chaos_ssh_command_failures", labels)};
+        it = gHostMetrics.emplace(remote, m).first;
+    }
+    // The elements of an unordered_map are never moved.
+    return it->second;
+}
+
+std::atomic<int64_t> gHandshakes{0};
+std::atomic<int64_t> gHandshakeTotalUs{0};
+std::atomic<int64_t> gReuses{0};
+std::atomic<int64_t> gDirect{0};
+
+// Only the explicit "-N -f" call may become the master. A command must never do it,
+// otherwise it would stay in foreground as the master and communicate() would wait
+// for it to exit after --ssh_control_persist, so it connects directly if the master is gone.
+std::vector<std::string> controlOptions(bool master = false) {
+    std::vector<std::string> opts{"-o", folly::stringPrintf("ControlPath=%s/chaos-ssh-%%C",
+                                                            FLAGS_ssh_control_dir.c_str())};
+    if (master) {
+        opts.insert(opts.end(), {"-o", "ControlMaster=auto",
+                                 "-o", folly::stringPrintf("ControlPersist=%d",
+                                                           FLAGS_ssh_control_persist)});
+    } else {
+        opts.insert(opts.end(), {"-o", "ControlMaster=no"});
+    }
+    return opts;
+}
+
+// Whether the master of the remote is still alive, it may have exited once idle for long.
+bool checkMaster(const std::string& remote) {
+    std::vector<std::string> args{NEBULA_STRINGIFY(SSH_EXEC)};
+    auto opts = controlOptions();
+    args.insert(args.end(), opts.begin(), opts.end());
+    args.insert(args.end(), {"-O", "check", remote});
+    folly::Subprocess proc(args,
+                           folly::Subprocess::Options()
+                                .stdinFd(folly::Subprocess::DEV_NULL)
+                                .stdoutFd(folly::Subprocess::DEV_NULL)
+                                .stderrFd(folly::Subprocess::DEV_NULL));
+    auto ret = proc.wait();
+    return ret.exited() && ret.exitStatus() == 0;
+}
+
+}   // namespace
+
+std::string SshHelper::Stats::toString() const {
+    return folly::stringPrintf("%ld handshakes cost %ldms, %ld commands reused them and saved "
+                               "about %ldms, %ld commands not multiplexed",
+                               handshakes, handshakeTotalUs / 1000, reuses,
+                               savedUs() / 1000, direct);
+}
+
+// static
+std::vector<std::string> SshHelper::muxOptions(const std::string& remote) {
+    if (!FLAGS_ssh_mux) {
+        return {};
+    }
+    std::shared_ptr<Master> master;
+    {
+        std::lock_guard<std::mutex> lk(gMastersLock);
+        auto& m = gMasters[remote];
+        if (m == nullptr) {
+            m = std::make_shared<Master>();
+        }
+        master = m;
+    }
+    std::lock_guard<std::mutex> lk(master->lock);
+    auto now = std::chrono::steady_clock::now();
+    if (!master->established && now < master->retryAfter) {
+        return {};
+    }
+    if (master->established) {
+        // Only check the master if it has been idle for long, the check is a local
+        // round trip to the control socket, much cheaper than a handshake anyway.
+        auto idle = now - master->lastUsed;
+        if (idle < std::chrono::seconds(FLAGS_ssh_control_persist) / 2 || checkMaster(remote)) {
+            master->lastUsed = now;
+            gReuses++;
+            return controlOptions();
+        }
+        LOG(INFO) << "The ssh master to " << remote << " has exited, establish it again";
+        master->established = false;
+    }
+    // Establish the master explicitly, so the handshake could be timed.
+    // It goes to background once authenticated, its output must not be piped,
+    // otherwise we would wait for it to exit.
+    std::vector<std::string> args{NEBULA_STRINGIFY(SSH_EXEC)};
+    auto opts = controlOptions(true);
+    args.insert(args.end(), opts.begin(), opts.end());
+    args.insert(args.end(), {"-N", "-f", remote});
+    auto start = std::chrono::steady_clock::now();
+    folly::Subprocess proc(args,
+                           folly::Subprocess::Options()
+                                .stdinFd(folly::Subprocess::DEV_NULL)
+                                .stdoutFd(folly::Subprocess::DEV_NULL)
+                                .stderrFd(folly::Subprocess::DEV_NULL));
+    auto ret = proc.wait();
+    auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    if (!ret.exited() || ret.exitStatus() != 0) {
+        master->backoff = std::min(kMaxMasterBackoff,
+                                   std::max(kMinMasterBackoff, master->backoff * 2));
+        master->retryAfter = std::chrono::steady_clock::now() + master->backoff;
+        LOG(WARNING) << "Establish the ssh master to " << remote << " failed, "
+                     << ret.str() << ", don't multiplex the commands to it in the next "
+                     << master->backoff.count() << "s";
+        return {};
+    }
+    LOG(INFO) << "Established the ssh master to " << remote << ", cost " << costUs << "us";
+    metricsOf(remote).handshakeLatency->record(costUs);
+    gHandshakes++;
+    gHandshakeTotalUs += costUs;
+    master->established = true;
+    master->backoff = std::chrono::seconds(0);
+    master->lastUsed = std::chrono::steady_clock::now();
+    return controlOptions();
+}
+
 // static
 folly::ProcessReturnCode
 SshHelper::run(const std::string& command,
@@ -24,14 +188,99 @@ SshHelper::run(const std::string& command,
         remote = hostName;
     }
     VLOG(1) << "Remote " << remote  << ", command " << command;
-    folly::Subprocess proc({NEBULA_STRINGIFY(SSH_EXEC), remote, command},
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> args{NEBULA_STRINGIFY(SSH_EXEC)};
+    auto opts = muxOptions(remote);
+    if (opts.empty()) {
+        gDirect++;
+    }
+    args.insert(args.end(), opts.begin(), opts.end());
+    args.emplace_back(remote);
+    args.emplace_back(command);
+    folly::Subprocess proc(args,
                            folly::Subprocess::Options().pipeStdin().pipeStdout().pipeStderr());
     auto p = proc.communicate();
     readStdout(p.first);
     if (!p.second.empty()) {
         readStderr(p.second);
     }
-    return proc.wait();
+    auto ret = proc.wait();
+    // Including the handshake if it is the first command to the remote.
+    auto costUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    const auto& metrics = metricsOf(remote);
+    metrics.commandLatency->record(costUs);
+    // exitStatus() throws if ssh was killed by a signal.
+    if (!ret.exited() || ret.exitStatus() != 0) {
+        metrics.commandFailures->add();
+    }
+    return ret;
+}
+
+// static
+std::vector<RemoteResult> SshHelper::runOnHosts(const std::vector<RemoteCommand>& commands,
+                                                size_t maxInFlight) {
+    if (maxInFlight == 0) {
+        maxInFlight = FLAGS_ssh_max_in_flight;
+    }
+    std::vector<RemoteResult> results(commands.size());
+    auto start = std::chrono::steady_clock::now();
+    parallelFor(commands.size(), maxInFlight, [&] (size_t i) {
+        const auto& cmd = commands[i];
+        auto& result = results[i];
+        result.ret = run(cmd.command,
+                         cmd.host,
+                         [&result] (const std::string& out) {
+                             result.out = out;
+                         },
+                         [&result] (const std::string& err) {
+                             result.err = err;
+                         },
+                         cmd.user);
+        if (!result.err.empty()) {
+            LOG(ERROR) << "The error of " << cmd.command << " on " << cmd.host
+                       << " is " << result.err;
+        }
+    });
+    VLOG(1) << "Run " << commands.size() << " commands on hosts cost "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count() << "ms";
+    return results;
+}
+
+// static
+SshHelper::Stats SshHelper::stats() {
+    Stats stats;
+    stats.handshakes = gHandshakes.load();
+    stats.handshakeTotalUs = gHandshakeTotalUs.load();
+    stats.reuses = gReuses.load();
+    stats.direct = gDirect.load();
+    return stats;
+}
+
+// static
+void SshHelper::closeAll() {
+    std::unordered_map<std::string, std::shared_ptr<Master>> masters;
+    {
+        std::lock_guard<std::mutex> lk(gMastersLock);
+        masters.swap(gMasters);
+    }
+    for (auto& m : masters) {
+        std::lock_guard<std::mutex> lk(m.second->lock);
+        if (!m.second->established) {
+            continue;
+        }
+        std::vector<std::string> args{NEBULA_STRINGIFY(SSH_EXEC)};
+        auto opts = controlOptions();
+        args.insert(args.end(), opts.begin(), opts.end());
+        args.insert(args.end(), {"-O", "exit", m.first});
+        folly::Subprocess proc(args,
+                               folly::Subprocess::Options()
+                                    .stdinFd(folly::Subprocess::DEV_NULL)
+                                    .stdoutFd(folly::Subprocess::DEV_NULL)
+                                    .stderrFd(folly::Subprocess::DEV_NULL));
+        proc.wait();
+    }
 }
 
 }  // namespace utils
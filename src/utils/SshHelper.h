@@ -10,15 +10,55 @@
 #include "common/base/Base.h"
 #include <folly/Subprocess.h>
 
+DECLARE_bool(ssh_mux);
+DECLARE_int32(ssh_max_in_flight);
+
 namespace chaos {
 namespace utils {
 
 using ReadCallback = std::function<void(const std::string&)>;
 
+struct RemoteCommand {
+    std::string command;
+    std::string host;
+    std::string user;
+};
+
+struct RemoteResult {
+    folly::ProcessReturnCode ret;
+    std::string out;
+    std::string err;
+
+    bool ok() const {
+        return ret.exited() && ret.exitStatus() == 0;
+    }
+};
+
 class SshHelper {
 public:
+    struct Stats {
+        // Connections (TCP and key exchange) established.
+        int64_t handshakes{0};
+        int64_t handshakeTotalUs{0};
+        // Commands run over an existing connection.
+        int64_t reuses{0};
+        // Commands run without multiplexing (disabled, or the master failed).
+        int64_t direct{0};
+
+        // Handshake time saved by the reuses, estimated with the average handshake cost.
+        int64_t savedUs() const {
+            return handshakes == 0 ? 0 : reuses * handshakeTotalUs / handshakes;
+        }
+
+        std::string toString() const;
+    };
+
     /**
      * ssh to the host as current user, and run command
+     *
+     * With --ssh_mux, every remote keeps one master connection (OpenSSH
+     * ControlMaster), all commands to it are channels multiplexed on it,
+     * so only the first one pays for the handshake.
      * */
     static folly::ProcessReturnCode run(const std::string& command,
                                         const std::string& hostName,
@@ -26,8 +66,24 @@ public:
                                         ReadCallback readStderr,
                                         const std::string& user = "");
 
+    /**
+     * Run the commands concurrently, at most maxInFlight at the same time,
+     * and return the results in the same order as the commands.
+     * So it costs about the time of the slowest one instead of the sum.
+     * */
+    static std::vector<RemoteResult> runOnHosts(const std::vector<RemoteCommand>& commands,
+                                                size_t maxInFlight = 0);
+
+    static Stats stats();
+
+    // Close all master connections.
+    static void closeAll();
+
 private:
     SshHelper() = default;
+
+    // Return the ssh options to reach the remote, empty if it is not multiplexed.
+    static std::vector<std::string> muxOptions(const std::string& remote);
 };
 
 }  // namespace utils
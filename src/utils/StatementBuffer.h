@@ -0,0 +1,80 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_STATEMENTBUFFER_H_
+#define UTILS_STATEMENTBUFFER_H_
+
+#include "common/base/Base.h"
+#include <folly/Conv.h>
+#include <folly/Range.h>
+
+namespace chaos {
+namespace utils {
+
+/**
+ * Append-only buffer to build a statement piece by piece.
+ * clear() keeps the memory, so once the buffer has grown to the size of the
+ * largest statement, building another one allocates nothing.
+ * */
+class StatementBuffer {
+public:
+    explicit StatementBuffer(size_t reserved = 4096) {
+        buf_.reserve(reserved);
+    }
+
+    void clear() {
+        buf_.clear();
+    }
+
+    StatementBuffer& append(folly::StringPiece str) {
+        buf_.append(str.data(), str.size());
+        return *this;
+    }
+
+    StatementBuffer& append(char c) {
+        buf_.push_back(c);
+        return *this;
+    }
+
+    // Append the decimal digits of val, without any temporary string.
+    StatementBuffer& appendUint(uint64_t val) {
+        char digits[20];
+        auto len = folly::uint64ToBufferUnsafe(val, digits);
+        buf_.append(digits, len);
+        return *this;
+    }
+
+    // Grow the buffer by len bytes and return them to be filled by the caller.
+    char* grow(size_t len) {
+        auto size = buf_.size();
+        buf_.resize(size + len);
+        return &buf_[size];
+    }
+
+    size_t size() const {
+        return buf_.size();
+    }
+
+    size_t capacity() const {
+        return buf_.capacity();
+    }
+
+    folly::StringPiece piece() const {
+        return buf_;
+    }
+
+    const std::string& str() const {
+        return buf_;
+    }
+
+private:
+    std::string buf_;
+};
+
+}  // namespace utils
+}  // namespace chaos
+
+#endif  // UTILS_STATEMENTBUFFER_H_
@@ -0,0 +1,131 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/StatusServer.h"
+#include <sys/socket.h>
+#include "utils/NetUtils.h"
+
+DEFINE_int32(status_port, 0, "The port of the status server to watch the plan, 0 to disable it");
+DEFINE_string(status_address, "127.0.0.1", "The address the status server listens on");
+
+namespace chaos {
+namespace utils {
+
+namespace {
+
+// How long the serving thread waits before checking whether it's stopped.
+constexpr int kPollIntervalMs = 200;
+constexpr size_t kMaxRequestSize = 8192;
+
+std::string response(const std::string& status,
+                     const std::string& contentType,
+                     const std::string& body) {
+    return folly::stringPrintf("HTTP/1.1 %s\r\n"
+                               "Content-Type: %s\r\n"
+                               "Content-Length: %zu\r\n"
+                               "Connection: close\r\n"
+                               "\r\n",
+                               status.c_str(), contentType.c_str(), body.size()) + body;
+}
+
+}   // namespace
+
+void StatusServer::addHandler(const std::string& path,
+                              const std::string& contentType,
+                              Handler handler) {
+    CHECK(stopped_.load()) << "Add the handler of " << path << " before starting";
+    routes_[path] = Route{contentType, std::move(handler)};
+}
+
+bool StatusServer::start() {
+    CHECK(stopped_.load());
+    listenFd_ = NetUtils::listenOn(address_, port_);
+    if (listenFd_ < 0) {
+        return false;
+    }
+    stopped_ = false;
+    thread_ = std::make_unique<std::thread>([this] { serve(); });
+    LOG(INFO) << "The status server is listening on " << address_ << ":" << port_;
+    return true;
+}
+
+void StatusServer::stop() {
+    if (stopped_.exchange(true)) {
+        return;
+    }
+    thread_->join();
+    thread_.reset();
+    ::close(listenFd_);
+    listenFd_ = -1;
+}
+
+void StatusServer::serve() {
+    while (!stopped_.load()) {
+        int fd = NetUtils::acceptOne(listenFd_, kPollIntervalMs);
+        if (fd < 0) {
+            continue;
+        }
+        handle(fd);
+        ::close(fd);
+    }
+}
+
+void StatusServer::handle(int fd) {
+    // A stuck client must not hold the serving thread.
+    timeval timeout{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestSize) {
+        auto n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buf, n);
+    }
+    auto resp = respond(request);
+    size_t sent = 0;
+    while (sent < resp.size()) {
+        auto n = ::send(fd, resp.data() + sent, resp.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            VLOG(1) << "Send the response failed, errno " << errno;
+            return;
+        }
+        sent += n;
+    }
+}
+
+std::string StatusServer::respond(const std::string& request) {
+    // e.g. "GET /status?pretty HTTP/1.1"
+    auto line = request.substr(0, request.find("\r\n"));
+    std::vector<folly::StringPiece> parts;
+    folly::split(' ', line, parts, true);
+    if (parts.size() != 3) {
+        return response("400 Bad Request", "text/plain", "Bad request\n");
+    }
+    if (parts[0] != "GET") {
+        return response("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+    }
+    auto path = parts[1].subpiece(0, parts[1].find('?')).str();
+    auto it = routes_.find(path);
+    if (it == routes_.end()) {
+        std::string body = "Not found, try";
+        for (const auto& route : routes_) {
+            body.append(" ").append(route.first);
+        }
+        return response("404 Not Found", "text/plain", body + "\n");
+    }
+    try {
+        return response("200 OK", it->second.contentType, it->second.handler());
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Serve " << path << " failed, " << e.what();
+        return response("500 Internal Server Error", "text/plain", e.what());
+    }
+}
+
+}   // namespace utils
+}   // namespace chaos
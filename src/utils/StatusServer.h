@@ -0,0 +1,76 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_STATUSSERVER_H_
+#define UTILS_STATUSSERVER_H_
+
+#include "common/base/Base.h"
+#include <thread>
+
+DECLARE_int32(status_port);
+DECLARE_string(status_address);
+
+namespace chaos {
+namespace utils {
+
+/**
+ * A minimal HTTP/1.1 server to watch a running plan, e.g.
+ *      curl http://127.0.0.1:11000/status
+ *
+ * Only GET is supported, every request is served on a single thread and the
+ * connection is closed after the response. The handlers must only read
+ * snapshots, so serving never slows the actions down.
+ * */
+class StatusServer final {
+public:
+    using Handler = std::function<std::string()>;
+
+    // port 0 picks a free port, see port().
+    StatusServer(const std::string& address, uint16_t port)
+        : address_(address)
+        , port_(port) {}
+
+    ~StatusServer() {
+        stop();
+    }
+
+    // Handlers must be added before start.
+    void addHandler(const std::string& path, const std::string& contentType, Handler handler);
+
+    bool start();
+
+    void stop();
+
+    uint16_t port() const {
+        return port_;
+    }
+
+private:
+    struct Route {
+        std::string contentType;
+        Handler     handler;
+    };
+
+    void serve();
+
+    void handle(int fd);
+
+    // Return the full response of the request.
+    std::string respond(const std::string& request);
+
+private:
+    std::string                     address_;
+    uint16_t                        port_;
+    int                             listenFd_{-1};
+    std::atomic<bool>               stopped_{true};
+    std::unique_ptr<std::thread>    thread_;
+    std::unordered_map<std::string, Route> routes_;
+};
+
+}   // namespace utils
+}   // namespace chaos
+
+#endif  // UTILS_STATUSSERVER_H_
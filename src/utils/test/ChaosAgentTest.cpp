@@ -0,0 +1,267 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include "utils/AgentClient.h"
+#include "utils/ChaosAgent.h"
+
+namespace chaos {
+namespace utils {
+
+namespace {
+
+Rule iptablesRule(bool incoming, const std::string& peer, uint16_t portMin, uint16_t portMax) {
+    Rule rule;
+    rule.op = RuleOp::kIptablesInsert;
+    rule.incoming = incoming;
+    rule.peer = peer;
+    rule.portMin = portMin;
+    rule.portMax = portMax;
+    return rule;
+}
+
+Rule tcRule(const std::string& peer, uint16_t port) {
+    Rule rule;
+    rule.op = RuleOp::kTcAdd;
+    rule.incoming = false;
+    rule.peer = peer;
+    rule.portMin = port;
+    rule.device = "eth0";
+    rule.delay = "100ms";
+    rule.distro = "10ms";
+    rule.loss = 5;
+    rule.duplicate = 1;
+    return rule;
+}
+
+}   // namespace
+
+TEST(ChaosAgentTest, RuleTest) {
+    auto rule = iptablesRule(true, "192.168.8.5", 9779, 9780);
+    std::string reason;
+    EXPECT_TRUE(validateRule(rule, reason));
+    EXPECT_EQ("iptables -I INPUT -p tcp -m tcp -s 192.168.8.5 --dport 9779:9780 -j DROP",
+              toString(rule));
+    auto rollback = rollbackOf(rule);
+    ASSERT_TRUE(rollback.hasValue());
+    EXPECT_EQ("iptables -D INPUT -p tcp -m tcp -s 192.168.8.5 --dport 9779:9780 -j DROP",
+              toString(rollback.value()));
+    EXPECT_FALSE(rollbackOf(rollback.value()).hasValue());
+    EXPECT_EQ("iptables -I OUTPUT -p tcp -m tcp -d graphd-0.local -j DROP",
+              toString(iptablesRule(false, "graphd-0.local", 0, 0)));
+
+    auto tc = tcRule("192.168.8.6", 9779);
+    EXPECT_TRUE(validateRule(tc, reason));
+    EXPECT_EQ("tcset eth0 --direction outgoing --dst-network 192.168.8.6 --dst-port 9779 "
+              "--delay 100ms --delay-distro 10ms --loss 5 --duplicate 1 --add",
+              toString(tc));
+    EXPECT_EQ("tcdel eth0 --direction outgoing --dst-network 192.168.8.6 --dst-port 9779",
+              toString(rollbackOf(tc).value()));
+
+    // Nothing could be injected into the arguments.
+    EXPECT_FALSE(validateRule(iptablesRule(true, "1.1.1.1; reboot", 0, 0), reason));
+    EXPECT_FALSE(validateRule(iptablesRule(true, "-F", 0, 0), reason));
+    EXPECT_FALSE(validateRule(iptablesRule(true, "", 0, 0), reason));
+    EXPECT_FALSE(validateRule(iptablesRule(true, "1.1.1.1", 0, 10), reason));
+    EXPECT_FALSE(validateRule(iptablesRule(true, "1.1.1.1", 10, 9), reason));
+    tc = tcRule("192.168.8.6", 9779);
+    tc.device = "eth0 --overwrite";
+    EXPECT_FALSE(validateRule(tc, reason));
+    tc = tcRule("192.168.8.6", 9779);
+    tc.delay = "100ms$(id)";
+    EXPECT_FALSE(validateRule(tc, reason));
+    tc = tcRule("192.168.8.6", 9779);
+    tc.delay = "1.5s";
+    tc.distro = "";
+    EXPECT_TRUE(validateRule(tc, reason));
+    tc.loss = 101;
+    EXPECT_FALSE(validateRule(tc, reason));
+    tc = tcRule("192.168.8.6", 0);
+    EXPECT_FALSE(validateRule(tc, reason));
+    rule.op = static_cast<RuleOp>(9);
+    EXPECT_FALSE(validateRule(rule, reason));
+}
+
+TEST(ChaosAgentTest, ProtocolTest) {
+    AgentRequest req;
+    req.atomic = false;
+    req.rules.emplace_back(iptablesRule(true, "192.168.8.5", 9779, 9780));
+    req.rules.emplace_back(tcRule("192.168.8.6", 9779));
+    auto body = encodeRequest(req);
+    EXPECT_EQ(FrameType::kRequest, frameType(body).value());
+    AgentRequest decoded;
+    ASSERT_TRUE(decodeRequest(body, decoded));
+    EXPECT_FALSE(decoded.atomic);
+    ASSERT_EQ(2UL, decoded.rules.size());
+    EXPECT_EQ(toString(req.rules[0]), toString(decoded.rules[0]));
+    EXPECT_EQ(toString(req.rules[1]), toString(decoded.rules[1]));
+    EXPECT_EQ(RuleOp::kTcAdd, decoded.rules[1].op);
+    // Truncated or trailing bytes
+    EXPECT_FALSE(decodeRequest(folly::StringPiece(body).subpiece(0, body.size() - 1), decoded));
+    EXPECT_FALSE(decodeRequest(body + "x", decoded));
+
+    std::string token;
+    ASSERT_TRUE(decodeHello(encodeHello("secret"), token));
+    EXPECT_EQ("secret", token);
+    EXPECT_FALSE(decodeHello(body, token));
+    EXPECT_TRUE(tokenEquals("secret", "secret"));
+    EXPECT_FALSE(tokenEquals("secret", "secreT"));
+    EXPECT_FALSE(tokenEquals("secret", "secret2"));
+
+    AgentResult result;
+    // Not a result
+    EXPECT_FALSE(decodeResult(body, result));
+
+    result.index = 3;
+    result.exitStatus = -1;
+    result.costUs = 1L << 40;
+    result.out = "out";
+    result.err = "err";
+    AgentResult decodedResult;
+    ASSERT_TRUE(decodeResult(encodeResult(result), decodedResult));
+    EXPECT_EQ(3U, decodedResult.index);
+    EXPECT_EQ(-1, decodedResult.exitStatus);
+    EXPECT_EQ(1L << 40, decodedResult.costUs);
+    EXPECT_EQ("out", decodedResult.out);
+    EXPECT_EQ("err", decodedResult.err);
+
+    AgentDone done;
+    done.ok = false;
+    done.rolledBack = true;
+    done.costUs = 100;
+    AgentDone decodedDone;
+    ASSERT_TRUE(decodeDone(encodeDone(done), decodedDone));
+    EXPECT_FALSE(decodedDone.ok);
+    EXPECT_TRUE(decodedDone.rolledBack);
+    EXPECT_EQ(100, decodedDone.costUs);
+
+    EXPECT_FALSE(frameType("").hasValue());
+    EXPECT_FALSE(frameType("\x09").hasValue());
+}
+
+TEST(ChaosAgentTest, LoopbackTest) {
+    // A fake iptables logging its arguments, none of the rules is there for "-C".
+    auto dir = folly::stringPrintf("/tmp/chaos_agent_test.%d", getpid());
+    ASSERT_EQ(0, ::mkdir(dir.c_str(), 0755));
+    auto log = dir + "/iptables.log";
+    auto iptables = dir + "/iptables";
+    ASSERT_TRUE(folly::writeFile(
+            folly::stringPrintf("#!/bin/sh\necho \"$@\" >> %s\n[ \"$1\" != \"-C\" ]\n",
+                                log.c_str()),
+            iptables.c_str()));
+    ASSERT_EQ(0, ::chmod(iptables.c_str(), 0755));
+    auto slow = dir + "/slow";
+    ASSERT_TRUE(folly::writeFile(std::string("#!/bin/sh\nsleep 1\n"), slow.c_str()));
+    ASSERT_EQ(0, ::chmod(slow.c_str(), 0755));
+    FLAGS_chaos_agent_iptables = iptables;
+    FLAGS_chaos_agent_tcset = "/bin/false";
+    FLAGS_chaos_agent_tcdel = "/bin/true";
+
+    EXPECT_FALSE(ChaosAgent("127.0.0.1", 0, "").start());
+    ChaosAgent agent("127.0.0.1", 0, "secret");
+    ASSERT_TRUE(agent.start());
+    {
+        // A client without the token is refused before any request.
+        AgentClient client("127.0.0.1", agent.port(), "guess");
+        AgentRequest req;
+        req.rules.emplace_back(iptablesRule(true, "192.168.8.5", 9779, 0));
+        AgentResponse resp;
+        EXPECT_EQ(AgentClient::Status::kUnreachable, client.apply(req, resp));
+        std::string logged;
+        EXPECT_FALSE(folly::readFile(log.c_str(), logged));
+    }
+    AgentClient client("127.0.0.1", agent.port(), "secret");
+    {
+        AgentRequest req;
+        req.rules.emplace_back(iptablesRule(true, "192.168.8.5", 9779, 0));
+        req.rules.emplace_back(tcRule("192.168.8.6", 9779));
+        req.atomic = false;
+        std::vector<uint32_t> streamed;
+        AgentResponse resp;
+        auto status = client.apply(req, resp, [&streamed] (const AgentResult& result) {
+            streamed.emplace_back(result.index);
+        });
+        ASSERT_EQ(AgentClient::Status::kApplied, status);
+        EXPECT_FALSE(resp.done.ok);
+        EXPECT_FALSE(resp.done.rolledBack);
+        ASSERT_EQ(2UL, resp.results.size());
+        EXPECT_EQ((std::vector<uint32_t>{0, 1}), streamed);
+        EXPECT_EQ(0, resp.results[0].exitStatus);
+        EXPECT_EQ(1, resp.results[1].exitStatus);
+        EXPECT_LE(resp.results[0].costUs, resp.done.costUs);
+    }
+    {
+        // The applied ones are rolled back once a rule failed, the rest are skipped.
+        AgentRequest req;
+        req.rules.emplace_back(iptablesRule(false, "192.168.8.5", 9779, 9780));
+        req.rules.emplace_back(tcRule("192.168.8.6", 9779));
+        req.rules.emplace_back(iptablesRule(true, "192.168.8.7", 0, 0));
+        AgentResponse resp;
+        ASSERT_EQ(AgentClient::Status::kApplied, client.apply(req, resp));
+        EXPECT_FALSE(resp.done.ok);
+        EXPECT_TRUE(resp.done.rolledBack);
+        ASSERT_EQ(3UL, resp.results.size());
+        EXPECT_EQ(0U, resp.results[0].index);
+        EXPECT_EQ(1U, resp.results[1].index);
+        // The rollback of the first rule, it's already gone.
+        EXPECT_EQ(3U, resp.results[2].index);
+        EXPECT_EQ(0, resp.results[2].exitStatus);
+    }
+    {
+        // Nothing is applied if any rule is malformed.
+        AgentRequest req;
+        req.rules.emplace_back(iptablesRule(true, "192.168.8.8", 0, 0));
+        req.rules.emplace_back(iptablesRule(true, "$(reboot)", 0, 0));
+        AgentResponse resp;
+        ASSERT_EQ(AgentClient::Status::kApplied, client.apply(req, resp));
+        EXPECT_FALSE(resp.done.ok);
+        ASSERT_EQ(1UL, resp.results.size());
+        EXPECT_EQ(1U, resp.results[0].index);
+    }
+    {
+        // No response in time, the rules may have been applied or not.
+        auto timeout = FLAGS_chaos_agent_timeout_ms;
+        FLAGS_chaos_agent_timeout_ms = 100;
+        FLAGS_chaos_agent_tcset = slow;
+        AgentRequest req;
+        req.rules.emplace_back(tcRule("192.168.8.6", 9779));
+        AgentResponse resp;
+        EXPECT_EQ(AgentClient::Status::kUnknown, client.apply(req, resp));
+        FLAGS_chaos_agent_timeout_ms = timeout;
+    }
+    std::string logged;
+    ASSERT_TRUE(folly::readFile(log.c_str(), logged));
+    EXPECT_EQ("-I INPUT -p tcp -m tcp -s 192.168.8.5 --dport 9779 -j DROP\n"
+              "-I OUTPUT -p tcp -m tcp -d 192.168.8.5 --dport 9779:9780 -j DROP\n"
+              "-C OUTPUT -p tcp -m tcp -d 192.168.8.5 --dport 9779:9780 -j DROP\n",
+              logged);
+    agent.stop();
+    {
+        // The agent is gone.
+        AgentRequest req;
+        req.rules.emplace_back(iptablesRule(true, "192.168.8.5", 0, 0));
+        AgentResponse resp;
+        EXPECT_EQ(AgentClient::Status::kUnreachable, client.apply(req, resp));
+    }
+    ::unlink(log.c_str());
+    ::unlink(slow.c_str());
+    ::unlink(iptables.c_str());
+    ::rmdir(dir.c_str());
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <thread>
+#include "utils/Metrics.h"
+
+namespace chaos {
+namespace utils {
+
+TEST(MetricsTest, BucketTest) {
+    for (uint64_t value : {0UL, 1UL, 15UL, 16UL, 17UL, 31UL, 32UL, 1000UL, 123456789UL,
+                           std::numeric_limits<uint64_t>::max()}) {
+        auto index = Histogram::bucketIndex(value);
+        ASSERT_LT(index, Histogram::kBuckets);
+        auto upper = Histogram::bucketUpperBound(index);
+        EXPECT_LE(value, upper);
+        // The error is bounded by the width of the sub bucket.
+        EXPECT_LE(upper - value, value / Histogram::kSubBuckets);
+        if (index > 0) {
+            EXPECT_LT(Histogram::bucketUpperBound(index - 1), value);
+        }
+    }
+}
+
+TEST(MetricsTest, HistogramTest) {
+    Histogram histogram;
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < 4; t++) {
+        threads.emplace_back([&histogram] {
+            for (uint64_t v = 1; v <= 1000; v++) {
+                histogram.record(v);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(4000UL, snapshot.count);
+    EXPECT_EQ(4UL * 500500, snapshot.sum);
+    EXPECT_EQ(1UL, snapshot.min);
+    EXPECT_EQ(1000UL, snapshot.max);
+    EXPECT_NEAR(500, snapshot.percentile(0.5), 500 / Histogram::kSubBuckets);
+    EXPECT_NEAR(990, snapshot.percentile(0.99), 990 / Histogram::kSubBuckets);
+    EXPECT_EQ(1000UL, snapshot.percentile(1));
+    LOG(INFO) << snapshot.toString();
+}
+
+TEST(MetricsTest, ExportTest) {
+    Metrics::histogram("chaos_test_latency_us", {{"kind", "INSERT"}})->record(100);
+    Metrics::histogram("chaos_test_latency_us", {{"kind", "FETCH"}})->record(200);
+    Metrics::counter("chaos_test_errors")->add(3);
+    EXPECT_EQ(Metrics::histogram("chaos_test_latency_us", {{"kind", "INSERT"}}),
+              Metrics::histogram("chaos_test_latency_us", {{"kind", "INSERT"}}));
+    EXPECT_EQ(2UL, Metrics::snapshots("chaos_test_latency_us").size());
+
+    auto text = Metrics::toPrometheus();
+    LOG(INFO) << text;
+    EXPECT_NE(std::string::npos, text.find("# TYPE chaos_test_latency_us histogram\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("chaos_test_latency_us_bucket{kind=\"INSERT\",le=\"+Inf\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("chaos_test_latency_us_sum{kind=\"FETCH\"} 200\n"));
+    EXPECT_NE(std::string::npos, text.find("chaos_test_errors 3\n"));
+
+    auto json = folly::parseJson(Metrics::toJson());
+    ASSERT_TRUE(json.isArray());
+    bool found = false;
+    for (const auto& metric : json) {
+        if (metric["name"] == "chaos_test_latency_us" && metric["labels"]["kind"] == "FETCH") {
+            EXPECT_EQ(1, metric["count"].asInt());
+            EXPECT_EQ(200, metric["max"].asInt());
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
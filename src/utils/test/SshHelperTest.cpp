@@ -13,6 +13,7 @@
 #include <folly/gen/File.h>
 #include <folly/gen/String.h>
 #include "utils/SshHelper.h"
+#include "utils/Parallel.h"
 
 namespace chaos {
 namespace utils {
@@ -29,6 +30,70 @@ TEST(SSHHelperTest, DateTest) {
     EXPECT_EQ(0, ret.exitStatus());
 }
 
+TEST(SSHHelperTest, MuxTest) {
+    auto before = SshHelper::stats();
+    for (int i = 0; i < 3; i++) {
+        auto ret = SshHelper::run("hostname",
+                                  "127.0.0.1",
+                                  [] (const std::string& out) {
+                                     LOG(INFO) << out;
+                                  },
+                                  [] (const std::string& err) {
+                                     LOG(ERROR) << err;
+                                  });
+        EXPECT_EQ(0, ret.exitStatus());
+    }
+    auto after = SshHelper::stats();
+    LOG(INFO) << after.toString();
+    // Every command either reuses a connection, establishes one, or goes directly.
+    EXPECT_EQ(3, (after.handshakes - before.handshakes)
+                    + (after.reuses - before.reuses)
+                    + (after.direct - before.direct));
+    if (after.handshakes > 0) {
+        EXPECT_LE(2, after.reuses - before.reuses);
+    }
+    SshHelper::closeAll();
+}
+
+TEST(SSHHelperTest, RunOnHostsTest) {
+    std::vector<RemoteCommand> commands;
+    for (int i = 0; i < 4; i++) {
+        commands.emplace_back(RemoteCommand{folly::stringPrintf("sleep 1 && echo %d", i),
+                                            "127.0.0.1",
+                                            ""});
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto results = SshHelper::runOnHosts(commands, 4);
+    auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(4UL, results.size());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(results[i].ok());
+        EXPECT_EQ(folly::to<std::string>(i), folly::trimWhitespace(results[i].out).str());
+    }
+    // They ran at the same time.
+    EXPECT_LT(cost, 3500);
+}
+
+TEST(SSHHelperTest, ParallelForTest) {
+    std::atomic<int32_t> running{0};
+    std::atomic<int32_t> maxRunning{0};
+    std::vector<int32_t> done(100, 0);
+    parallelFor(done.size(), 8, [&] (size_t i) {
+        auto cur = ++running;
+        auto max = maxRunning.load();
+        while (cur > max && !maxRunning.compare_exchange_weak(max, cur)) {
+        }
+        usleep(1000);
+        done[i]++;
+        running--;
+    });
+    EXPECT_LE(maxRunning.load(), 8);
+    for (auto d : done) {
+        EXPECT_EQ(1, d);
+    }
+}
+
 }  // namespace utils
 }  // namespace chaos
 
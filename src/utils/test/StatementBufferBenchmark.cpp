@@ -0,0 +1,50 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include "utils/StatementBuffer.h"
+
+// Build INSERT statements of 100 rows, as WriteCircleAction does.
+constexpr uint64_t kRowsPerBatch = 100;
+
+BENCHMARK(StringPrintfAndJoin, iters) {
+    uint64_t vid = 1;
+    for (size_t i = 0; i < iters; i++) {
+        std::vector<std::string> rows;
+        for (uint64_t r = 0; r < kRowsPerBatch; r++, vid++) {
+            rows.emplace_back(folly::stringPrintf("\"%lu\":(\"%lu\")", vid, vid + 1));
+        }
+        auto joinStr = folly::join(",", rows);
+        auto cmd = folly::stringPrintf("INSERT VERTEX %s (%s) VALUES %s",
+                                       "circle", "nextId", joinStr.c_str());
+        folly::doNotOptimizeAway(cmd);
+    }
+}
+
+BENCHMARK_RELATIVE(StatementBuffer, iters) {
+    uint64_t vid = 1;
+    chaos::utils::StatementBuffer stmt;
+    for (size_t i = 0; i < iters; i++) {
+        stmt.clear();
+        stmt.append("INSERT VERTEX ").append("circle").append(" (").append("nextId")
+            .append(") VALUES ");
+        for (uint64_t r = 0; r < kRowsPerBatch; r++, vid++) {
+            if (r != 0) {
+                stmt.append(',');
+            }
+            stmt.append('"').appendUint(vid).append("\":(\"").appendUint(vid + 1).append("\")");
+        }
+        folly::doNotOptimizeAway(stmt.size());
+    }
+}
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    folly::runBenchmarks();
+    return 0;
+}
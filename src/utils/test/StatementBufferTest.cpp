@@ -0,0 +1,68 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <folly/init/Init.h>
+#include "utils/StatementBuffer.h"
+
+namespace chaos {
+namespace utils {
+
+TEST(StatementBufferTest, AppendTest) {
+    StatementBuffer stmt(16);
+    stmt.append("INSERT VERTEX ").append("circle").append(" (").append("nextId")
+        .append(") VALUES ");
+    for (uint64_t vid = 1; vid <= 3; vid++) {
+        if (vid != 1) {
+            stmt.append(',');
+        }
+        stmt.append('"').appendUint(vid).append("\":(\"").appendUint(vid + 1).append("\")");
+    }
+    EXPECT_EQ("INSERT VERTEX circle (nextId) VALUES "
+              "\"1\":(\"2\"),\"2\":(\"3\"),\"3\":(\"4\")", stmt.str());
+
+    stmt.clear();
+    stmt.appendUint(0).append(',').appendUint(std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ("0,18446744073709551615", stmt.str());
+
+    stmt.clear();
+    auto* data = stmt.grow(3);
+    data[0] = 'a';
+    data[1] = 'b';
+    data[2] = 'c';
+    EXPECT_EQ("abc", stmt.piece());
+}
+
+TEST(StatementBufferTest, ReuseTest) {
+    StatementBuffer stmt;
+    auto build = [&stmt] {
+        stmt.clear();
+        for (uint64_t i = 0; i < 1000; i++) {
+            stmt.append('"').appendUint(i * 1000003).append("\":(\"").appendUint(i).append("\"),");
+        }
+    };
+    build();
+    auto capacity = stmt.capacity();
+    auto size = stmt.size();
+    // Nothing is allocated once the buffer has warmed up.
+    for (int i = 0; i < 10; i++) {
+        build();
+        EXPECT_EQ(capacity, stmt.capacity());
+        EXPECT_EQ(size, stmt.size());
+    }
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
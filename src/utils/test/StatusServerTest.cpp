@@ -0,0 +1,80 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <glog/logging.h>
+#include <folly/init/Init.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "utils/StatusServer.h"
+
+namespace chaos {
+namespace utils {
+
+// Send the request to the server on the loopback, return the whole response.
+std::string request(uint16_t port, const std::string& req) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_GE(fd, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK_EQ(0, ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+    CHECK_EQ(static_cast<ssize_t>(req.size()), ::send(fd, req.data(), req.size(), 0));
+    std::string resp;
+    char buf[1024];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+        resp.append(buf, n);
+    }
+    ::close(fd);
+    return resp;
+}
+
+TEST(StatusServerTest, ServeTest) {
+    std::atomic<int32_t> round{0};
+    StatusServer server("127.0.0.1", 0);
+    server.addHandler("/status", "application/json", [&round] {
+        return folly::stringPrintf("{\"round\": %d}", ++round);
+    });
+    ASSERT_TRUE(server.start());
+    ASSERT_NE(0, server.port());
+    {
+        auto resp = request(server.port(), "GET /status HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        EXPECT_EQ(0UL, resp.find("HTTP/1.1 200 OK\r\n"));
+        EXPECT_NE(std::string::npos, resp.find("Content-Type: application/json\r\n"));
+        EXPECT_NE(std::string::npos, resp.find("\r\n\r\n{\"round\": 1}"));
+    }
+    {
+        // The handler is called for every request, the query string is ignored.
+        auto resp = request(server.port(), "GET /status?pretty HTTP/1.1\r\n\r\n");
+        EXPECT_NE(std::string::npos, resp.find("{\"round\": 2}"));
+    }
+    {
+        auto resp = request(server.port(), "GET /unknown HTTP/1.1\r\n\r\n");
+        EXPECT_EQ(0UL, resp.find("HTTP/1.1 404 Not Found\r\n"));
+        EXPECT_NE(std::string::npos, resp.find("/status"));
+    }
+    {
+        auto resp = request(server.port(), "POST /status HTTP/1.1\r\n\r\n");
+        EXPECT_EQ(0UL, resp.find("HTTP/1.1 405 Method Not Allowed\r\n"));
+    }
+    server.stop();
+    EXPECT_EQ(2, round.load());
+}
+
+}  // namespace utils
+}  // namespace chaos
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}